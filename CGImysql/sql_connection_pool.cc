@@ -1,10 +1,15 @@
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
+#include <algorithm>
 #include <list>
 #include <string>
+#include <mysql/errmsg.h>
 
 #include "sql_connection_pool.hh"
+#include "../fiberLibrary/fdmanager.hh"
+#include "../fiberLibrary/hook.hh"
+#include "../fiberLibrary/iomanager.hh"
 
 namespace bryant {
 
@@ -44,32 +49,133 @@ void Connection_pool::init(std::string url, std::string user,
         }
 
         conn_list.push_back(con); //放入一个连接
+        m_statements[con];        //这个连接的语句缓存
         ++m_free_conn; //因为还没有用到刚刚才放进去的这个连接，固然在池子里面的连接多了一个
     }
     
-    reserve = Semaphore(m_free_conn); //信号量初始化，匿名对象给到拷贝，被创建即被析构
     m_max_conn = m_free_conn; //m_free_conn这个和刚开始的最大连接数是一样的，因为在内部将这个空闲的给++了
 }
 
 
 //当有请求时，从数据库连接池中返回一个可用连接，更新使用和空闲连接数
-MYSQL * Connection_pool::get_connection()
+MYSQL * Connection_pool::get_connection(int timeout_ms)
 {
-    MYSQL *con=nullptr;
-    if(conn_list.size()==0)
+    lock.lock();
+    if(m_max_conn == 0) {
+        lock.unlock();
         return nullptr;
-    reserve.wait(); //信号量去阻塞等待，其他用户返回回来的连接
+    }
 
-    lock.lock();
-    con=conn_list.front();
+    //有人排队时不插队, 否则刚归还的连接可能总被新来的抢走
+    if(!conn_list.empty() && m_waiters.empty()) {
+        MYSQL* con = take();
+        lock.unlock();
+        attach(con);
+        return con;
+    }
+    if(timeout_ms == 0) {
+        lock.unlock();
+        return nullptr;
+    }
+
+    std::shared_ptr<Waiter> waiter(new Waiter);
+    IOManager* iom = is_hook_enable() ? IOManager::GetThis() : nullptr;
+    if(iom) {
+        waiter->fiber = Fiber::GetThis();
+        waiter->scheduler = iom;
+    }
+    waiter->pos = m_waiters.insert(m_waiters.end(), waiter);
+    lock.unlock();
+
+    if(iom) {
+        //挂起当前协程, 由release_connection或超时定时器重新调度
+        Timer::ptr timer;
+        if(timeout_ms > 0) {
+            std::weak_ptr<Waiter> weak(waiter);
+            timer = iom->addTimer(timeout_ms, [this, weak]() {
+                std::shared_ptr<Waiter> waiter = weak.lock();
+                if(waiter) {
+                    expire(waiter);
+                }
+            });
+        }
+        Fiber::GetThis()->yield();
+        if(timer) {
+            timer->cancel();
+        }
+    }
+    else {
+        bool woken = timeout_ms < 0 ? waiter->sem.wait() : waiter->sem.timewait(timeout_ms);
+        if(!woken) {
+            //超时和归还可能同时发生, 以是否已出队为准
+            lock.lock();
+            if(!waiter->done) {
+                waiter->done = true;
+                m_waiters.erase(waiter->pos);
+            }
+            lock.unlock();
+        }
+    }
+
+    if(waiter->con == nullptr) {
+        LOG_ERROR("[MYSQL] get connection timeout after %d ms", timeout_ms);
+        return nullptr;
+    }
+    attach(waiter->con);
+    return waiter->con;
+}
+
+
+MYSQL*
+Connection_pool::take()
+{
+    MYSQL* con = conn_list.front();
     conn_list.pop_front();
     --m_free_conn;
     ++m_cur_conn;
-    lock.unlock();
     return con;
 }
 
 
+void
+Connection_pool::expire(const std::shared_ptr<Waiter>& waiter)
+{
+    lock.lock();
+    if(waiter->done) {
+        lock.unlock();
+        return;
+    }
+    waiter->done = true;
+    m_waiters.erase(waiter->pos);
+    lock.unlock();
+    wake(*waiter);
+}
+
+
+//归还者可能在别的线程上, 此时等待的协程也许还没yield完, 调度器会等它切出去再恢复
+void
+Connection_pool::wake(Waiter& waiter)
+{
+    if(waiter.fiber) {
+        waiter.scheduler->schedule(waiter.fiber);
+    }
+    else {
+        waiter.sem.post();
+    }
+}
+
+
+//每次取出时都检查: 断线重连后socket会变; 没有开启hook的线程(启动时加载用户表)不需要登记
+void 
+Connection_pool::attach(MYSQL* con)
+{
+    if(!is_hook_enable()) {
+        return;
+    }
+    FdMgr::GetInstance()->get(con->net.fd, true);
+}
+
+
 //释放当前连接
 bool Connection_pool::release_connection(MYSQL*con)
 {
@@ -77,19 +183,153 @@ bool Connection_pool::release_connection(MYSQL*con)
         return false;
 
     lock.lock();
+    if(!m_waiters.empty()) {
+        //直接交给等得最久的那个, 连接不回到池子里, 使用数不变
+        std::shared_ptr<Waiter> waiter = m_waiters.front();
+        m_waiters.pop_front();
+        waiter->done = true;
+        waiter->con = con;
+        lock.unlock();
+        wake(*waiter);
+        return true;
+    }
     conn_list.push_back(con); //回归到池子里
     ++m_free_conn;
     --m_cur_conn;
     lock.unlock();
-
-    reserve.post();
-    //使得这个信号量+1，因为到时候肯定会有多个线程访问这个单例类的
-    //固然其释放和增加的函数肯定都会有线程调用的,即多个客户端访问一个服务器的线程，但是真的要开一个线程为客户去服务吗?
-    //其实没有必要的,可以使用协程
     return true;
 
 }
 
+MYSQL_STMT*
+Connection_pool::get_statement(MYSQL* con, std::string_view sql)
+{
+    auto conn_it = m_statements.find(con);
+    if(conn_it == m_statements.end()) {
+        return nullptr;
+    }
+    StatementCache& cache = conn_it->second;
+    auto it = cache.find(sql);
+    if(it != cache.end()) {
+        return it->second;
+    }
+
+    MYSQL_STMT* stmt = mysql_stmt_init(con);
+    if(stmt == nullptr) {
+        LOG_ERROR("[MYSQL] stmt init error: %d", mysql_errno(con));
+        return nullptr;
+    }
+    if(mysql_stmt_prepare(stmt, sql.data(), sql.size())) {
+        LOG_ERROR("[MYSQL] prepare error: %d %s", mysql_stmt_errno(stmt), mysql_stmt_error(stmt));
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    cache.emplace(std::string(sql), stmt);
+    return stmt;
+}
+
+
+unsigned int
+Connection_pool::execute(MYSQL* con, std::string_view sql, std::initializer_list<std::string_view> params)
+{
+    MYSQL_STMT* stmt = nullptr;
+    return run(con, sql, params.begin(), params.size(), &stmt);
+}
+
+
+unsigned int
+Connection_pool::execute(MYSQL* con, std::string_view sql, const std::vector<std::string_view>& params)
+{
+    MYSQL_STMT* stmt = nullptr;
+    return run(con, sql, params.data(), params.size(), &stmt);
+}
+
+
+unsigned int
+Connection_pool::query_one(MYSQL* con, std::string_view sql, std::initializer_list<std::string_view> params, std::string* value)
+{
+    MYSQL_STMT* stmt = nullptr;
+    if(unsigned int err = run(con, sql, params.begin(), params.size(), &stmt)) {
+        return err;
+    }
+
+    char buf[MAX_VALUE];
+    unsigned long length = 0;
+    MYSQL_BIND bind;
+    memset(&bind, 0, sizeof(MYSQL_BIND));
+    bind.buffer_type = MYSQL_TYPE_STRING;
+    bind.buffer = buf;
+    bind.buffer_length = sizeof(buf);
+    bind.length = &length;
+
+    int ret = mysql_stmt_bind_result(stmt, &bind) ? 1 : mysql_stmt_fetch(stmt);
+    if(ret == 0 || ret == MYSQL_DATA_TRUNCATED) {
+        value->assign(buf, std::min<unsigned long>(length, sizeof(buf)));
+    }
+    //没取完的行也要丢掉, 否则这个连接上的下一条语句会报命令不同步
+    mysql_stmt_free_result(stmt);
+    if(ret == 1) {
+        return fail(con, sql, stmt);
+    }
+    return ret == MYSQL_NO_DATA ? MYSQL_NO_DATA : 0;
+}
+
+
+unsigned int
+Connection_pool::run(MYSQL* con, std::string_view sql, const std::string_view* params, size_t count, MYSQL_STMT** stmt)
+{
+    if(count > MAX_PARAMS) {
+        return CR_UNKNOWN_ERROR;
+    }
+    *stmt = get_statement(con, sql);
+    if(*stmt == nullptr) {
+        unsigned int err = mysql_errno(con);
+        return err ? err : CR_SERVER_GONE_ERROR;
+    }
+
+    //常见的几个参数在栈上绑定, 协程栈放不下MAX_PARAMS个MYSQL_BIND
+    MYSQL_BIND inline_binds[INLINE_PARAMS];
+    unsigned long inline_lengths[INLINE_PARAMS];
+    std::vector<MYSQL_BIND> heap_binds;
+    std::vector<unsigned long> heap_lengths;
+    MYSQL_BIND* binds = inline_binds;
+    unsigned long* lengths = inline_lengths;
+    if(count > INLINE_PARAMS) {
+        heap_binds.resize(count);
+        heap_lengths.resize(count);
+        binds = heap_binds.data();
+        lengths = heap_lengths.data();
+    }
+    for(size_t i = 0; i < count; ++i) {
+        lengths[i] = params[i].size();
+        memset(&binds[i], 0, sizeof(MYSQL_BIND));
+        binds[i].buffer_type = MYSQL_TYPE_STRING;
+        binds[i].buffer = const_cast<char*>(params[i].data());
+        binds[i].buffer_length = params[i].size();
+        binds[i].length = &lengths[i];
+    }
+
+    if(mysql_stmt_bind_param(*stmt, binds) || mysql_stmt_execute(*stmt)) {
+        return fail(con, sql, *stmt);
+    }
+    return 0;
+}
+
+
+unsigned int
+Connection_pool::fail(MYSQL* con, std::string_view sql, MYSQL_STMT* stmt)
+{
+    unsigned int err = mysql_stmt_errno(stmt);
+    if(err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST) {
+        //连接断了, 语句在服务端已经不存在
+        StatementCache& cache = m_statements[con];
+        cache.erase(cache.find(sql));
+        mysql_stmt_close(stmt);
+    }
+    return err;
+}
+
+
 //销毁数据库连接池的所有连接
 
 void Connection_pool::destroy_pool()
@@ -101,11 +341,15 @@ void Connection_pool::destroy_pool()
         for(it = conn_list.begin(); it != conn_list.end(); ++it)
         {
             MYSQL*con = *it;
+            for(auto& stmt : m_statements[con]) {
+                mysql_stmt_close(stmt.second);
+            }
             mysql_close(con);
         }
         m_cur_conn = 0;
         m_free_conn = 0;
         conn_list.clear();
+        m_statements.clear();
     }
     lock.unlock();
 }
@@ -115,6 +359,14 @@ int Connection_pool::get_free_conn()
     return this->m_free_conn;
 }
 
+size_t Connection_pool::get_waiters()
+{
+    lock.lock();
+    size_t n = m_waiters.size();
+    lock.unlock();
+    return n;
+}
+
 Connection_pool::~Connection_pool() //类似rall的思想
 {
     destroy_pool();
@@ -5,26 +5,88 @@
 #include <error.h>
 #include <string>
 #include <list>
+#include <map>
+#include <memory>
 #include <iostream>
+#include <initializer_list>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 #include <mysql/mysql.h>
 
 #include "../util/locker.hh"
 #include "../log/logger.hh"
+#include "../fiberLibrary/fiber.hh"
+#include "../fiberLibrary/scheduler.hh"
 
 namespace bryant{
 
 class Connection_pool {
+public:
+    static const int ACQUIRE_TIMEOUT = 3000; //默认的获取连接超时(ms)
+    static const size_t MAX_PARAMS = 1024;   //预处理语句最多的参数个数(多行INSERT一行两个)
+    static const size_t INLINE_PARAMS = 16;  //不超过这个数的参数在栈上绑定, 更多的才分配内存
+    static const size_t MAX_VALUE = 256;     //query_one取回的值的最大长度
+
 private:
     Connection_pool() = default; //单例模式
     ~Connection_pool();
 
-    int m_max_conn;      //最大连接数
+    // 等待连接的协程/线程
+    struct Waiter {
+        Fiber::ptr fiber;                   //挂起的协程, 为空时是阻塞的线程
+        Scheduler* scheduler = nullptr;     //唤醒协程用的调度器
+        Semaphore sem;                      //线程等待者在这里阻塞
+        MYSQL* con = nullptr;               //归还者直接交过来的连接, 超时为nullptr
+        bool done = false;                  //已出队(拿到连接或超时)
+        std::list<std::shared_ptr<Waiter>>::iterator pos;   //在等待队列中的位置
+    };
+
+    int m_max_conn = 0;  //最大连接数
     int m_cur_conn = 0;  //当前已经使用的连接数
     int m_free_conn = 0; //当前空闲的连接数
     Mutex lock;
 
     std::list<MYSQL*> conn_list; //连接池
-    Semaphore reserve;           //信号量
+    std::list<std::shared_ptr<Waiter>> m_waiters; //先进先出的等待队列
+
+    // 每个连接上已经prepare过的语句, SQL -> 语句
+    // 外层在init里建好后只读, 内层只由持有这个连接的协程访问, 都不需要加锁
+    typedef std::map<std::string, MYSQL_STMT*, std::less<>> StatementCache;
+    std::unordered_map<MYSQL*, StatementCache> m_statements;
+
+    /**
+     * @brief 加锁后调用, 从空闲连接中取一个
+     */
+    MYSQL* take();
+
+    /**
+     * @brief 等待超时, 还在队列中时出队并唤醒
+     */
+    void expire(const std::shared_ptr<Waiter>& waiter);
+
+    /**
+     * @brief 唤醒出队的等待者
+     */
+    static void wake(Waiter& waiter);
+
+    /**
+     * @brief 把连接的socket登记到FdMgr
+     * @details 登记后socket为非阻塞, libmysqlclient内部的recv/send/poll经过hook,
+     *          等待数据库响应时只挂起当前协程, 同一线程上的其他协程照常运行
+     */
+    void attach(MYSQL* con);
+
+    /**
+     * @brief 绑定参数并执行预处理语句, 成功时由stmt带出语句
+     * @return 0成功, 否则为mysql的错误码
+     */
+    unsigned int run(MYSQL* con, std::string_view sql, const std::string_view* params, size_t count, MYSQL_STMT** stmt);
+
+    /**
+     * @brief 语句出错时取错误码; 断线等客户端错误会丢掉缓存的语句, 下次重新prepare
+     */
+    unsigned int fail(MYSQL* con, std::string_view sql, MYSQL_STMT* stmt);
 
 public:
     std::string m_url;          //主机地址
@@ -34,9 +96,46 @@ public:
     int m_port;                 //数据库端口号
 
 public:
-    MYSQL*get_connection();             //获取数据库连接
-    bool release_connection(MYSQL*conn);//释放连接
+    /**
+     * @brief 获取数据库连接
+     * @details 没有空闲连接时排队等待, 先到先得。在IOManager的协程里只挂起当前协程,
+     *          同一线程上的其他协程照常运行; 其他线程(如启动时加载用户表)阻塞等待
+     * @param timeout_ms 最长等待时间, 小于0时一直等待, 0时不等待
+     * @return nullptr 超时或连接池为空
+     */
+    MYSQL*get_connection(int timeout_ms = ACQUIRE_TIMEOUT);
+    bool release_connection(MYSQL*conn);//释放连接, 有人排队时直接交给队头
     int get_free_conn();                //获取连接
+    size_t get_waiters();               //排队等待的协程/线程数
+
+    /**
+     * @brief 取连接上缓存的预处理语句, 第一次用到时才mysql_stmt_prepare
+     * @details 调用方必须持有con; 服务端只在prepare时解析一次SQL, 之后只传参数
+     * @param con 从连接池取出的连接
+     * @param sql 带'?'占位符的SQL
+     * @return nullptr prepare失败
+     */
+    MYSQL_STMT* get_statement(MYSQL* con, std::string_view sql);
+
+    /**
+     * @brief 绑定参数(都按字符串)并执行预处理语句
+     * @details 参数不拼进SQL, 不需要转义; 断线等客户端错误会丢掉缓存的语句, 下次重新prepare
+     * @return 0成功, 否则为mysql的错误码
+     */
+    unsigned int execute(MYSQL* con, std::string_view sql, std::initializer_list<std::string_view> params);
+
+    /**
+     * @brief 同上, 参数个数在运行时才确定(如多行INSERT), 最多MAX_PARAMS个
+     */
+    unsigned int execute(MYSQL* con, std::string_view sql, const std::vector<std::string_view>& params);
+
+    /**
+     * @brief 执行预处理的查询语句, 取第一行第一列
+     * @details 超过MAX_VALUE字节的值会被截断
+     * @param value 查到时写入
+     * @return 0查到, MYSQL_NO_DATA没有结果, 否则为mysql的错误码
+     */
+    unsigned int query_one(MYSQL* con, std::string_view sql, std::initializer_list<std::string_view> params, std::string* value);
     void destroy_pool();                //销毁所有连接
 
     static Connection_pool *get_instance();
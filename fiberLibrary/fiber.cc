@@ -108,6 +108,11 @@ Fiber::resume(){
     } else {
         assert(swapcontext(&(t_thread_fiber->m_ctx), &m_ctx) == 0);
     }
+    // 回到这里时协程的上下文已经保存好, 这之后才能在其他线程上恢复它;
+    // 如果在yield里提前置为READY, 别的线程可能在swapcontext之前就恢复这个协程
+    if(m_state != TERM){
+        m_state = READY;
+    }
     LOG_DEBUG("[Fiber] Thread %lu Fiber %lu resume: quit swapcontext", bryant::GetThreadId(), m_id);
 }
 
@@ -116,9 +121,6 @@ void
 Fiber::yield(){
     assert(m_state == RUNNING || m_state == TERM);
     SetThis(t_thread_fiber.get());
-    if(m_state != TERM){
-        m_state = READY; // 之前错写成RUNNING
-    }
 
     LOG_DEBUG("[Fiber] Thread %lu Fiber %lu yield: enter swapcontext", bryant::GetThreadId(), m_id);
     if(m_run_in_scheduler){
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <ucontext.h>
+#include <atomic>
 #include <memory>
 #include <functional>
 
@@ -113,7 +114,7 @@ private:
 
 private:
     int m_id;                   // 协程id
-    State m_state;              // 协程状态
+    std::atomic<State> m_state; // 协程状态, 调度线程会读其他线程上协程的状态
     int m_stack_size;           // 栈大小
     void* m_stack;              // 栈地址
     std::function<void()> m_cb; // 回调函数
@@ -25,11 +25,13 @@
     XX(send) \
     XX(sendto) \
     XX(sendmsg) \
+    XX(sendfile) \
     XX(close) \
     XX(fcntl) \
     XX(ioctl) \
     XX(getsockopt) \
-    XX(setsockopt) 
+    XX(setsockopt) \
+    XX(poll)
 
 
 namespace bryant{
@@ -384,6 +386,11 @@ ssize_t sendmsg(int sockfd, const struct msghdr *msg, int flags) {
 	return do_io(sockfd, sendmsg_f, "sendmsg", bryant::IOManager::WRITE, SO_SNDTIMEO, msg, flags);	
 }
 
+// offset由内核在成功发送后推进，EAGAIN挂起协程后重试时会从正确位置继续
+ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count) {
+	return do_io(out_fd, sendfile_f, "sendfile", bryant::IOManager::WRITE, SO_SNDTIMEO, in_fd, offset, count);
+}
+
 
 int close(int fd) {
 	if(!bryant::t_hook_enable) {
@@ -545,4 +552,73 @@ int setsockopt(int sockfd, int level, int optname, const void *optval, socklen_t
 }
 
 
+// 只接管等待单个socket读或写就绪的poll(第三方客户端库在阻塞读写前常这样等待, 例如设置了超时的libmysqlclient),
+// 等待期间挂起当前协程而不是线程；其余情况交给原函数
+// glibc把poll的fds声明为只写(access (write_only, 1, 2)), 编译器因此认为读fds->fd/events是读未初始化的内存;
+// poll本来就要读这两个字段, 只在这个函数里关掉这条误报
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+int poll(struct pollfd *fds, nfds_t nfds, int timeout) {
+    if(!bryant::t_hook_enable || !fds || nfds != 1 || timeout == 0) {
+        return poll_f(fds, nfds, timeout);
+    }
+
+    int fd = fds->fd;
+    short want = fds->events & (POLLIN | POLLOUT);
+    bryant::FdCtx::ptr ctx = bryant::FdMgr::GetInstance()->get(fd);
+    bryant::IOManager* iom = bryant::IOManager::GetThis();
+    if(!ctx || ctx->isClosed() || !ctx->isSocket() || !iom || (want != POLLIN && want != POLLOUT)) {
+        return poll_f(fds, nfds, timeout);
+    }
+
+    // 已经就绪
+    int n = poll_f(fds, nfds, 0);
+    if(n != 0) {
+        return n;
+    }
+
+    bryant::IOManager::Event event = (want == POLLIN) ? bryant::IOManager::READ : bryant::IOManager::WRITE;
+    std::shared_ptr<bryant::Timer> timer;
+    std::shared_ptr<timer_info> tinfo(new timer_info);
+    std::weak_ptr<timer_info> winfo(tinfo);
+    if(timeout > 0) {
+        timer = iom->addConditionTimer(timeout, [winfo, fd, iom, event]() {
+            auto t = winfo.lock();
+            if(!t || t->cancelled) {
+                return;
+            }
+            t->cancelled = ETIMEDOUT;
+            iom->cancelEvent(fd, event);
+        }, winfo);
+    }
+
+    while(true) {
+        if(iom->addEvent(fd, event, nullptr)) {
+            LOG_INFO("[Hook] poll addEvent(%d, %d) error", fd, event);
+            if(timer) {
+                timer->cancel();
+            }
+            return poll_f(fds, nfds, timeout);
+        }
+        bryant::Fiber::GetThis()->yield();
+
+        // 超时
+        if(tinfo->cancelled) {
+            fds[0].revents = 0;
+            return 0;
+        }
+
+        // 由原函数给出实际的revents(包括POLLHUP/POLLERR)
+        n = poll_f(fds, nfds, 0);
+        if(n != 0) {
+            if(timer) {
+                timer->cancel();
+            }
+            return n;
+        }
+    }
+}
+#pragma GCC diagnostic pop
+
+
 }
\ No newline at end of file
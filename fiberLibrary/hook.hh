@@ -5,7 +5,9 @@
 #include <sys/types.h>          
 #include <sys/uio.h>
 #include <sys/ioctl.h>
+#include <sys/sendfile.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <cstdint>
 
 
@@ -83,6 +85,9 @@ extern "C"
 	typedef ssize_t (*sendmsg_fun) (int sockfd, const struct msghdr *msg, int flags);
 	extern sendmsg_fun sendmsg_f;
 
+	typedef ssize_t (*sendfile_fun) (int out_fd, int in_fd, off_t *offset, size_t count);
+	extern sendfile_fun sendfile_f;
+
 	typedef int (*close_fun) (int fd);
 	extern close_fun close_f;
 
@@ -98,6 +103,9 @@ extern "C"
     typedef int (*setsockopt_fun) (int sockfd, int level, int optname, const void *optval, socklen_t optlen);
     extern setsockopt_fun setsockopt_f;
 
+    typedef int (*poll_fun) (struct pollfd *fds, nfds_t nfds, int timeout);
+    extern poll_fun poll_f;
+
     extern int connect_with_timeout(int fd, const struct sockaddr* addr, socklen_t addrlen, uint64_t timeout_ms);
 
     // function prototype -> 对应.h中已经存在 可以省略
@@ -126,6 +134,7 @@ extern "C"
     ssize_t send(int sockfd, const void *buf, size_t len, int flags);
     ssize_t sendto(int sockfd, const void *buf, size_t len, int flags, const struct sockaddr *dest_addr, socklen_t addrlen);
     ssize_t sendmsg(int sockfd, const struct msghdr *msg, int flags);
+    ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count);
 
     // fd
     int close(int fd);
@@ -137,4 +146,7 @@ extern "C"
     int getsockopt(int sockfd, int level, int optname, void *optval, socklen_t *optlen);
     int setsockopt(int sockfd, int level, int optname, const void *optval, socklen_t optlen);
 
+    // 等待
+    int poll(struct pollfd *fds, nfds_t nfds, int timeout);
+
 }
\ No newline at end of file
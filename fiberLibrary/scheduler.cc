@@ -167,14 +167,20 @@ Scheduler::run(){
                     continue;
                 }
 
+                // 协程已被唤醒, 但还没在原线程上yield完, 等它切出去再调度;
+                // 不用通知其他线程: 原线程yield回到这个循环后自己就会取到它, 通知只会让空闲线程空转
+                if(it->fiber && it->fiber->getState() == Fiber::State::RUNNING){
+                    ++it;
+                    continue;
+                }
+
                 // 找到属于未绑定/当前线程的任务
                 assert(it->fiber || it->cb);
                 if(it->fiber){
                     assert(it->fiber->getState() == Fiber::State::READY);
                 }
                 task = *it;
-                m_tasks.erase(it);
-                ++it;
+                it = m_tasks.erase(it);
                 ++m_activeThreadCount;
                 break;
             }
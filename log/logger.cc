@@ -159,7 +159,14 @@ Logger::write_log(LEVEL level, const char* format, ...)
     va_start(args, format);
 
     int n = snprintf(m_write_buf, m_logBuf_size - 1, "%s%s", buf, level_info);
-    int m = vsnprintf(m_write_buf + n, m_logBuf_size - 1, format, args);
+    // 超长的内容(如很长的请求头)截断，留出'\n'和'\0'的位置
+    int left = m_logBuf_size - 1 - n;
+    int m = vsnprintf(m_write_buf + n, left, format, args);
+    if(m < 0) {
+        m = 0;
+    } else if(m >= left) {
+        m = left - 1;
+    }
     m_write_buf[n + m] = '\n';
     m_write_buf[n + m + 1] = '\0';
 
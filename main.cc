@@ -4,10 +4,18 @@
 #include "../log/logger.hh"
 #include "../fiberLibrary/iomanager.hh"
 #include "../server/httpServer.hh"
+#include "../server/file_cache.hh"
+#include "../server/response_cache.hh"
+#include "../server/cache_control.hh"
+#include "../server/compress_cache.hh"
+#include "../server/handlers.hh"
+#include "../server/user_writer.hh"
 
 
 bryant::IOManager::ptr worker = nullptr;
 
+static const uint64_t RESPONSE_CACHE_REPORT_INTERVAL = 60 * 1000;    // 响应缓存统计的输出间隔(ms)
+
 void run(){
     bryant::Config* config = bryant::Config::get_instance();
 
@@ -18,15 +26,52 @@ void run(){
     bryant::Connection_pool* conn_pool = bryant::Connection_pool::get_instance();
     conn_pool->init("localhost", config->get_name(), config->get_passwd(), config->get_database_name(), config->get_port(), config->get_sql_pool_num());
 
+    // 初始化打开文件缓存
+    bryant::FileCache::get_instance()->init(config->get_file_cache_num(),
+                                            (size_t)config->get_file_cache_size() << 20,
+                                            config->get_file_cache_ttl());
+
+    // 初始化响应缓存
+    bryant::ResponseCache::get_instance()->init((size_t)config->get_response_cache_size() << 10,
+                                                config->get_response_cache_body(),
+                                                config->get_file_cache_ttl(),
+                                                config->get_response_cache_stats());
+    if(config->get_response_cache_stats()) {
+        // 定期输出命中率
+        bryant::IOManager::GetThis()->addTimer(RESPONSE_CACHE_REPORT_INTERVAL, [](){
+            bryant::ResponseCache::get_instance()->report();
+        }, true);
+    }
+
+    // 初始化静态资源的Cache-Control
+    bryant::CacheControl::get_instance()->init(config->get_cache_control());
+
+    // 初始化压缩缓存(后台压缩线程)
+    bryant::CompressCache::get_instance()->init((size_t)config->get_compress_cache_size() << 10,
+                                                config->get_compress_min_size(),
+                                                config->get_compress_level());
+
+    // 注册路由(之后只读)
+    bryant::RegisterRoutes(bryant::Router::get_instance());
+    bryant::RegisterWebSocketRoutes(bryant::WebSocketRouter::get_instance());
+
     // 初始化IOManager
     worker.reset(new bryant::IOManager(bryant::Config::get_instance()->get_thread_num(), false));
 
+    // 注册用户批量写入数据库(写回队列), 和连接在同一个调度器上
+    if(config->get_write_behind() > 0) {
+        bryant::UserWriter::get_instance()->start(bryant::IOManager::GetThis(), config->get_write_behind() == 1);
+    }
+
     // 初始化httpServer
     std::shared_ptr<bryant::http_server> httpServer = std::make_shared<bryant::http_server>(config->get_linger());
-    httpServer->initmysql_result(bryant::Connection_pool::get_instance());
+    httpServer->initmysql_result(bryant::Connection_pool::get_instance(), config->get_user_mode() == 0,
+                                 config->get_user_snapshot());
     httpServer->m_user = config->get_name();
     httpServer->m_password = config->get_passwd();
     httpServer->m_database_name = config->get_database_name();
+    httpServer->m_sendfile = config->get_sendfile();
+    httpServer->m_idle_park = config->get_idle_park();
 
     sylar::Address::ptr m_address = sylar::Address::LookupAnyIPAddress("127.0.0.1:" + std::to_string(config->get_port()) );
     while(!httpServer->bind(m_address,false)){
@@ -0,0 +1,83 @@
+#include <math.h>
+#include <string.h>
+
+#include "bloom_filter.hh"
+#include "user_store.hh"
+
+namespace bryant{
+
+BloomFilter::BloomFilter(size_t capacity)
+    :m_capacity(capacity){
+    m_block_count = (capacity * BITS_PER_KEY + BLOCK_BITS - 1) / BLOCK_BITS;
+    if(m_block_count == 0){
+        m_block_count = 1;
+    }
+    m_blocks.reset(new Block[m_block_count]());
+}
+
+
+//块号取哈希的高32位(乘法映射到[0, m_block_count)), 块内的位取再打散一次的哈希, 每个位9bit
+size_t
+BloomFilter::locate(std::string_view name, uint64_t* masks) const{
+    uint64_t hash = UserStore::Hash(name);
+
+    uint64_t bits = hash * 0x9e3779b97f4a7c15ULL;
+    memset(masks, 0, sizeof(uint64_t) * (BLOCK_BITS / 64));
+    for(int i = 0; i < HASHES; ++i){
+        size_t bit = (bits >> (i * 9)) & (BLOCK_BITS - 1);
+        masks[bit >> 6] |= 1ULL << (bit & 63);
+    }
+    return ((hash >> 32) * m_block_count) >> 32;
+}
+
+
+void
+BloomFilter::add(std::string_view name){
+    uint64_t masks[BLOCK_BITS / 64];
+    Block& block = m_blocks[locate(name, masks)];
+    for(size_t i = 0; i < BLOCK_BITS / 64; ++i){
+        if(masks[i] && (block.words[i].load(std::memory_order_relaxed) & masks[i]) != masks[i]){
+            block.words[i].fetch_or(masks[i], std::memory_order_relaxed);
+        }
+    }
+    m_items.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+bool
+BloomFilter::may_contain(std::string_view name) const{
+    uint64_t masks[BLOCK_BITS / 64];
+    const Block& block = m_blocks[locate(name, masks)];
+    for(size_t i = 0; i < BLOCK_BITS / 64; ++i){
+        if((block.words[i].load(std::memory_order_relaxed) & masks[i]) != masks[i]){
+            m_negatives.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+    return true;
+}
+
+
+//一个不存在的用户名落在某一块上, 误判的概率是(块内置位比例)^HASHES, 对所有块取平均
+double
+BloomFilter::estimated_fpp() const{
+    double sum = 0;
+    for(size_t i = 0; i < m_block_count; ++i){
+        int set = 0;
+        for(const auto& word : m_blocks[i].words){
+            set += __builtin_popcountll(word.load(std::memory_order_relaxed));
+        }
+        sum += pow((double)set / BLOCK_BITS, HASHES);
+    }
+    return sum / m_block_count;
+}
+
+
+double
+BloomFilter::observed_fpp() const{
+    uint64_t fp = m_false_positives.load(std::memory_order_relaxed);
+    uint64_t negatives = m_negatives.load(std::memory_order_relaxed);
+    return fp + negatives ? (double)fp / (fp + negatives) : 0;
+}
+
+} // namespace bryant
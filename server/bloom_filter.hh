@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string_view>
+
+namespace bryant{
+
+// 用户名的分块Bloom filter(blocked Bloom filter), 和UserStore配合使用:
+// 不在里面的用户名一定不存在, 在里面的可能存在(误判), 需要再查UserStore或数据库。
+// 每个用户名的HASHES个位都落在同一个64字节的块(一条cache line)里, 查询只读一条cache line。
+// 置位用fetch_or, 查询不加锁, 多线程可以同时插入和查询; 只增不删,
+// 删掉的用户名留在里面只会让误判多一点。容量按构造时预计的用户数固定,
+// 超出容量后误判率上升, 可以从estimated_fpp()/observed_fpp()看到。
+class BloomFilter {
+public:
+    static const size_t BLOCK_BITS = 512;   // 一块的位数(64字节)
+    static const size_t BITS_PER_KEY = 10;  // 每个用户名平均占的位数
+    static const int HASHES = 7;            // 每个用户名在块内置的位数
+
+    /**
+     * @brief
+     *
+     * @param capacity 预计的用户数
+     */
+    explicit BloomFilter(size_t capacity);
+
+    BloomFilter(const BloomFilter&) = delete;
+    BloomFilter& operator=(const BloomFilter&) = delete;
+
+    /**
+     * @brief 加入用户名
+     */
+    void add(std::string_view name);
+
+    /**
+     * @brief 用户名可能存在; 返回false时一定不存在
+     */
+    bool may_contain(std::string_view name) const;
+
+    /**
+     * @brief 调用方查到may_contain返回true的用户名其实不存在时调用, 用来统计实际误判率
+     */
+    void false_positive() {m_false_positives.fetch_add(1, std::memory_order_relaxed);}
+
+    /**
+     * @brief 按每块置位的比例估算的误判率
+     */
+    double estimated_fpp() const;
+
+    /**
+     * @brief 实际误判率: 误判数 / (误判数 + 判定为不存在的次数)
+     */
+    double observed_fpp() const;
+
+    size_t capacity() const {return m_capacity;}
+
+    /**
+     * @brief 加入过的用户名数(重复加入的也计数)
+     */
+    size_t size() const {return m_items.load(std::memory_order_relaxed);}
+
+    /**
+     * @brief 占用的字节数
+     */
+    size_t bytes() const {return m_block_count * sizeof(Block);}
+
+private:
+    struct alignas(64) Block {
+        std::atomic<uint64_t> words[BLOCK_BITS / 64];
+    };
+
+    /**
+     * @brief 用户名所在的块号, 以及块内每个字要置的位
+     */
+    size_t locate(std::string_view name, uint64_t* masks) const;
+
+private:
+    size_t m_capacity;
+    size_t m_block_count;
+    std::unique_ptr<Block[]> m_blocks;
+    std::atomic<size_t> m_items{0};
+    mutable std::atomic<uint64_t> m_negatives{0};
+    std::atomic<uint64_t> m_false_positives{0};
+};
+
+} // namespace bryant
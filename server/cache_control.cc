@@ -0,0 +1,70 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "cache_control.hh"
+
+namespace bryant{
+
+
+CacheControl*
+CacheControl::get_instance(){
+    static CacheControl cache_control;
+    return &cache_control;
+}
+
+
+void
+CacheControl::init(const std::string& spec){
+    m_rules.clear();
+    m_default = -1;
+
+    size_t pos = 0;
+    while(pos < spec.size()){
+        size_t end = spec.find(',', pos);
+        if(end == std::string::npos){
+            end = spec.size();
+        }
+        std::string item = spec.substr(pos, end - pos);
+        pos = end + 1;
+
+        size_t eq = item.find('=');
+        if(eq == std::string::npos || eq == 0 || eq + 1 == item.size()){
+            continue;
+        }
+        std::string ext = item.substr(0, eq);
+        if(ext[0] == '.'){
+            ext.erase(0, 1);
+        }
+        int max_age = atoi(item.c_str() + eq + 1);
+        if(max_age < 0){
+            continue;
+        }
+
+        if(ext == "*"){
+            m_default = max_age;
+        }
+        else{
+            m_rules.emplace_back(ext, max_age);
+        }
+    }
+}
+
+
+int
+CacheControl::getMaxAge(const char* path) const{
+    const char* slash = strrchr(path, '/');
+    const char* dot = strrchr(path, '.');
+    if(!dot || (slash && dot < slash)){
+        return m_default;
+    }
+
+    for(const auto& rule : m_rules){
+        if(strcasecmp(rule.first.c_str(), dot + 1) == 0){
+            return rule.second;
+        }
+    }
+    return m_default;
+}
+
+} // namespace bryant
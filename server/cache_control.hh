@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bryant{
+
+// 按扩展名配置静态资源的Cache-Control: max-age
+// 规则格式: "gif=86400,jpg=86400,html=0,*=60", "*"为其余文件的默认值
+class CacheControl {
+public:
+    /**
+     * @brief Get the instance
+     *
+     * @return CacheControl*
+     */
+    static CacheControl* get_instance();
+
+    /**
+     * @brief 解析规则, 重复调用会覆盖之前的规则
+     *
+     * @param spec 逗号分隔的"扩展名=秒数", 无法解析的项被忽略
+     */
+    void init(const std::string& spec);
+
+    /**
+     * @brief 查找文件对应的max-age
+     *
+     * @param path 文件路径
+     * @return int 秒数, 没有匹配的规则返回-1(不发送Cache-Control)
+     */
+    int getMaxAge(const char* path) const;
+
+private:
+    CacheControl() = default;
+
+private:
+    std::vector<std::pair<std::string, int> > m_rules;  // 扩展名 -> max-age, 规则很少，顺序查找不分配内存
+    int m_default = -1;                                 // "*"的max-age
+};
+
+} // namespace bryant
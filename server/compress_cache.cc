@@ -0,0 +1,217 @@
+#include <fcntl.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "compress_cache.hh"
+
+namespace bryant{
+
+// 文本类型压缩效果明显，图片、视频本身已经压缩过
+static const char* compressible_exts[] = {
+    "html", "htm", "css", "js", "txt", "svg", "json", "xml"
+};
+
+
+CompressCache*
+CompressCache::get_instance(){
+    static CompressCache cache;
+    return &cache;
+}
+
+
+CompressCache::~CompressCache(){
+    if(m_thread){
+        m_mutex.lock();
+        m_stop = true;
+        m_mutex.unlock();
+        m_sem.post();
+        m_thread->join();
+    }
+}
+
+
+void
+CompressCache::init(size_t max_bytes, size_t min_size, int level){
+    m_mutex.lock();
+    m_max_bytes = max_bytes;
+    m_min_size = min_size;
+    m_level = level;
+    m_mutex.unlock();
+
+    if(max_bytes > 0 && !m_thread){
+        m_thread.reset(new Thread(std::bind(&CompressCache::run, this), "compress"));
+    }
+}
+
+
+bool
+CompressCache::isCompressible(const char* path){
+    const char* slash = strrchr(path, '/');
+    const char* dot = strrchr(path, '.');
+    if(!dot || (slash && dot < slash)){
+        return false;
+    }
+    for(const char* ext : compressible_exts){
+        if(strcasecmp(dot + 1, ext) == 0){
+            return true;
+        }
+    }
+    return false;
+}
+
+
+CompressCache::Variant::ptr
+CompressCache::lookup(const char* path, const struct stat& st){
+    if((size_t)st.st_size < m_min_size){
+        return nullptr;
+    }
+
+    std::string key(path);
+    Variant::ptr variant;
+
+    m_mutex.lock();
+    auto it = m_index.find(key);
+    if(it != m_index.end()){
+        variant = *it->second;
+        if(variant->st.st_ino == st.st_ino
+            && variant->st.st_size == st.st_size
+            && variant->st.st_mtime == st.st_mtime){
+            m_lru.splice(m_lru.begin(), m_lru, it->second);
+            m_mutex.unlock();
+            return variant;
+        }
+        eraseNoLock(key); // 原文件已变化
+    }
+
+    // 交给后台线程压缩，本次发送原文件
+    bool queued = false;
+    if(!m_stop && m_pending.insert(key).second){
+        m_queue.push_back(key);
+        queued = true;
+    }
+    m_mutex.unlock();
+
+    if(queued){
+        m_sem.post();
+    }
+    return nullptr;
+}
+
+
+void
+CompressCache::run(){
+    while(true){
+        m_sem.wait();
+
+        m_mutex.lock();
+        if(m_stop){
+            m_mutex.unlock();
+            return;
+        }
+        if(m_queue.empty()){
+            m_mutex.unlock();
+            continue;
+        }
+        std::string path = m_queue.front();
+        m_queue.pop_front();
+        m_mutex.unlock();
+
+        compress(path);
+
+        m_mutex.lock();
+        m_pending.erase(path);
+        m_mutex.unlock();
+    }
+}
+
+
+void
+CompressCache::compress(const std::string& path){
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        return;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0){
+        ::close(fd);
+        return;
+    }
+    char* addr = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(addr == MAP_FAILED){
+        return;
+    }
+
+    std::shared_ptr<Variant> variant = std::make_shared<Variant>();
+    variant->path = path;
+    variant->st = st;
+    bool ok = gzip(addr, st.st_size, m_level, variant->data);
+    munmap(addr, st.st_size);
+
+    // 压缩后没有明显变小的不缓存，发送原文件更省事
+    if(!ok || variant->data.size() > (size_t)st.st_size * 9 / 10){
+        return;
+    }
+
+    m_mutex.lock();
+    eraseNoLock(path);
+    m_lru.push_front(variant);
+    m_index[variant->path] = m_lru.begin();
+    m_bytes += variant->data.size();
+
+    // 超出总字节数时从尾部淘汰
+    while(!m_lru.empty() && m_bytes > m_max_bytes){
+        eraseNoLock(m_lru.back()->path);
+    }
+    m_mutex.unlock();
+}
+
+
+bool
+CompressCache::gzip(const char* data, size_t len, int level, std::string& out){
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    // windowBits加16生成gzip格式(带gzip头和crc)
+    if(deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK){
+        return false;
+    }
+
+    out.resize(deflateBound(&zs, len));
+    zs.next_in = (Bytef*)data;
+    zs.avail_in = len;
+    zs.next_out = (Bytef*)&out[0];
+    zs.avail_out = out.size();
+    int ret = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return ret == Z_STREAM_END;
+}
+
+
+void
+CompressCache::eraseNoLock(const std::string& path){
+    auto it = m_index.find(path);
+    if(it == m_index.end()){
+        return;
+    }
+    // 先删索引再删节点，path可能引用的就是被删节点里的字符串
+    LruList::iterator node = it->second;
+    m_index.erase(it);
+    m_bytes -= (*node)->data.size();
+    m_lru.erase(node);
+}
+
+
+size_t
+CompressCache::size(){
+    m_mutex.lock();
+    size_t n = m_lru.size();
+    m_mutex.unlock();
+    return n;
+}
+
+} // namespace bryant
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <sys/stat.h>
+#include <deque>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../util/locker.hh"
+#include "../fiberLibrary/thread.hh"
+
+namespace bryant{
+
+// 可压缩静态资源(html/css/js等)的gzip压缩结果缓存
+// 未命中时不在请求路径上压缩：把文件交给后台压缩线程，本次先发送原文件，
+// 压缩完成后之后的请求直接发送缓存的压缩结果
+class CompressCache {
+public:
+    /**
+     * @brief 压缩后的文件，以shared_ptr作为引用计数句柄
+     */
+    struct Variant {
+        using ptr = std::shared_ptr<const Variant>;
+
+        std::string path;       // 原文件路径
+        std::string data;       // gzip格式的压缩数据
+        struct stat st;         // 压缩时原文件的状态
+    };
+
+    /**
+     * @brief Get the instance
+     *
+     * @return CompressCache*
+     */
+    static CompressCache* get_instance();
+
+    /**
+     * @brief initialize cache parameters and start compress thread
+     *
+     * @param max_bytes 压缩结果总字节数上限, 0表示关闭
+     * @param min_size 小于该大小的文件不压缩
+     * @param level zlib压缩级别1-9
+     */
+    void init(size_t max_bytes, size_t min_size, int level);
+
+    /**
+     * @brief whether if cache is enabled
+     */
+    bool isEnabled() const {return m_max_bytes > 0;}
+
+    /**
+     * @brief 按扩展名判断是否是值得压缩的文本类型
+     */
+    static bool isCompressible(const char* path);
+
+    /**
+     * @brief 查找文件的压缩结果
+     * @details 未命中或原文件已变化时交给后台线程压缩
+     *
+     * @param path 原文件路径
+     * @param st 原文件当前的状态
+     * @return Variant::ptr 未命中返回nullptr
+     */
+    Variant::ptr lookup(const char* path, const struct stat& st);
+
+    /**
+     * @brief 当前缓存的文件数
+     */
+    size_t size();
+
+    /**
+     * @brief gzip压缩
+     *
+     * @param data
+     * @param len
+     * @param level
+     * @param out 压缩结果
+     * @return true 压缩成功
+     */
+    static bool gzip(const char* data, size_t len, int level, std::string& out);
+
+private:
+    CompressCache() = default;
+    ~CompressCache();
+
+    /**
+     * @brief 后台压缩线程
+     */
+    void run();
+
+    /**
+     * @brief 读取并压缩一个文件, 压缩效果不好时不缓存
+     */
+    void compress(const std::string& path);
+
+    /**
+     * @brief 删除缓存项, 需持有锁
+     */
+    void eraseNoLock(const std::string& path);
+
+private:
+    using LruList = std::list<Variant::ptr>;
+
+    Mutex m_mutex;
+    LruList m_lru;                                              // 头部为最近使用
+    std::unordered_map<std::string, LruList::iterator> m_index; // 路径 -> LRU节点
+    std::deque<std::string> m_queue;                            // 等待压缩的文件
+    std::unordered_set<std::string> m_pending;                  // 已在队列中或正在压缩的文件
+
+    Semaphore m_sem;            // 队列中的文件数
+    Thread::ptr m_thread;       // 后台压缩线程
+    bool m_stop = false;
+
+    size_t m_max_bytes = 0;     // 最大总字节数
+    size_t m_min_size = 0;      // 最小压缩大小
+    int m_level = 6;            // 压缩级别
+    size_t m_bytes = 0;         // 当前总字节数
+};
+
+} // namespace bryant
@@ -0,0 +1,171 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "file_cache.hh"
+#include "../util/util.hh"
+
+namespace bryant{
+
+
+FileCache::Entry::Entry(const std::string& path, int fd, const struct stat& st, char* addr)
+    :path(path),
+     fd(fd),
+     st(st),
+     addr(addr),
+     check_time(GetCurrentMS()){
+}
+
+
+FileCache::Entry::~Entry(){
+    if(addr){
+        munmap(addr, st.st_size);
+    }
+    if(fd != -1){
+        ::close(fd);
+    }
+}
+
+
+FileCache*
+FileCache::get_instance(){
+    static FileCache cache;
+    return &cache;
+}
+
+
+void
+FileCache::init(size_t max_entries, size_t max_bytes, uint64_t ttl_ms){
+    m_mutex.lock();
+    m_max_entries = max_entries;
+    m_max_bytes = max_bytes;
+    m_ttl = ttl_ms;
+    m_mutex.unlock();
+}
+
+
+FileCache::Entry::ptr
+FileCache::load(const std::string& path){
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        return nullptr;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)){
+        ::close(fd);
+        return nullptr;
+    }
+
+    char* addr = nullptr;
+    if(st.st_size > 0){
+        addr = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(addr == MAP_FAILED){
+            ::close(fd);
+            return nullptr;
+        }
+    }
+    return std::make_shared<Entry>(path, fd, st, addr);
+}
+
+
+FileCache::Entry::ptr
+FileCache::acquire(const std::string& path){
+    Entry::ptr entry;
+    uint64_t now = GetCurrentMS();
+
+    // step1: 查缓存，命中且未过期直接返回
+    m_mutex.lock();
+    auto it = m_index.find(path);
+    if(it != m_index.end()){
+        entry = *it->second;
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        if(now - entry->check_time < m_ttl){
+            m_mutex.unlock();
+            return entry;
+        }
+    }
+    m_mutex.unlock();
+
+    // step2: 过期则stat校验，文件未变化只刷新校验时间
+    if(entry){
+        struct stat st;
+        if(stat(path.c_str(), &st) == 0
+            && st.st_ino == entry->st.st_ino
+            && st.st_size == entry->st.st_size
+            && st.st_mtime == entry->st.st_mtime){
+            m_mutex.lock();
+            entry->check_time = now;
+            m_mutex.unlock();
+            return entry;
+        }
+    }
+
+    // step3: 未命中或文件已变化，在锁外加载
+    Entry::ptr fresh = load(path);
+
+    m_mutex.lock();
+    auto cur = m_index.find(path);
+    if(cur != m_index.end() && *cur->second != entry){
+        // 其他线程已经加载了新版本
+        Entry::ptr other = *cur->second;
+        m_mutex.unlock();
+        return other;
+    }
+    if(cur != m_index.end()){
+        eraseNoLock(path);
+    }
+    if(fresh && (size_t)fresh->st.st_size <= m_max_bytes){
+        insertNoLock(fresh);
+    }
+    m_mutex.unlock();
+    return fresh;
+}
+
+
+void
+FileCache::insertNoLock(const Entry::ptr& entry){
+    m_lru.push_front(entry);
+    m_index[entry->path] = m_lru.begin();
+    m_bytes += entry->st.st_size;
+
+    // 超出文件数或总字节数时从尾部淘汰
+    while(!m_lru.empty() && (m_lru.size() > m_max_entries || m_bytes > m_max_bytes)){
+        eraseNoLock(m_lru.back()->path);
+    }
+}
+
+
+void
+FileCache::eraseNoLock(const std::string& path){
+    auto it = m_index.find(path);
+    if(it == m_index.end()){
+        return;
+    }
+    // 先删索引再删节点，path可能引用的就是被删节点里的字符串
+    LruList::iterator node = it->second;
+    m_index.erase(it);
+    m_bytes -= (*node)->st.st_size;
+    m_lru.erase(node);
+}
+
+
+void
+FileCache::clear(){
+    m_mutex.lock();
+    m_index.clear();
+    m_lru.clear();
+    m_bytes = 0;
+    m_mutex.unlock();
+}
+
+
+size_t
+FileCache::size(){
+    m_mutex.lock();
+    size_t n = m_lru.size();
+    m_mutex.unlock();
+    return n;
+}
+
+} // namespace bryant
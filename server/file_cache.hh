@@ -0,0 +1,106 @@
+#pragma once
+
+#include <sys/stat.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "../util/locker.hh"
+
+namespace bryant{
+
+// 静态资源的打开文件缓存
+// 按解析后的路径缓存fd、stat和只读映射，命中且未过期时不产生任何文件系统调用
+// 所有IOManager工作线程共享同一份缓存
+class FileCache {
+public:
+    /**
+     * @brief 缓存项，以shared_ptr作为引用计数句柄
+     * @details 被淘汰后，仍在发送中的连接持有的句柄保证映射和fd有效，最后一个引用释放时才munmap/close
+     */
+    struct Entry {
+        using ptr = std::shared_ptr<Entry>;
+
+        Entry(const std::string& path, int fd, const struct stat& st, char* addr);
+        ~Entry();
+
+        std::string path;       // 文件路径
+        int fd;                 // 只读打开的文件描述符, 可供sendfile使用
+        struct stat st;         // 文件状态
+        char* addr;             // 只读映射地址, 空文件为nullptr
+        uint64_t check_time;    // 最近一次校验文件未变化的时间(ms)
+    };
+
+    /**
+     * @brief Get the instance
+     *
+     * @return FileCache*
+     */
+    static FileCache* get_instance();
+
+    /**
+     * @brief initialize cache parameters
+     *
+     * @param max_entries 最多缓存的文件数, 0表示关闭缓存
+     * @param max_bytes 缓存映射的总字节数上限
+     * @param ttl_ms 缓存项有效期, 过期后命中时重新stat校验
+     */
+    void init(size_t max_entries, size_t max_bytes, uint64_t ttl_ms);
+
+    /**
+     * @brief whether if cache is enabled
+     */
+    bool isEnabled() const {return m_max_entries > 0;}
+
+    /**
+     * @brief 获取path对应的缓存项，未命中时打开并映射
+     * @details 超过单文件上限的文件返回不入缓存的独立句柄
+     *
+     * @param path
+     * @return Entry::ptr 不是可读的普通文件时返回nullptr
+     */
+    Entry::ptr acquire(const std::string& path);
+
+    /**
+     * @brief 清空缓存
+     */
+    void clear();
+
+    /**
+     * @brief 当前缓存的文件数
+     */
+    size_t size();
+
+private:
+    FileCache() = default;
+
+    /**
+     * @brief open + fstat + mmap
+     */
+    Entry::ptr load(const std::string& path);
+
+    /**
+     * @brief 插入缓存项并按LRU淘汰, 需持有锁
+     */
+    void insertNoLock(const Entry::ptr& entry);
+
+    /**
+     * @brief 删除缓存项, 需持有锁
+     */
+    void eraseNoLock(const std::string& path);
+
+private:
+    using LruList = std::list<Entry::ptr>;
+
+    Mutex m_mutex;
+    LruList m_lru;                                              // 头部为最近使用
+    std::unordered_map<std::string, LruList::iterator> m_index; // 路径 -> LRU节点
+
+    size_t m_max_entries = 0;   // 最大文件数
+    size_t m_max_bytes = 0;     // 最大总字节数
+    uint64_t m_ttl = 0;         // 有效期(ms)
+    size_t m_bytes = 0;         // 当前总字节数
+};
+
+} // namespace bryant
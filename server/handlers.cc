@@ -0,0 +1,487 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
+
+#include "handlers.hh"
+#include "bloom_filter.hh"
+#include "user_snapshot.hh"
+#include "user_store.hh"
+#include "user_writer.hh"
+#include "../fiberLibrary/iomanager.hh"
+#include "../util/util.hh"
+
+namespace bryant{
+
+
+static const int LOAD_PAGE_ROWS = 1000;     // 预热时每页的行数
+static const int LOAD_RETRIES = 5;          // 一页连续失败的重试次数, 每次间隔1s
+static const uint64_t LOAD_RETRY_INTERVAL = 60 * 1000;  // 重试都失败后, 隔多久从断点接着加载(ms)
+static const size_t FILTER_MIN_USERS = 1 << 16;  // Bloom filter的最小容量
+static const uint64_t FILTER_REPORT_INTERVAL = 600 * 1000;  // 输出Bloom filter误判率的间隔(ms)
+static const size_t SNAPSHOT_REWRITE = 16;  // 补读的行超过快照的1/16时重写快照
+static const char SQL_SELECT_PASSWD[] = "SELECT passwd FROM user WHERE username = ? LIMIT 1";
+static const char SQL_SELECT_HIGH_WATER[] = "SELECT username FROM user WHERE id = ?";
+// 统计信息里的估计行数, 不用扫表
+static const char SQL_TABLE_ROWS[] = "SELECT TABLE_ROWS FROM information_schema.TABLES "
+                                     "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = 'user'";
+
+// 用户表加载完之前, 内存表里查不到的用户要再到数据库里查
+static std::atomic<bool> s_users_loaded{false};
+// 只加载用户名时, 数据库里所有用户名的Bloom filter, 加载完以后用来判定用户名不存在;
+// 为空时整张表(含密码)加载进内存表
+static std::unique_ptr<BloomFilter> s_user_filter;
+// 启动时映射的用户表快照, 挂在内存表底层, 进程退出前一直有效
+static std::unique_ptr<UserSnapshot> s_snapshot;
+
+
+// 预热读到的位置: 按自增主键id分页(快照也要记下读到的最大id); 表上没有id列时退回按用户名分页
+struct LoadCursor {
+    bool by_id = true;
+    uint64_t id = 0;                        // 读过的最大id
+    std::string name;                       // 读过的最后一个用户名
+    UserSnapshotWriter* writer = nullptr;   // 不为空时读到的用户同时写进新快照
+};
+
+
+// 读一页: 键集分页(WHERE id/username > 上一页最后一个), 按主键分页时每页只读主键上的一段;
+// 按用户名分页要求username上有索引(CREATE INDEX idx_username ON user(username)), 否则每页都是全表扫描加排序;
+// mysql_use_result逐行从socket读, 不在客户端缓存整页
+// @return 这一页的行数, -1出错
+static int load_page(MYSQL* mysql, LoadCursor& cursor){
+    std::string sql;
+    if(cursor.by_id) {
+        sql = s_user_filter ? "SELECT id, username FROM user WHERE id > "
+                            : "SELECT id, username, passwd FROM user WHERE id > ";
+        sql += std::to_string(cursor.id) + " ORDER BY id";
+    }
+    else {
+        sql = s_user_filter ? "SELECT username FROM user WHERE username "
+                            : "SELECT username, passwd FROM user WHERE username ";
+        if(cursor.name.empty()) {
+            sql += "IS NOT NULL";
+        }
+        else {
+            std::string escaped(cursor.name.size() * 2 + 1, '\0');
+            escaped.resize(mysql_real_escape_string(mysql, &escaped[0], cursor.name.data(), cursor.name.size()));
+            sql += "> '" + escaped + "'";
+        }
+        sql += " ORDER BY username";
+    }
+    sql += " LIMIT " + std::to_string(LOAD_PAGE_ROWS);
+
+    if(mysql_real_query(mysql, sql.data(), sql.size())) {
+        return -1;
+    }
+    MYSQL_RES* result = mysql_use_result(mysql);
+    if(!result) {
+        return -1;
+    }
+
+    UserStore* users = UserStore::get_instance();
+    int col = cursor.by_id ? 1 : 0;
+    int rows = 0;
+    while(MYSQL_ROW row = mysql_fetch_row(result)) {
+        unsigned long* lengths = mysql_fetch_lengths(result);
+        ++rows;
+        uint64_t id = cursor.by_id ? strtoull(row[0], nullptr, 10) : 0;
+        cursor.id = std::max(cursor.id, id);
+        if(!row[col]) {     // 按id分页时用户名可能是NULL
+            continue;
+        }
+        std::string_view name(row[col], lengths[col]);
+        std::string_view password = !s_user_filter && row[col + 1] ? std::string_view(row[col + 1], lengths[col + 1])
+                                                                   : std::string_view();
+        if(s_user_filter) {
+            s_user_filter->add(name);
+        }
+        else {
+            // 预热期间注册或者查库缓存进来的用户已经在表里, 不覆盖
+            users->insert(name, password);
+        }
+        if(cursor.writer) {
+            cursor.writer->append(name, password, id);
+        }
+        cursor.name.assign(name);
+    }
+    // 读到一半出错时mysql_fetch_row同样返回NULL
+    if(mysql_errno(mysql)) {
+        rows = -1;
+    }
+    mysql_free_result(result);
+    return rows;
+}
+
+
+// 映射快照, 到数据库核对high_water那一行还是同一个用户(表没有被清空重建), 通过后挂到内存表上,
+// 之后只需要补读id更大的行
+// @return 快照的high_water, 没有可用的快照时为0
+static uint64_t
+open_snapshot(Connection_pool* conn_pool, const std::string& path){
+    std::unique_ptr<UserSnapshot> snapshot(new UserSnapshot);
+    if(!snapshot->open(path)) {
+        return 0;
+    }
+    if(snapshot->high_water() > 0) {
+        MYSQL* mysql = nullptr;
+        connectionRAII mysqlcon(&mysql, conn_pool);
+        std::string name;
+        unsigned int err = mysql ? conn_pool->query_one(mysql, SQL_SELECT_HIGH_WATER, {std::to_string(snapshot->high_water())}, &name)
+                                 : CR_UNKNOWN_ERROR;
+        if(err || name != snapshot->high_water_name()) {
+            LOG_ERROR("[HANDLERS] snapshot %s is stale (high water %llu, error %u), reload the user table",
+                      path.c_str(), (unsigned long long)snapshot->high_water(), err);
+            return 0;
+        }
+    }
+    s_snapshot = std::move(snapshot);
+    UserStore::get_instance()->attach(s_snapshot.get());
+    LOG_INFO("[HANDLERS] snapshot %s: %zu users, high water %llu",
+             path.c_str(), s_snapshot->size(), (unsigned long long)s_snapshot->high_water());
+    return s_snapshot->high_water();
+}
+
+
+// 全量读完, 或者补读的行超过旧快照的1/SNAPSHOT_REWRITE时写新快照(旧快照的用户 + 补读的行);
+// 否则丢掉临时文件, 下次启动接着从旧快照补读
+static void
+save_snapshot(UserSnapshotWriter& writer){
+    if(s_snapshot && writer.size() * SNAPSHOT_REWRITE < s_snapshot->size()) {
+        writer.abort();
+        return;
+    }
+    size_t replayed = writer.size();
+    if(s_snapshot) {
+        s_snapshot->foreach([&writer](std::string_view name, std::string_view password) {
+            writer.append(name, password);
+        });
+    }
+    size_t total = writer.size();
+    if(writer.commit()) {
+        LOG_INFO("[HANDLERS] snapshot written: %zu users (%zu new)", total, replayed);
+    }
+}
+
+
+// 一次预热的进度, 重试都失败后留给定时器从断点接着读
+struct LoadState {
+    uint64_t begin = 0;
+    size_t total = 0;
+    LoadCursor cursor;
+    UserSnapshotWriter writer;
+};
+
+
+// 从state的位置接着分页读到最后一页, 连续失败LOAD_RETRIES次后隔LOAD_RETRY_INTERVAL再从断点重试
+static void
+continue_loading(Connection_pool* conn_pool, std::shared_ptr<LoadState> state){
+    LoadCursor& cursor = state->cursor;
+    int retries = 0;
+    while(true) {
+        // 每页都归还连接, 预热期间请求照样能拿到连接
+        MYSQL* mysql = conn_pool->get_connection(-1);
+        if(!mysql) {
+            // 连接池是空的(启动时就连不上数据库), 之后也不会有连接
+            LOG_ERROR("[HANDLERS] no mysql connection, user table will not be loaded by this process");
+            return;
+        }
+        int rows = load_page(mysql, cursor);
+        unsigned int err = rows < 0 ? mysql_errno(mysql) : 0;
+        conn_pool->release_connection(mysql);
+
+        if(rows < 0 && cursor.by_id && err == ER_BAD_FIELD_ERROR) {
+            // 用户表没有自增id列, 没法记录读到哪里, 不用快照
+            LOG_ERROR("[HANDLERS] user table has no id column, paging by username (needs an index on user.username), "
+                      "snapshot disabled");
+            UserStore::get_instance()->attach(nullptr);
+            state->writer.abort();
+            cursor = LoadCursor();
+            cursor.by_id = false;
+            continue;
+        }
+        if(rows < 0) {
+            LOG_ERROR("[HANDLERS] load users error: %u", err);
+            if(++retries > LOAD_RETRIES) {
+                break;
+            }
+            sleep(1);
+            continue;
+        }
+        retries = 0;
+        state->total += rows;
+        if(rows < LOAD_PAGE_ROWS) {
+            break;
+        }
+        // 让出, 排在已经就绪的请求后面
+        if(Scheduler* scheduler = Scheduler::GetThis()) {
+            scheduler->schedule(Fiber::GetThis());
+            Fiber::GetThis()->yield();
+        }
+    }
+
+    if(retries > LOAD_RETRIES) {
+        // 加载完之前内存表里查不到的用户都要再查一次数据库, 登录注册照常, 只是慢
+        IOManager* iom = IOManager::GetThis();
+        if(!iom) {
+            LOG_ERROR("[HANDLERS] give up loading users after %zu rows, users are looked up in mysql", state->total);
+            return;
+        }
+        LOG_ERROR("[HANDLERS] user table not loaded (%zu rows so far), users are looked up in mysql until it is, "
+                  "retry in %llu s", state->total, (unsigned long long)(LOAD_RETRY_INTERVAL / 1000));
+        iom->addTimer(LOAD_RETRY_INTERVAL, [conn_pool, state]() { continue_loading(conn_pool, state); });
+        return;
+    }
+
+    MarkUsersLoaded();
+    LOG_INFO("[HANDLERS] %zu users loaded in %llu ms", state->total, (unsigned long long)(GetCurrentMS() - state->begin));
+    if(cursor.writer) {
+        save_snapshot(state->writer);
+    }
+    if(s_user_filter) {
+        ReportUserFilter();
+        if(IOManager* iom = IOManager::GetThis()) {
+            iom->addTimer(FILTER_REPORT_INTERVAL, ReportUserFilter, true);
+        }
+    }
+}
+
+
+static void
+load_users(Connection_pool* conn_pool, const std::string& snapshot_path){
+    std::shared_ptr<LoadState> state(new LoadState);
+    state->begin = GetCurrentMS();
+    if(!snapshot_path.empty() && !s_user_filter) {
+        state->cursor.id = open_snapshot(conn_pool, snapshot_path);
+        if(state->writer.open(snapshot_path)) {
+            state->cursor.writer = &state->writer;
+        }
+    }
+    continue_loading(conn_pool, state);
+}
+
+
+// 按统计信息估计用户表的行数, 用来确定Bloom filter的容量
+static size_t
+estimate_users(Connection_pool* conn_pool){
+    MYSQL* mysql = nullptr;
+    connectionRAII mysqlcon(&mysql, conn_pool);
+    if(!mysql || mysql_query(mysql, SQL_TABLE_ROWS)) {
+        return 0;
+    }
+    MYSQL_RES* result = mysql_store_result(mysql);
+    if(!result) {
+        return 0;
+    }
+    size_t rows = 0;
+    MYSQL_ROW row = mysql_fetch_row(result);
+    if(row && row[0]) {
+        rows = strtoull(row[0], nullptr, 10);
+    }
+    mysql_free_result(result);
+    return rows;
+}
+
+
+void
+LoadUsers(Connection_pool* conn_pool, bool load_passwords, const std::string& snapshot){
+    if(!load_passwords) {
+        // 留出一倍的余量给之后注册的用户
+        s_user_filter.reset(new BloomFilter(std::max(estimate_users(conn_pool) * 2, FILTER_MIN_USERS)));
+    }
+
+    IOManager* iom = IOManager::GetThis();
+    if(!iom) {
+        load_users(conn_pool, snapshot);
+        return;
+    }
+    // 后台协程分页加载, 服务器不用等整张表读完就能开始服务
+    iom->schedule([conn_pool, snapshot](){ load_users(conn_pool, snapshot); });
+}
+
+
+void
+MarkUsersLoaded(){
+    s_users_loaded = true;
+}
+
+
+void
+ReportUserFilter(){
+    if(!s_user_filter) {
+        return;
+    }
+    LOG_INFO("[HANDLERS] user filter: %zu/%zu users, %zu bytes, estimated fpp %.6f, observed fpp %.6f",
+             s_user_filter->size(), s_user_filter->capacity(), s_user_filter->bytes(),
+             s_user_filter->estimated_fpp(), s_user_filter->observed_fpp());
+}
+
+
+// 到数据库里查用户, 查到时顺便放进内存表
+// @return 1查到, 0没有这个用户, -1出错
+static int
+find_in_db(std::string_view name, std::string* password){
+    Connection_pool* conn_pool = Connection_pool::get_instance();
+    MYSQL* mysql = nullptr;
+    connectionRAII mysqlcon(&mysql, conn_pool);
+    unsigned int err = mysql ? conn_pool->query_one(mysql, SQL_SELECT_PASSWD, {name}, password) : CR_UNKNOWN_ERROR;
+    if(err == MYSQL_NO_DATA) {
+        return 0;
+    }
+    if(err) {
+        LOG_ERROR("[HANDLERS] select user error: %u", err);
+        return -1;
+    }
+    UserStore::get_instance()->insert(name, *password);
+    if(s_user_filter) {
+        s_user_filter->add(name);
+    }
+    return 1;
+}
+
+
+// 内存表里有所有用户: 整表加载完成, loaded是调用方读到的s_users_loaded
+static bool
+store_complete(bool loaded){
+    return loaded && !s_user_filter;
+}
+
+
+// 内存表里没有的用户, 还要不要到数据库里查: 加载完以后Bloom filter里没有的一定不存在
+// @param loaded 调用方读到的s_users_loaded; 只读一次, 否则加载恰好在两次读之间完成时,
+//               整表加载(没有Bloom filter)的请求也会走到下面用Bloom filter的分支
+// @return 1查到, 0没有这个用户, -1出错
+static int
+find_missing(std::string_view name, std::string* password, bool loaded){
+    if(loaded && s_user_filter && !s_user_filter->may_contain(name)) {
+        return 0;
+    }
+    int found = find_in_db(name, password);
+    if(found == 0 && loaded && s_user_filter) {
+        s_user_filter->false_positive();
+    }
+    return found;
+}
+
+
+// 从表单"user=xxx&password=yyy"中取出用户名和密码
+static bool parse_form(std::string_view body, char* name, size_t name_size, char* password, size_t password_size){
+    size_t amp = body.find('&');
+    if(body.size() < 5 || amp == std::string_view::npos || amp < 5) {
+        return false;
+    }
+    size_t name_len = std::min(amp - 5, name_size - 1);  // 因为body[5]才是信息
+    memcpy(name, body.data() + 5, name_len);
+    name[name_len] = '\0';
+
+    size_t pwd = std::min(amp + 10, body.size());       // 跳过"&password="
+    size_t pwd_len = std::min(body.size() - pwd, password_size - 1);
+    memcpy(password, body.data() + pwd, pwd_len);
+    password[pwd_len] = '\0';
+    return true;
+}
+
+
+// 登录：用户名和密码都匹配时进入欢迎页
+static void handle_login(const HttpRequest& req, HttpResponse& resp){
+    char name[100], password[100];
+    if(!parse_form(req.body, name, sizeof(name), password, sizeof(password))) {
+        resp.status = 400;
+        return;
+    }
+
+    UserStore* users = UserStore::get_instance();
+    bool loaded = s_users_loaded;
+    bool ok = users->check(name, password);
+    if(!ok && !store_complete(loaded) && !users->find(name)) {
+        std::string stored;
+        ok = find_missing(name, &stored, loaded) > 0 && stored == password;
+    }
+    resp.file = ok ? "/welcome.html" : "/logError.html";
+}
+
+
+// 注册：没有重名时写入数据库，成功后回到登录页
+static void handle_register(const HttpRequest& req, HttpResponse& resp){
+    char name[100], password[100];
+    if(!parse_form(req.body, name, sizeof(name), password, sizeof(password))) {
+        resp.status = 400;
+        return;
+    }
+
+    // 先在内存表里占住用户名(同名并发注册只有一个成功)，再在锁外写数据库，失败时回滚
+    UserStore* users = UserStore::get_instance();
+    bool loaded = s_users_loaded;
+    resp.file = "/registerError.html";
+    if(!store_complete(loaded) && !users->find(name)) {
+        std::string stored;
+        int found = find_missing(name, &stored, loaded);
+        if(found < 0) {
+            resp.status = 500;
+            return;
+        }
+        if(found > 0) {
+            return;
+        }
+    }
+    if(!users->insert(name, password)) {
+        return;
+    }
+    if(s_user_filter) {
+        s_user_filter->add(name);
+    }
+
+    // 写库交给写回队列, 攒成批写入; 失败时队列会把用户从内存表里删掉
+    if(!UserWriter::get_instance()->write(name, password)) {
+        return;
+    }
+    resp.file = "/log.html";
+}
+
+
+// 固定跳转到某个页面
+static Router::Handler page(const char* file){
+    return [file](const HttpRequest&, HttpResponse& resp) {
+        resp.file = file;
+    };
+}
+
+
+void
+RegisterRoutes(Router* router){
+    uint32_t get_post = ROUTE_GET | ROUTE_POST; // 页面里的表单都用POST跳转
+
+    router->addRoute(get_post, "/", page("/judge.html"));
+    router->addRoute(get_post, "/0", page("/register.html"));
+    router->addRoute(get_post, "/1", page("/log.html"));
+    router->addRoute(ROUTE_POST, "/2CGISQL.cgi", handle_login);
+    router->addRoute(ROUTE_POST, "/3CGISQL.cgi", handle_register);
+    router->addRoute(get_post, "/5", page("/picture.html"));
+    router->addRoute(get_post, "/6", page("/video.html"));
+    router->addRoute(get_post, "/7", page("/fans.html"));
+}
+
+
+// 回显收到的每条消息, 直到对端关闭
+static void
+ws_echo(WebSocket& ws){
+    WebSocket::Message msg;
+    while(ws.recv(msg)){
+        if(!ws.send(msg.data, msg.opcode)){
+            break;
+        }
+    }
+}
+
+
+void
+RegisterWebSocketRoutes(WebSocketRouter* router){
+    router->addRoute("/ws/echo", ws_echo);
+}
+
+} // namespace bryant
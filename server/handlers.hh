@@ -0,0 +1,49 @@
+#pragma once
+
+#include "router.hh"
+#include "websocket.hh"
+#include "../CGImysql/sql_connection_pool.hh"
+
+namespace bryant{
+
+// 内置的请求处理函数：首页、各页面的跳转、登录和注册
+
+/**
+ * @brief 从数据库加载用户表, 启动时调用一次
+ * @details 在IOManager里调用时由后台协程分页加载, 立即返回;
+ *          加载完之前登录/注册在内存表里查不到的用户会再查一次数据库
+ *
+ * @param conn_pool
+ * @param load_passwords false时只把用户名加载进Bloom filter, 内存表只缓存查过的用户,
+ *                       登录时按需查库, 注册时Bloom filter里没有的用户名不用查库
+ * @param snapshot 不为空且load_passwords时使用的用户表快照文件(需要user表有自增主键id):
+ *                 启动时映射快照立即可查, 核对high_water后只补读id更大的行; 读完后按需重写快照
+ */
+void LoadUsers(Connection_pool* conn_pool, bool load_passwords = true, const std::string& snapshot = "");
+
+/**
+ * @brief 标记用户表已加载完: 之后内存表(或Bloom filter)里没有的用户不再查库
+ * @details 后台加载读完最后一页时调用
+ */
+void MarkUsersLoaded();
+
+/**
+ * @brief 输出用户名Bloom filter的大小和误判率(只加载用户名时), 加载完后定时调用
+ */
+void ReportUserFilter();
+
+/**
+ * @brief 注册内置路由
+ *
+ * @param router
+ */
+void RegisterRoutes(Router* router);
+
+/**
+ * @brief 注册内置的WebSocket路由(/ws/echo回显)
+ *
+ * @param router
+ */
+void RegisterWebSocketRoutes(WebSocketRouter* router);
+
+} // namespace bryant
@@ -0,0 +1,418 @@
+#include <string.h>
+
+#include "hpack.hh"
+
+namespace bryant{
+
+
+// 静态表(RFC 7541 附录A), 下标0不用
+struct StaticEntry {
+    std::string_view name;
+    std::string_view value;
+};
+
+static const StaticEntry s_static_table[] = {
+    {"", ""},
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+static const size_t STATIC_TABLE_SIZE = sizeof(s_static_table) / sizeof(s_static_table[0]) - 1; // 61
+
+
+// Huffman码长(RFC 7541 附录B), 256为EOS
+// 码字是规范Huffman码：按(码长, 符号)排序后依次分配，所以只需要码长就能还原码表
+static const uint8_t s_huffman_len[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,   // 0-15
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,   // 16-31
+     6, 10, 10, 12, 13,  6,  8, 11, 10, 10,  8, 11,  8,  6,  6,  6,   // 32-47
+     5,  5,  5,  6,  6,  6,  6,  6,  6,  6,  7,  8, 15,  6, 12, 10,   // 48-63
+    13,  6,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,   // 64-79
+     7,  7,  7,  7,  7,  7,  7,  7,  8,  7,  8, 13, 19, 13, 14,  6,   // 80-95
+    15,  5,  6,  5,  6,  5,  6,  6,  6,  5,  7,  7,  6,  6,  6,  5,   // 96-111
+     6,  7,  6,  5,  5,  6,  7,  7,  7,  7,  7, 15, 11, 14, 13, 28,   // 112-127
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,   // 128-143
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,   // 144-159
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,   // 160-175
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,   // 176-191
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,   // 192-207
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,   // 208-223
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,   // 224-239
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,   // 240-255
+    30,                                                               // EOS
+};
+
+static const int HUFFMAN_MAX_LEN = 30;
+static const int HUFFMAN_EOS = 256;
+
+
+// 由码长生成的编码表和规范Huffman解码表
+struct HuffmanTable {
+    uint32_t code[257];                     // 符号 -> 码字
+    uint32_t first[HUFFMAN_MAX_LEN + 1];    // 每个码长的第一个码字
+    uint16_t count[HUFFMAN_MAX_LEN + 1];    // 每个码长的符号数
+    uint16_t offset[HUFFMAN_MAX_LEN + 1];   // 每个码长的第一个符号在symbols中的位置
+    uint16_t symbols[257];                  // 按(码长, 符号)排序的符号
+
+    HuffmanTable(){
+        memset(count, 0, sizeof(count));
+        for(int sym = 0; sym <= HUFFMAN_EOS; ++sym){
+            ++count[s_huffman_len[sym]];
+        }
+        uint32_t next = 0;
+        uint16_t pos = 0;
+        for(int len = 1; len <= HUFFMAN_MAX_LEN; ++len){
+            first[len] = next;
+            offset[len] = pos;
+            for(int sym = 0; sym <= HUFFMAN_EOS; ++sym){
+                if(s_huffman_len[sym] == len){
+                    code[sym] = next++;
+                    symbols[pos++] = sym;
+                }
+            }
+            next <<= 1;
+        }
+    }
+};
+
+static const HuffmanTable s_huffman;
+
+
+bool
+HuffmanDecode(const uint8_t* data, size_t len, std::string& out){
+    uint32_t code = 0;
+    int code_len = 0;
+    for(size_t i = 0; i < len; ++i){
+        uint8_t byte = data[i];
+        for(int bit = 7; bit >= 0; --bit){
+            code = (code << 1) | ((byte >> bit) & 1);
+            ++code_len;
+            if(code - s_huffman.first[code_len] < s_huffman.count[code_len]){
+                int sym = s_huffman.symbols[s_huffman.offset[code_len] + code - s_huffman.first[code_len]];
+                if(sym == HUFFMAN_EOS){
+                    return false;
+                }
+                out.push_back((char)sym);
+                code = 0;
+                code_len = 0;
+            }
+            else if(code_len >= HUFFMAN_MAX_LEN){
+                return false;
+            }
+        }
+    }
+    // 结尾的填充是EOS的前缀(全1)，不超过7位
+    return code_len <= 7 && code == (1u << code_len) - 1;
+}
+
+
+void
+HuffmanEncode(std::string_view in, std::string& out){
+    uint64_t bits = 0;
+    int nbits = 0;
+    for(unsigned char c : in){
+        bits = (bits << s_huffman_len[c]) | s_huffman.code[c];
+        nbits += s_huffman_len[c];
+        while(nbits >= 8){
+            nbits -= 8;
+            out.push_back((char)(bits >> nbits));
+        }
+    }
+    if(nbits > 0){ // 用EOS的高位(全1)补齐
+        out.push_back((char)((bits << (8 - nbits)) | (0xff >> nbits)));
+    }
+}
+
+
+size_t
+HuffmanEncodedLength(std::string_view in){
+    size_t nbits = 0;
+    for(unsigned char c : in){
+        nbits += s_huffman_len[c];
+    }
+    return (nbits + 7) / 8;
+}
+
+
+// 解码HPACK整数，前缀之外的高位由调用者处理
+static bool decode_int(const uint8_t*& p, const uint8_t* end, int prefix_bits, uint64_t& value){
+    if(p == end){
+        return false;
+    }
+    uint64_t mask = (1u << prefix_bits) - 1;
+    value = *p++ & mask;
+    if(value < mask){
+        return true;
+    }
+    int shift = 0;
+    while(true){
+        if(p == end || shift > 28){ // 超过2^35的值一定是错误的
+            return false;
+        }
+        uint8_t byte = *p++;
+        value += (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+        if(!(byte & 0x80)){
+            return true;
+        }
+    }
+}
+
+
+// 解码字符串(H位 + 7位前缀长度)
+static bool decode_string(const uint8_t*& p, const uint8_t* end, std::string& out){
+    if(p == end){
+        return false;
+    }
+    bool huffman = (*p & 0x80) != 0;
+    uint64_t len;
+    if(!decode_int(p, end, 7, len) || len > (uint64_t)(end - p)){
+        return false;
+    }
+    out.clear();
+    if(huffman){
+        if(!HuffmanDecode(p, len, out)){
+            return false;
+        }
+    }
+    else{
+        out.assign((const char*)p, len);
+    }
+    p += len;
+    return true;
+}
+
+
+HpackDecoder::HpackDecoder(size_t max_table_size, size_t max_header_list)
+    :m_max_size(max_table_size)
+    ,m_settings_max(max_table_size)
+    ,m_max_header_list(max_header_list){
+}
+
+
+bool
+HpackDecoder::lookup(uint64_t index, std::string& name, std::string* value) const{
+    if(index == 0){
+        return false;
+    }
+    if(index <= STATIC_TABLE_SIZE){
+        name.assign(s_static_table[index].name.data(), s_static_table[index].name.size());
+        if(value){
+            value->assign(s_static_table[index].value.data(), s_static_table[index].value.size());
+        }
+        return true;
+    }
+    index -= STATIC_TABLE_SIZE + 1;
+    if(index >= m_dynamic.size()){
+        return false;
+    }
+    name = m_dynamic[index].name;
+    if(value){
+        *value = m_dynamic[index].value;
+    }
+    return true;
+}
+
+
+void
+HpackDecoder::evict(size_t max){
+    while(m_size > max && !m_dynamic.empty()){
+        const HpackHeader& oldest = m_dynamic.back();
+        m_size -= oldest.name.size() + oldest.value.size() + 32;
+        m_dynamic.pop_back();
+    }
+}
+
+
+void
+HpackDecoder::insert(const std::string& name, const std::string& value){
+    size_t entry_size = name.size() + value.size() + 32;
+    if(entry_size > m_max_size){ // 比整个表还大，结果是清空动态表
+        evict(0);
+        return;
+    }
+    evict(m_max_size - entry_size);
+    m_dynamic.push_front(HpackHeader{name, value});
+    m_size += entry_size;
+}
+
+
+bool
+HpackDecoder::decode(const uint8_t* data, size_t len, std::vector<HpackHeader>& out){
+    const uint8_t* p = data;
+    const uint8_t* end = data + len;
+    size_t list_size = 0;
+    bool field_seen = false; // 动态表大小更新只能出现在块的开头
+
+    while(p < end){
+        uint8_t byte = *p;
+        uint64_t index;
+        HpackHeader header;
+
+        if(byte & 0x80){ // 索引表示
+            if(!decode_int(p, end, 7, index) || !lookup(index, header.name, &header.value)){
+                return false;
+            }
+        }
+        else if((byte & 0xe0) == 0x20){ // 动态表大小更新
+            if(field_seen || !decode_int(p, end, 5, index) || index > m_settings_max){
+                return false;
+            }
+            m_max_size = index;
+            evict(m_max_size);
+            continue;
+        }
+        else{ // 字面量: 01 加入动态表, 0000 不加入, 0001 永不加入
+            bool indexing = (byte & 0xc0) == 0x40;
+            if(!decode_int(p, end, indexing ? 6 : 4, index)){
+                return false;
+            }
+            if(index == 0){
+                if(!decode_string(p, end, header.name)){
+                    return false;
+                }
+            }
+            else if(!lookup(index, header.name, nullptr)){
+                return false;
+            }
+            if(!decode_string(p, end, header.value)){
+                return false;
+            }
+            if(indexing){
+                insert(header.name, header.value);
+            }
+        }
+
+        field_seen = true;
+        list_size += header.name.size() + header.value.size() + 32;
+        if(list_size > m_max_header_list){
+            return false;
+        }
+        out.push_back(std::move(header));
+    }
+    return true;
+}
+
+
+void
+HpackEncoder::encodeInt(uint64_t value, int prefix_bits, uint8_t first_byte, std::string& out){
+    uint64_t mask = (1u << prefix_bits) - 1;
+    if(value < mask){
+        out.push_back((char)(first_byte | value));
+        return;
+    }
+    out.push_back((char)(first_byte | mask));
+    value -= mask;
+    while(value >= 0x80){
+        out.push_back((char)((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+
+void
+HpackEncoder::encodeString(std::string_view str, std::string& out){
+    size_t huffman_len = HuffmanEncodedLength(str);
+    if(huffman_len < str.size()){
+        encodeInt(huffman_len, 7, 0x80, out);
+        HuffmanEncode(str, out);
+    }
+    else{
+        encodeInt(str.size(), 7, 0, out);
+        out.append(str.data(), str.size());
+    }
+}
+
+
+void
+HpackEncoder::encodeStatus(int status, std::string& out){
+    // 静态表8~14为常用状态码的完整表项
+    for(size_t i = 8; i <= 14; ++i){
+        const std::string_view& value = s_static_table[i].value;
+        if(value[0] - '0' == status / 100 && value[1] - '0' == status / 10 % 10 && value[2] - '0' == status % 10){
+            out.push_back((char)(0x80 | i));
+            return;
+        }
+    }
+    char buf[4] = {(char)('0' + status / 100 % 10), (char)('0' + status / 10 % 10), (char)('0' + status % 10), 0};
+    encodeInt(8, 4, 0x00, out);
+    encodeString(std::string_view(buf, 3), out);
+}
+
+
+void
+HpackEncoder::encode(std::string_view name, std::string_view value, std::string& out){
+    // 不加入动态表的字面量，名字在静态表里时只写索引
+    for(size_t i = 15; i <= STATIC_TABLE_SIZE; ++i){
+        if(s_static_table[i].name == name){
+            encodeInt(i, 4, 0x00, out);
+            encodeString(value, out);
+            return;
+        }
+    }
+    out.push_back(0x00);
+    encodeString(name, out);
+    encodeString(value, out);
+}
+
+} // namespace bryant
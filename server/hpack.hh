@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bryant{
+
+// HPACK(RFC 7541): HTTP/2的请求头压缩
+
+/**
+ * @brief 解码出的一个请求头
+ */
+struct HpackHeader {
+    std::string name;
+    std::string value;
+};
+
+/**
+ * @brief Huffman解码
+ *
+ * @param data
+ * @param len
+ * @param out 追加到out后面
+ * @return false 编码错误(含EOS、填充超过7位或填充不全为1)
+ */
+bool HuffmanDecode(const uint8_t* data, size_t len, std::string& out);
+
+/**
+ * @brief Huffman编码, 追加到out后面
+ */
+void HuffmanEncode(std::string_view in, std::string& out);
+
+/**
+ * @brief Huffman编码后的字节数
+ */
+size_t HuffmanEncodedLength(std::string_view in);
+
+
+// 请求头块解码器，每个连接一个，动态表在连接的所有请求头块之间共享
+class HpackDecoder {
+public:
+    static const size_t DEFAULT_TABLE_SIZE = 4096;  // SETTINGS_HEADER_TABLE_SIZE的默认值
+
+    /**
+     * @brief Construct a new Hpack Decoder object
+     *
+     * @param max_table_size 动态表大小上限(我方通告的SETTINGS_HEADER_TABLE_SIZE)
+     * @param max_header_list 解码出的请求头总大小上限(名字+值+32)
+     */
+    explicit HpackDecoder(size_t max_table_size = DEFAULT_TABLE_SIZE, size_t max_header_list = 64 * 1024);
+
+    /**
+     * @brief 解码一个完整的请求头块
+     *
+     * @param data
+     * @param len
+     * @param out 按顺序追加解码出的请求头
+     * @return false 解码错误, 连接必须以COMPRESSION_ERROR关闭
+     */
+    bool decode(const uint8_t* data, size_t len, std::vector<HpackHeader>& out);
+
+    /**
+     * @brief 动态表当前大小
+     */
+    size_t tableSize() const {return m_size;}
+
+    /**
+     * @brief 动态表的条目数
+     */
+    size_t tableEntries() const {return m_dynamic.size();}
+
+private:
+    /**
+     * @brief 按索引取表项(1~61为静态表, 之后为动态表)
+     */
+    bool lookup(uint64_t index, std::string& name, std::string* value) const;
+
+    /**
+     * @brief 插入动态表, 按大小淘汰最旧的表项
+     */
+    void insert(const std::string& name, const std::string& value);
+
+    /**
+     * @brief 淘汰到不超过max
+     */
+    void evict(size_t max);
+
+private:
+    std::deque<HpackHeader> m_dynamic;  // 头部为最新的表项
+    size_t m_size = 0;                  // 动态表当前大小
+    size_t m_max_size;                  // 动态表当前上限(对端可以用大小更新调小)
+    size_t m_settings_max;              // 我方通告的上限
+    size_t m_max_header_list;           // 请求头总大小上限
+};
+
+
+// 响应头编码器
+// 只引用静态表，不使用动态表，所以对端的SETTINGS_HEADER_TABLE_SIZE不影响编码结果，也不用维护状态
+class HpackEncoder {
+public:
+    /**
+     * @brief 编码:status
+     */
+    static void encodeStatus(int status, std::string& out);
+
+    /**
+     * @brief 编码一个响应头(名字必须小写), 不加入动态表
+     */
+    static void encode(std::string_view name, std::string_view value, std::string& out);
+
+    /**
+     * @brief 编码HPACK整数
+     *
+     * @param value
+     * @param prefix_bits 前缀位数(1~8)
+     * @param first_byte 第一个字节中前缀之外的高位
+     * @param out
+     */
+    static void encodeInt(uint64_t value, int prefix_bits, uint8_t first_byte, std::string& out);
+
+    /**
+     * @brief 编码字符串, Huffman更短时使用Huffman
+     */
+    static void encodeString(std::string_view str, std::string& out);
+};
+
+} // namespace bryant
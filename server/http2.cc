@@ -0,0 +1,782 @@
+#include <string.h>
+#include <sys/ioctl.h>
+#include <algorithm>
+
+#include "http2.hh"
+#include "http_conn.hh"
+#include "router.hh"
+#include "cache_control.hh"
+#include "../util/util.hh"
+
+namespace bryant{
+
+const char Http2Conn::PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+// 帧类型
+enum FrameType : uint8_t {
+    FRAME_DATA = 0x0,
+    FRAME_HEADERS = 0x1,
+    FRAME_PRIORITY = 0x2,
+    FRAME_RST_STREAM = 0x3,
+    FRAME_SETTINGS = 0x4,
+    FRAME_PUSH_PROMISE = 0x5,
+    FRAME_PING = 0x6,
+    FRAME_GOAWAY = 0x7,
+    FRAME_WINDOW_UPDATE = 0x8,
+    FRAME_CONTINUATION = 0x9
+};
+
+// 帧标志
+enum FrameFlag : uint8_t {
+    FLAG_END_STREAM = 0x1,
+    FLAG_ACK = 0x1,
+    FLAG_END_HEADERS = 0x4,
+    FLAG_PADDED = 0x8,
+    FLAG_PRIORITY = 0x20
+};
+
+// SETTINGS参数
+enum SettingId : uint16_t {
+    SETTINGS_HEADER_TABLE_SIZE = 0x1,
+    SETTINGS_ENABLE_PUSH = 0x2,
+    SETTINGS_MAX_CONCURRENT_STREAMS = 0x3,
+    SETTINGS_INITIAL_WINDOW_SIZE = 0x4,
+    SETTINGS_MAX_FRAME_SIZE = 0x5,
+    SETTINGS_MAX_HEADER_LIST_SIZE = 0x6
+};
+
+static const size_t FRAME_HEADER_LEN = 9;
+static const int64_t MAX_WINDOW = 0x7fffffff;
+static const size_t MAX_HEADER_BLOCK = 64 * 1024;  // 拼接中的请求头块上限
+static const size_t READ_SIZE = 32 * 1024;         // 每次读取的大小
+
+
+static uint32_t read_u32(const uint8_t* p){
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+
+static void append_u32(std::string& out, uint32_t v){
+    char buf[4] = {(char)(v >> 24), (char)(v >> 16), (char)(v >> 8), (char)v};
+    out.append(buf, 4);
+}
+
+
+Http2Conn::Http2Conn(sylar::Socket::ptr client, const char* doc_root)
+    :m_client(client),
+     m_root(doc_root){
+}
+
+
+Http2Conn::~Http2Conn(){
+}
+
+
+void
+Http2Conn::run(std::string_view initial, size_t preface_read, const Http2Upgrade* upgrade){
+    m_in.assign(initial.data(), initial.size());
+    m_preface_left = PREFACE_LEN - preface_read;
+
+    // 服务器的连接前言：SETTINGS，其余参数都用默认值
+    writeFrameHeader(6, FRAME_SETTINGS, 0, 0);
+    const char settings[6] = {0, SETTINGS_MAX_CONCURRENT_STREAMS, 0, 0, 0, (char)MAX_CONCURRENT_STREAMS};
+    m_out.append(settings, sizeof(settings));
+
+    // 升级前的请求是流1，请求已经完整(半关闭)
+    if(upgrade) {
+        if(!applySettings((const uint8_t*)upgrade->settings.data(), upgrade->settings.size())) {
+            flush();
+            return;
+        }
+        std::unique_ptr<Stream> stream(new Stream);
+        stream->id = 1;
+        stream->send_window = m_peer_initial_window;
+        stream->remote_closed = true;
+        stream->headers = upgrade->headers;
+        Stream& s = *stream;
+        m_streams[1] = std::move(stream);
+        m_last_stream_id = 1;
+        respond(s);
+    }
+
+    while(m_client->isConnected()) {
+        bool ok = processInput();
+        bool more = ok && writeData();
+        if(!flush() || !ok) {
+            break;
+        }
+        if(m_goaway && m_streams.empty()) { // 对端要关闭连接，已有的流都处理完了
+            break;
+        }
+
+        // 还有可以发送的数据时只读已经到达的，不等待
+        if(more) {
+            int avail = 0;
+            if(ioctl(m_client->getSocket(), FIONREAD, &avail) < 0 || avail <= 0) {
+                continue;
+            }
+        }
+
+        if(m_in_pos > 0) {
+            m_in.erase(0, m_in_pos);
+            m_in_pos = 0;
+        }
+        size_t old = m_in.size();
+        m_in.resize(old + READ_SIZE);
+        int n = m_client->recv(&m_in[old], READ_SIZE, 0);
+        if(n <= 0) {
+            break;
+        }
+        m_in.resize(old + n);
+    }
+}
+
+
+//依次处理缓冲区里的完整帧，不完整的帧留到下次读取
+bool
+Http2Conn::processInput(){
+    // 连接前言
+    if(m_preface_left > 0) {
+        size_t n = std::min(m_preface_left, m_in.size() - m_in_pos);
+        if(memcmp(m_in.data() + m_in_pos, PREFACE + PREFACE_LEN - m_preface_left, n) != 0) {
+            return false;
+        }
+        m_in_pos += n;
+        m_preface_left -= n;
+        if(m_preface_left > 0) {
+            return true;
+        }
+    }
+
+    while(m_in.size() - m_in_pos >= FRAME_HEADER_LEN) {
+        const uint8_t* p = (const uint8_t*)m_in.data() + m_in_pos;
+        Frame frame;
+        frame.length = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+        frame.type = p[3];
+        frame.flags = p[4];
+        frame.stream_id = read_u32(p + 5) & 0x7fffffff;
+        frame.payload = p + FRAME_HEADER_LEN;
+
+        if(frame.length > MAX_FRAME_SIZE) {
+            return connectionError(FRAME_SIZE_ERROR);
+        }
+        if(m_in.size() - m_in_pos < FRAME_HEADER_LEN + frame.length) {
+            break;
+        }
+        if(!m_settings_received && frame.type != FRAME_SETTINGS) {
+            return connectionError(PROTOCOL_ERROR);
+        }
+        if(!handleFrame(frame)) {
+            return false;
+        }
+        m_in_pos += FRAME_HEADER_LEN + frame.length;
+    }
+    return true;
+}
+
+
+bool
+Http2Conn::handleFrame(const Frame& frame){
+    // 请求头块必须由连续的CONTINUATION帧补完，中间不能插入其他帧
+    if(m_continuation_stream && (frame.type != FRAME_CONTINUATION || frame.stream_id != m_continuation_stream)) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+
+    switch(frame.type) {
+    case FRAME_DATA:
+        return handleData(frame);
+    case FRAME_HEADERS:
+        return handleHeaders(frame);
+    case FRAME_CONTINUATION:
+        return handleContinuation(frame);
+    case FRAME_SETTINGS:
+        return handleSettings(frame);
+    case FRAME_WINDOW_UPDATE:
+        return handleWindowUpdate(frame);
+    case FRAME_PRIORITY: // 不支持优先级，只检查格式
+        if(frame.stream_id == 0) {
+            return connectionError(PROTOCOL_ERROR);
+        }
+        if(frame.length != 5) {
+            streamError(frame.stream_id, FRAME_SIZE_ERROR);
+        }
+        return true;
+    case FRAME_RST_STREAM:
+        if(frame.stream_id == 0 || frame.stream_id > m_last_stream_id) {
+            return connectionError(PROTOCOL_ERROR);
+        }
+        if(frame.length != 4) {
+            return connectionError(FRAME_SIZE_ERROR);
+        }
+        closeStream(frame.stream_id);
+        return true;
+    case FRAME_PING:
+        if(frame.stream_id != 0) {
+            return connectionError(PROTOCOL_ERROR);
+        }
+        if(frame.length != 8) {
+            return connectionError(FRAME_SIZE_ERROR);
+        }
+        if(!(frame.flags & FLAG_ACK)) {
+            writeFrameHeader(8, FRAME_PING, FLAG_ACK, 0);
+            m_out.append((const char*)frame.payload, 8);
+        }
+        return true;
+    case FRAME_GOAWAY: // 已经开始的流继续处理完
+        if(frame.stream_id != 0) {
+            return connectionError(PROTOCOL_ERROR);
+        }
+        m_goaway = true;
+        return true;
+    case FRAME_PUSH_PROMISE: // 客户端不能推送
+        return connectionError(PROTOCOL_ERROR);
+    default: // 未知类型的帧忽略
+        return true;
+    }
+}
+
+
+bool
+Http2Conn::handleHeaders(const Frame& frame){
+    uint32_t id = frame.stream_id;
+    if(id == 0 || (id & 1) == 0) { // 客户端的流ID是奇数
+        return connectionError(PROTOCOL_ERROR);
+    }
+
+    // 去掉填充和优先级
+    size_t pos = 0, pad = 0;
+    if(frame.flags & FLAG_PADDED) {
+        if(frame.length < 1) {
+            return connectionError(FRAME_SIZE_ERROR);
+        }
+        pad = frame.payload[pos++];
+    }
+    if(frame.flags & FLAG_PRIORITY) {
+        pos += 5;
+    }
+    if(pos + pad > frame.length) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+
+    Stream* stream = findStream(id);
+    if(id > m_last_stream_id) { // 新的流, 对端发送GOAWAY之后的新流忽略
+        m_last_stream_id = id;
+        if(m_streams.size() >= MAX_CONCURRENT_STREAMS) {
+            sendRstStream(id, REFUSED_STREAM);
+        }
+        else if(!m_goaway) {
+            std::unique_ptr<Stream> fresh(new Stream);
+            fresh->id = id;
+            fresh->send_window = m_peer_initial_window;
+            m_streams[id] = std::move(fresh);
+        }
+    }
+    else if(!stream) { // 已经关闭的流
+        return connectionError(STREAM_CLOSED);
+    }
+    else if(stream->remote_closed || !(frame.flags & FLAG_END_STREAM)) { // 只有请求体之后的trailer
+        streamError(id, stream->remote_closed ? STREAM_CLOSED : PROTOCOL_ERROR);
+    }
+
+    m_continuation_stream = id;
+    m_continuation_end_stream = frame.flags & FLAG_END_STREAM;
+    m_header_block.assign((const char*)frame.payload + pos, frame.length - pos - pad);
+    if(frame.flags & FLAG_END_HEADERS) {
+        return finishHeaderBlock();
+    }
+    return true;
+}
+
+
+bool
+Http2Conn::handleContinuation(const Frame& frame){
+    if(m_continuation_stream == 0) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+    m_header_block.append((const char*)frame.payload, frame.length);
+    if(m_header_block.size() > MAX_HEADER_BLOCK) {
+        return connectionError(ENHANCE_YOUR_CALM);
+    }
+    if(frame.flags & FLAG_END_HEADERS) {
+        return finishHeaderBlock();
+    }
+    return true;
+}
+
+
+//请求头块必须解码，即使流已经被拒绝或重置，否则动态表会与对端不一致
+bool
+Http2Conn::finishHeaderBlock(){
+    uint32_t id = m_continuation_stream;
+    m_continuation_stream = 0;
+
+    std::vector<HpackHeader> headers;
+    if(!m_decoder.decode((const uint8_t*)m_header_block.data(), m_header_block.size(), headers)) {
+        return connectionError(COMPRESSION_ERROR);
+    }
+    m_header_block.clear();
+
+    Stream* stream = findStream(id);
+    if(!stream) { // 被拒绝或重置的流
+        return true;
+    }
+    if(stream->headers.empty()) {
+        stream->headers.swap(headers);
+    }
+    // 否则是trailer，丢弃
+    if(m_continuation_end_stream) {
+        stream->remote_closed = true;
+        respond(*stream);
+    }
+    return true;
+}
+
+
+//收到的数据立即归还连接和流的接收窗口，请求体的大小由MAX_BODY_SIZE限制
+bool
+Http2Conn::handleData(const Frame& frame){
+    uint32_t id = frame.stream_id;
+    if(id == 0 || id > m_last_stream_id) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+
+    size_t pos = 0, pad = 0;
+    if(frame.flags & FLAG_PADDED) {
+        if(frame.length < 1) {
+            return connectionError(FRAME_SIZE_ERROR);
+        }
+        pad = frame.payload[pos++];
+    }
+    if(pos + pad > frame.length) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+    if(frame.length > 0) { // 填充也计入流量控制
+        sendWindowUpdate(0, frame.length);
+    }
+
+    Stream* stream = findStream(id);
+    if(!stream || stream->remote_closed) {
+        streamError(id, STREAM_CLOSED);
+        return true;
+    }
+
+    stream->body.append((const char*)frame.payload + pos, frame.length - pos - pad);
+    if(stream->body.size() > MAX_BODY_SIZE) {
+        streamError(id, CANCEL);
+        return true;
+    }
+
+    if(frame.flags & FLAG_END_STREAM) {
+        stream->remote_closed = true;
+        respond(*stream);
+    }
+    else if(frame.length > 0) {
+        sendWindowUpdate(id, frame.length);
+    }
+    return true;
+}
+
+
+bool
+Http2Conn::handleSettings(const Frame& frame){
+    if(frame.stream_id != 0) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+    if(frame.flags & FLAG_ACK) {
+        if(frame.length != 0) {
+            return connectionError(FRAME_SIZE_ERROR);
+        }
+        return true;
+    }
+    if(frame.length % 6 != 0) {
+        return connectionError(FRAME_SIZE_ERROR);
+    }
+    if(!applySettings(frame.payload, frame.length)) {
+        return false;
+    }
+    m_settings_received = true;
+    writeFrameHeader(0, FRAME_SETTINGS, FLAG_ACK, 0);
+    return true;
+}
+
+
+//只关心影响发送的参数；响应头不使用动态表，SETTINGS_HEADER_TABLE_SIZE不影响编码
+bool
+Http2Conn::applySettings(const uint8_t* payload, size_t len){
+    if(len % 6 != 0) {
+        return connectionError(FRAME_SIZE_ERROR);
+    }
+    for(size_t i = 0; i < len; i += 6) {
+        uint16_t id = ((uint16_t)payload[i] << 8) | payload[i+1];
+        uint32_t value = read_u32(payload + i + 2);
+        switch(id) {
+        case SETTINGS_ENABLE_PUSH:
+            if(value > 1) {
+                return connectionError(PROTOCOL_ERROR);
+            }
+            break;
+        case SETTINGS_INITIAL_WINDOW_SIZE:
+        {
+            if(value > MAX_WINDOW) {
+                return connectionError(FLOW_CONTROL_ERROR);
+            }
+            // 调整所有已打开的流的发送窗口
+            int64_t delta = (int64_t)value - m_peer_initial_window;
+            for(auto& it : m_streams) {
+                it.second->send_window += delta;
+                if(it.second->send_window > MAX_WINDOW) {
+                    return connectionError(FLOW_CONTROL_ERROR);
+                }
+            }
+            m_peer_initial_window = value;
+            break;
+        }
+        case SETTINGS_MAX_FRAME_SIZE:
+            if(value < 16384 || value > 16777215) {
+                return connectionError(PROTOCOL_ERROR);
+            }
+            m_peer_max_frame = value;
+            break;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+
+bool
+Http2Conn::handleWindowUpdate(const Frame& frame){
+    if(frame.length != 4) {
+        return connectionError(FRAME_SIZE_ERROR);
+    }
+    uint32_t increment = read_u32(frame.payload) & 0x7fffffff;
+
+    if(frame.stream_id == 0) {
+        if(increment == 0) {
+            return connectionError(PROTOCOL_ERROR);
+        }
+        m_send_window += increment;
+        if(m_send_window > MAX_WINDOW) {
+            return connectionError(FLOW_CONTROL_ERROR);
+        }
+        return true;
+    }
+
+    if(frame.stream_id > m_last_stream_id) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+    Stream* stream = findStream(frame.stream_id);
+    if(!stream) { // 已经关闭的流可能还会收到
+        return true;
+    }
+    if(increment == 0) {
+        streamError(frame.stream_id, PROTOCOL_ERROR);
+        return true;
+    }
+    stream->send_window += increment;
+    if(stream->send_window > MAX_WINDOW) {
+        streamError(frame.stream_id, FLOW_CONTROL_ERROR);
+    }
+    return true;
+}
+
+
+//与HTTP/1.1走同一个路由和静态文件目录，不支持Range和压缩版本
+void
+Http2Conn::respond(Stream& stream){
+    stream.responded = true;
+
+    // 伪头部必须在普通请求头之前，普通请求头的名字必须是小写
+    HeaderTable table;
+    std::string_view method, path;
+    bool regular = false;
+    for(const HpackHeader& h : stream.headers) {
+        if(!h.name.empty() && h.name[0] == ':') {
+            if(regular) {
+                streamError(stream.id, PROTOCOL_ERROR);
+                return;
+            }
+            if(h.name == ":method") {
+                method = h.value;
+            }
+            else if(h.name == ":path") {
+                path = h.value;
+            }
+            else if(h.name == ":authority") {
+                table.add(HeaderId::HOST, "host", 4, h.value.c_str(), h.value.size());
+            }
+            else if(h.name != ":scheme") {
+                streamError(stream.id, PROTOCOL_ERROR);
+                return;
+            }
+            continue;
+        }
+        regular = true;
+        if(std::any_of(h.name.begin(), h.name.end(), [](char c) {return c >= 'A' && c <= 'Z';})) {
+            streamError(stream.id, PROTOCOL_ERROR);
+            return;
+        }
+        if(!table.add(LookupHeader(h.name.data(), h.name.size()), h.name.c_str(), h.name.size(),
+                        h.value.c_str(), h.value.size())) {
+            respondError(stream, 400);
+            return;
+        }
+    }
+    if(method.empty() || path.empty()) {
+        streamError(stream.id, PROTOCOL_ERROR);
+        return;
+    }
+
+    int method_id;
+    if(method == "GET") method_id = http_conn::GET;
+    else if(method == "POST") method_id = http_conn::POST;
+    else if(method == "HEAD") method_id = http_conn::HEAD;
+    else if(method == "PUT") method_id = http_conn::PUT;
+    else if(method == "DELETE") method_id = http_conn::DELETE;
+    else {
+        respondError(stream, 400);
+        return;
+    }
+
+    HttpRequest req;
+    size_t query = path.find('?');
+    req.method = method_id;
+    req.path = path.substr(0, query);
+    if(query != std::string_view::npos) {
+        req.query = path.substr(query + 1);
+    }
+    req.body = stream.body;
+    req.headers = &table;
+
+    std::string_view file;
+    uint32_t allow = 0;
+    int status = Router::get_instance()->dispatch(1u << method_id, req, file, &allow);
+    if(status == 405) {
+        std::string block;
+        HpackEncoder::encodeStatus(405, block);
+        HpackEncoder::encode("date", GetCachedHttpDate(), block);
+        HpackEncoder::encode("allow", (allow & ROUTE_GET) && (allow & ROUTE_POST) ? "GET, POST"
+                                    : (allow & ROUTE_GET) ? "GET" : "POST", block);
+        char len[24];
+        HpackEncoder::encode("content-length", std::string_view(len, FormatUint(strlen(error_405_form), len)), block);
+        stream.data = error_405_form;
+        stream.remaining = strlen(error_405_form);
+        sendResponseHeaders(stream, block, method_id != http_conn::HEAD);
+        return;
+    }
+    if(status != 200) {
+        respondError(stream, status);
+        return;
+    }
+
+    // 静态文件：映射由文件缓存持有，发送完之前有效
+    std::string real_file = m_root;
+    real_file.append(file.data(), file.size());
+    stream.file = FileCache::get_instance()->acquire(real_file);
+    if(!stream.file) {
+        respondError(stream, 404);
+        return;
+    }
+    const struct stat& st = stream.file->st;
+    if(!(st.st_mode & S_IROTH)) {
+        stream.file.reset();
+        respondError(stream, 403);
+        return;
+    }
+
+    char etag[64], modified[32], num[24];
+    bool weak;
+    int etag_len = http_conn::make_etag(st, nullptr, etag, sizeof(etag), weak);
+    size_t modified_len = FormatHttpDate(st.st_mtime, modified, sizeof(modified));
+    int max_age = CacheControl::get_instance()->getMaxAge(real_file.c_str());
+    bool not_modified = http_conn::is_not_modified(table, st, nullptr);
+
+    std::string block;
+    HpackEncoder::encodeStatus(not_modified ? 304 : 200, block);
+    HpackEncoder::encode("date", GetCachedHttpDate(), block);
+    HpackEncoder::encode("etag", std::string_view(etag, etag_len), block);
+    HpackEncoder::encode("last-modified", std::string_view(modified, modified_len), block);
+    if(max_age >= 0) {
+        HpackEncoder::encode("cache-control", "max-age=" + std::string(num, FormatUint(max_age, num)), block);
+    }
+    if(!not_modified) {
+        HpackEncoder::encode("content-length", std::string_view(num, FormatUint(st.st_size, num)), block);
+        stream.data = stream.file->addr;
+        stream.remaining = st.st_size;
+    }
+    sendResponseHeaders(stream, block, !not_modified && method_id != http_conn::HEAD && st.st_size > 0);
+}
+
+
+void
+Http2Conn::respondError(Stream& stream, int status){
+    const char* form;
+    switch(status) {
+    case 400: form = error_400_form; break;
+    case 403: form = error_403_form; break;
+    case 404: form = error_404_form; break;
+    default:
+        status = 500;
+        form = error_500_form;
+        break;
+    }
+
+    char len[24];
+    std::string block;
+    HpackEncoder::encodeStatus(status, block);
+    HpackEncoder::encode("date", GetCachedHttpDate(), block);
+    HpackEncoder::encode("content-length", std::string_view(len, FormatUint(strlen(form), len)), block);
+    stream.data = form;
+    stream.remaining = strlen(form);
+    sendResponseHeaders(stream, block, true);
+}
+
+
+void
+Http2Conn::sendResponseHeaders(Stream& stream, const std::string& block, bool has_body){
+    size_t pos = 0;
+    do {
+        size_t n = std::min(block.size() - pos, (size_t)m_peer_max_frame);
+        uint8_t type = (pos == 0) ? FRAME_HEADERS : FRAME_CONTINUATION;
+        uint8_t flags = (pos + n == block.size()) ? FLAG_END_HEADERS : 0;
+        if(pos == 0 && !has_body) {
+            flags |= FLAG_END_STREAM;
+        }
+        writeFrameHeader(n, type, flags, stream.id);
+        m_out.append(block, pos, n);
+        pos += n;
+    } while(pos < block.size());
+
+    if(!has_body) {
+        stream.remaining = 0;
+        stream.file.reset();
+        stream.local_closed = true;
+    }
+}
+
+
+//各个流轮流发送，每轮每个流最多一个帧，不让一个大文件占满连接
+bool
+Http2Conn::writeData(){
+    size_t budget = OUT_CHUNK;
+    bool progress = true;
+    while(budget > 0 && m_send_window > 0 && progress) {
+        progress = false;
+        for(auto& it : m_streams) {
+            Stream& s = *it.second;
+            if(!s.responded || s.local_closed || s.send_window <= 0) {
+                continue;
+            }
+            size_t n = std::min({s.remaining, (size_t)m_peer_max_frame, budget,
+                                (size_t)m_send_window, (size_t)s.send_window});
+            bool end = (n == s.remaining);
+            writeFrameHeader(n, FRAME_DATA, end ? FLAG_END_STREAM : 0, s.id);
+            m_out.append(s.data, n);
+            s.data += n;
+            s.remaining -= n;
+            s.send_window -= n;
+            m_send_window -= n;
+            budget -= n;
+            progress = true;
+            if(end) {
+                s.local_closed = true;
+                s.file.reset();
+            }
+            if(budget == 0 || m_send_window <= 0) {
+                break;
+            }
+        }
+    }
+
+    // 响应发送完的流关闭，还有数据且窗口未用完时返回true
+    bool more = false;
+    for(auto it = m_streams.begin(); it != m_streams.end(); ) {
+        Stream& s = *it->second;
+        if(s.local_closed && s.remote_closed) {
+            it = m_streams.erase(it);
+            continue;
+        }
+        if(s.responded && !s.local_closed && s.send_window > 0 && m_send_window > 0) {
+            more = true;
+        }
+        ++it;
+    }
+    return more;
+}
+
+
+//hook后的send遇到EAGAIN会挂起当前协程
+bool
+Http2Conn::flush(){
+    size_t sent = 0;
+    while(sent < m_out.size()) {
+        int n = m_client->send(m_out.data() + sent, m_out.size() - sent, 0);
+        if(n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    m_out.clear();
+    return true;
+}
+
+
+void
+Http2Conn::writeFrameHeader(uint32_t length, uint8_t type, uint8_t flags, uint32_t stream_id){
+    char head[5] = {(char)(length >> 16), (char)(length >> 8), (char)length, (char)type, (char)flags};
+    m_out.append(head, 5);
+    append_u32(m_out, stream_id);
+}
+
+
+void
+Http2Conn::sendRstStream(uint32_t stream_id, ErrorCode code){
+    writeFrameHeader(4, FRAME_RST_STREAM, 0, stream_id);
+    append_u32(m_out, code);
+}
+
+
+void
+Http2Conn::sendGoaway(ErrorCode code){
+    writeFrameHeader(8, FRAME_GOAWAY, 0, 0);
+    append_u32(m_out, m_last_stream_id);
+    append_u32(m_out, code);
+}
+
+
+void
+Http2Conn::sendWindowUpdate(uint32_t stream_id, uint32_t increment){
+    writeFrameHeader(4, FRAME_WINDOW_UPDATE, 0, stream_id);
+    append_u32(m_out, increment);
+}
+
+
+bool
+Http2Conn::connectionError(ErrorCode code){
+    sendGoaway(code);
+    m_goaway = true;
+    return false;
+}
+
+
+void
+Http2Conn::streamError(uint32_t stream_id, ErrorCode code){
+    sendRstStream(stream_id, code);
+    closeStream(stream_id);
+}
+
+
+Http2Conn::Stream*
+Http2Conn::findStream(uint32_t stream_id){
+    auto it = m_streams.find(stream_id);
+    return it == m_streams.end() ? nullptr : it->second.get();
+}
+
+
+void
+Http2Conn::closeStream(uint32_t stream_id){
+    m_streams.erase(stream_id);
+}
+
+} // namespace bryant
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../util/socket.hh"
+#include "file_cache.hh"
+#include "hpack.hh"
+#include "http_header.hh"
+
+namespace bryant{
+
+// h2c升级请求：HTTP/1.1请求带"Upgrade: h2c"时由http_conn保存下来，回复101之后作为流1的请求
+struct Http2Upgrade {
+    std::string settings;               // HTTP2-Settings解码后的SETTINGS帧负载
+    std::vector<HpackHeader> headers;   // 转换成HTTP/2形式的请求头: 伪头部在前, 名字小写, 去掉了逐跳请求头
+};
+
+
+// HTTP/2明文连接(h2c, RFC 9113)
+// 一个连接只有一个协程：读帧、解码请求头、路由/静态文件、按流量控制窗口轮流发送各个流的DATA帧，
+// 多个请求共享同一个socket和协程，不再各占一个http_conn和协程栈。
+// 请求体和响应都在内存里(静态文件为映射)，不支持服务器推送和优先级。
+class Http2Conn {
+public:
+    static const char PREFACE[];                    // 客户端连接前言"PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+    static const size_t PREFACE_LEN = 24;
+    static const size_t PREFACE_LINE_LEN = 16;      // 前言的"PRI * HTTP/2.0\r\n"部分, 被HTTP/1.1当作请求行解析
+    static const uint32_t MAX_CONCURRENT_STREAMS = 100;
+    static const uint32_t MAX_FRAME_SIZE = 16384;   // 我方接收的帧负载上限(默认值)
+    static const size_t MAX_BODY_SIZE = 64 * 1024;  // 请求体上限，与HTTP/1.1一致
+    static const size_t OUT_CHUNK = 64 * 1024;      // 每轮最多生成的发送数据
+
+    // 错误码
+    enum ErrorCode {
+        NO_ERROR = 0x0,
+        PROTOCOL_ERROR = 0x1,
+        INTERNAL_ERROR = 0x2,
+        FLOW_CONTROL_ERROR = 0x3,
+        SETTINGS_TIMEOUT = 0x4,
+        STREAM_CLOSED = 0x5,
+        FRAME_SIZE_ERROR = 0x6,
+        REFUSED_STREAM = 0x7,
+        CANCEL = 0x8,
+        COMPRESSION_ERROR = 0x9,
+        CONNECT_ERROR = 0xa,
+        ENHANCE_YOUR_CALM = 0xb
+    };
+
+    /**
+     * @brief Construct a new Http2 Conn object
+     *
+     * @param client 已经建立的连接
+     * @param doc_root 静态文件根目录
+     */
+    Http2Conn(sylar::Socket::ptr client, const char* doc_root);
+    ~Http2Conn();
+
+    Http2Conn(const Http2Conn&) = delete;
+    Http2Conn& operator=(const Http2Conn&) = delete;
+
+    /**
+     * @brief 接管连接, 直到连接关闭才返回
+     *
+     * @param initial 已经读到但还没处理的数据
+     * @param preface_read 连接前言中已经被HTTP/1.1解析掉的字节数(先验知识方式为"PRI * HTTP/2.0\r\n"的16字节)
+     * @param upgrade 非空表示由h2c升级而来, 作为流1的请求
+     */
+    void run(std::string_view initial, size_t preface_read, const Http2Upgrade* upgrade);
+
+private:
+    struct Frame {
+        uint32_t length;
+        uint8_t type;
+        uint8_t flags;
+        uint32_t stream_id;
+        const uint8_t* payload;
+    };
+
+    struct Stream {
+        uint32_t id;
+        bool remote_closed = false;     // 请求已完整(收到END_STREAM)
+        bool responded = false;         // 响应头已生成
+        bool local_closed = false;      // 响应已全部发送(发出了END_STREAM)
+        int64_t send_window;            // 发送窗口
+
+        std::vector<HpackHeader> headers;   // 解码出的请求头
+        std::string body;                   // 请求体
+
+        // 响应体
+        const char* data = nullptr;
+        size_t remaining = 0;
+        FileCache::Entry::ptr file;         // 静态文件句柄，发送完之前有效
+    };
+
+private:
+    /**
+     * @brief 处理输入缓冲区里所有完整的帧
+     * @return false 连接错误, 已经发送GOAWAY
+     */
+    bool processInput();
+
+    bool handleFrame(const Frame& frame);
+    bool handleHeaders(const Frame& frame);
+    bool handleContinuation(const Frame& frame);
+    bool handleData(const Frame& frame);
+    bool handleSettings(const Frame& frame);
+    bool handleWindowUpdate(const Frame& frame);
+
+    /**
+     * @brief 解析SETTINGS负载并生效
+     */
+    bool applySettings(const uint8_t* payload, size_t len);
+
+    /**
+     * @brief 请求头块完整后解码, 失败为连接错误
+     */
+    bool finishHeaderBlock();
+
+    /**
+     * @brief 请求完整后路由并生成响应
+     */
+    void respond(Stream& stream);
+
+    /**
+     * @brief 把编码好的响应头块分成HEADERS/CONTINUATION帧
+     */
+    void sendResponseHeaders(Stream& stream, const std::string& block, bool has_body);
+
+    /**
+     * @brief 生成错误响应
+     */
+    void respondError(Stream& stream, int status);
+
+    /**
+     * @brief 按流量控制窗口生成各个流的DATA帧
+     * @return true 还有被窗口挡住之外的待发送数据
+     */
+    bool writeData();
+
+    /**
+     * @brief 发送m_out
+     */
+    bool flush();
+
+    void writeFrameHeader(uint32_t length, uint8_t type, uint8_t flags, uint32_t stream_id);
+    void sendRstStream(uint32_t stream_id, ErrorCode code);
+    void sendGoaway(ErrorCode code);
+    void sendWindowUpdate(uint32_t stream_id, uint32_t increment);
+
+    /**
+     * @brief 出错时关闭连接
+     */
+    bool connectionError(ErrorCode code);
+
+    /**
+     * @brief 流出错时重置这个流
+     */
+    void streamError(uint32_t stream_id, ErrorCode code);
+
+    Stream* findStream(uint32_t stream_id);
+    void closeStream(uint32_t stream_id);
+
+private:
+    sylar::Socket::ptr m_client;
+    std::string m_root;                     // 静态文件根目录
+
+    std::string m_in;                       // 输入缓冲区
+    size_t m_in_pos = 0;                    // 已处理到的位置
+    size_t m_preface_left = PREFACE_LEN;    // 还没收到的连接前言字节数
+    std::string m_out;                      // 待发送的帧
+
+    HpackDecoder m_decoder;
+    std::map<uint32_t, std::unique_ptr<Stream> > m_streams;
+    uint32_t m_last_stream_id = 0;          // 客户端打开过的最大流ID
+
+    uint32_t m_continuation_stream = 0;     // 等待CONTINUATION的流, 0为没有
+    bool m_continuation_end_stream = false; // 这个请求头块之后请求是否结束
+    std::string m_header_block;             // 拼接中的请求头块
+
+    int64_t m_send_window = 65535;          // 连接级发送窗口
+    int64_t m_peer_initial_window = 65535;  // 对端SETTINGS_INITIAL_WINDOW_SIZE
+    uint32_t m_peer_max_frame = 16384;      // 对端SETTINGS_MAX_FRAME_SIZE
+    bool m_settings_received = false;       // 前言之后的第一个帧必须是SETTINGS
+    bool m_goaway = false;                  // 对端发送了GOAWAY或者连接出错，不再接受新的流
+};
+
+} // namespace bryant
@@ -2,17 +2,21 @@
 
 #include "httpServer.hh"
 #include "http_conn.hh"
+#include "handlers.hh"
+#include "http2.hh"
+#include "websocket.hh"
 #include "../fiberLibrary/hook.hh"
+#include "../fiberLibrary/fdmanager.hh"
+#include "../util/object_pool.hh"
 
 namespace bryant{
 
-http_conn * users;   //用户http数组
+// 连接对象池：连接建立时取一个http_conn, 连接关闭时归还, 占用的内存随在线连接数增减
+static ObjectPool<http_conn> s_conn_pool;
 
 http_server::http_server(bool keepalive):
     m_isKeepalive(keepalive) {
 
-    users = new http_conn[MAX_FD];
-
     //获取当前文件路径
     char server_path[200];
     getcwd(server_path, 200);
@@ -35,8 +39,8 @@ http_server::~http_server(){
 
 
 void 
-http_server::initmysql_result(Connection_pool *conn_pool) {
-    users->initmysql_result(conn_pool);
+http_server::initmysql_result(Connection_pool *conn_pool, bool load_passwords, const std::string& snapshot) {
+    LoadUsers(conn_pool, load_passwords, snapshot);
 }
 
 
@@ -45,39 +49,86 @@ void http_server::handleClient(sylar::Socket::ptr client) {
     // LOG_INFO("[HttpServer] http_server handleClient and dealing %d now", client->getSocket());
     
     bryant::set_hook_enable(true);
-    int client_socket = client->getSocket();
     if(!client->isValid()){
         client->close();
         return;
     }
 
-    users[client_socket].init(client, m_root, 0, 
-                                m_user, m_password, m_database_name, 
-                                m_isKeepalive);
+    // 连接对象与client同生命周期，函数返回时归还到池中
+    ObjectPool<http_conn>::ptr conn = s_conn_pool.make();
+    conn->init(client, m_root, 0, 
+                m_user, m_password, m_database_name, 
+                m_isKeepalive, m_sendfile);
+
+    // 本协程至少处理完一批请求后才挂起: 新连接和刚被唤醒的连接先读
+    bool served = false;
 
     while( client->isConnected() ){
-        // 先读
-        if(users[client_socket].read_once()==false) {
-            goto end;
-        }
-        // LOG_INFO("[HttpServer] %s\n", users[client_socket].getReadBuf());
-        
-        {
-            connectionRAII mysqlcon(&users[client_socket].mysql, Connection_pool::get_instance());
+        // 先读，上一批流水线请求没处理完时直接处理缓冲区里剩下的请求
+        if(!conn->has_pending_request()) {
+            // 没有读了一半的请求时先只等IDLE_PARK_DELAY, 活跃的长连接在这段时间内就会发来下一个请求；
+            // 超时仍没有数据就挂起连接：缓冲区和连接对象归还到池中，协程退出，
+            // 下一次可读时parkClient在新协程里重新进入handleClient
+            bool park = m_idle_park && served && conn->is_idle();
+            FdCtx::ptr ctx = park ? FdMgr::GetInstance()->get(client->getSocket()) : nullptr;
+            if(ctx) {
+                ctx->setTimeout(SO_RCVTIMEO, IDLE_PARK_DELAY);
+            }
+            bool ok = conn->read_once();
+            int err = errno;
+            if(ctx) {
+                ctx->setTimeout(SO_RCVTIMEO, m_recvTimeout);
+            }
+            if(!ok) {
+                if(ctx && err == ETIMEDOUT && conn->is_idle()) {
+                    conn->release_buffer();
+                    if(parkClient(client)) {
+                        return;
+                    }
+                    // 挂起失败: 本协程继续阻塞读, 按接收超时等下一个请求
+                    served = false;
+                    continue;
+                }
+                goto end;
+            }
         }
+        // LOG_INFO("[HttpServer] %s\n", conn->getReadBuf());
 
         // 处理（process->read, process->write)
-        if(users[client_socket].process() == false) {
+        if(conn->process() == false) {
             goto end;
         }
 
         // 再写
-        if(users[client_socket].write() == false) {
+        if(conn->write() == false) {
             goto end;
         }
+        served = true;
+
+        // 切换协议：之后这个连接由新协议在当前协程里处理，直到连接关闭
+        switch(conn->get_upgrade()) {
+        case http_conn::UPGRADE_H2:
+        {
+            // 这个连接上的所有请求都由一个Http2Conn处理
+            const Http2Upgrade* upgrade = conn->get_h2_upgrade();
+            Http2Conn h2(client, m_root);
+            h2.run(conn->pending_data(), upgrade ? 0 : Http2Conn::PREFACE_LINE_LEN, upgrade);
+            goto end;
+        }
+        case http_conn::UPGRADE_WEBSOCKET:
+        {
+            WebSocket ws(client, conn->pending_data());
+            (*conn->get_ws_handler())(ws);
+            ws.close();
+            goto end;
+        }
+        default:
+            break;
+        }
     }
 end :
     // LOG_INFO("[HttpServer] %d is close", client->getSocket());
+    conn->release_buffer();
     client->close();
 }
 
@@ -8,10 +8,10 @@
 
 namespace bryant{
 
-const int MAX_FD = 65536;
-
 class http_server : public TcpServer {
 public:
+    static const uint64_t IDLE_PARK_DELAY = 50; // 长连接空闲超过该时间(ms)才挂起
+
     /**
      * @brief Construct a new http server
      * 
@@ -30,8 +30,10 @@ public:
      * @brief initiate mysql
      * 
      * @param conn_pool 
+     * @param load_passwords false时只加载用户名(见LoadUsers)
+     * @param snapshot 用户表快照文件(见LoadUsers)
      */
-    void initmysql_result(Connection_pool *conn_pool);
+    void initmysql_result(Connection_pool *conn_pool, bool load_passwords = true, const std::string& snapshot = "");
 
     /**
      * @brief handle client mission
@@ -45,6 +47,8 @@ public:
     std::string m_user;
     std::string m_password;
     std::string m_database_name;
+    bool m_sendfile = false;    // 静态文件是否用sendfile发送
+    bool m_idle_park = false;   // 长连接空闲时是否挂起(归还缓冲区和协程)
 
 private:
     bool m_isKeepalive;
@@ -1,59 +1,46 @@
 // #include <fstream>
 
 #include "http_conn.hh"
+#include "../util/util.hh"
+#include "../util/http_scan.hh"
 
 namespace bryant{
 
 // 每个状态码对应讯息
-const char *ok_200_title = "OK";
-const char *error_400_title = "Bad Request";
 const char *error_400_form = "Your request has bad syntax or is inherently impossible to staisfy.\n";
-const char *error_403_title = "Forbidden";
 const char *error_403_form = "You do not have permission to get file form this server.\n";
-const char *error_404_title = "Not Found";
 const char *error_404_form = "The requested file was not found on this server.\n";
-const char *error_500_title = "Internal Error";
 const char *error_500_form = "There was an unusual problem serving the request file.\n";
-
-Mutex m_lock;
-std::map<std::string, std::string> users;
-// FindCache<std::string,MemoryPool<std::string> > users;
-// //（注意，这个不能放入到http_conn.h中）因为每个用户对应了很多个http类，而不是全局的users来进行管理
-// //但是放入到这里就可以做到全局的一个管理了(即所有用户的数据都存储到这个地方)
-// AbstractFactory * factory=nullptr;    //这个处理的时候可能需要加锁
-// AbstractProxy * obj=nullptr;
-
-
-void 
-http_conn::initmysql_result(Connection_pool* conn_pool){
-    // 从连接池里面获取一个连接
-    MYSQL* mysql = nullptr;
-    connectionRAII mysqlcon(&mysql, conn_pool);
-
-    // 在user表中检索username,passwd数据，看是否可以满足不报错的条件
-    if( mysql_query(mysql, "select username,passwd from user") ) { 
-        //如果返回非0，说明内部错误
-        LOG_ERROR("[HTTP_CONN] select error: %d", mysql_errno(mysql));
-    }
-
-    //从表中检索完整的结果集：
-    // MYSQL_RES: 代表返回行的查询结果（SELECT, SHOW, DESCRIBE, EXPLAIN）
-    MYSQL_RES *result = mysql_store_result(mysql);
-
-    //返回结果集的列数
-    int num_fields = mysql_num_fields(result);
-
-    // 返回所有字段结构的数组
-    // 这两个有什么用吗？定义局部变量也没看到有啥利用场景
-    MYSQL_FIELD * fields = mysql_fetch_fields(result);
-
-    while( MYSQL_ROW row = mysql_fetch_row(result) ) {
-        std::string temp1(row[0]);
-        std::string temp2(row[1]);
-        users[temp1] = temp2;
-        // users.push(temp1,temp2);  //存放到对应的内存中，其实可以弄一个redis，存放到里面
-    }
-}
+const char *error_405_form = "The request method is not supported by the requested resource.\n";
+
+// 预先拼好的状态行，生成响应时直接拷贝
+struct status_line {
+    int status;
+    const char* line;
+    size_t len;
+};
+
+#define STATUS_LINE(status, title) {status, "HTTP/1.1 " #status " " title "\r\n", sizeof("HTTP/1.1 " #status " " title "\r\n") - 1}
+static const status_line status_lines[] = {
+    STATUS_LINE(101, "Switching Protocols"),
+    STATUS_LINE(200, "OK"),
+    STATUS_LINE(206, "Partial Content"),
+    STATUS_LINE(304, "Not Modified"),
+    STATUS_LINE(400, "Bad Request"),
+    STATUS_LINE(403, "Forbidden"),
+    STATUS_LINE(404, "Not Found"),
+    STATUS_LINE(405, "Method Not Allowed"),
+    STATUS_LINE(416, "Range Not Satisfiable"),
+    STATUS_LINE(500, "Internal Error"),
+};
+#undef STATUS_LINE
+
+// multipart/byteranges各部分之间的分隔符
+const char *byteranges_boundary = "bryant_byteranges_5f3c9a";
+
+// Router匹配的方法位与METHOD一一对应
+static_assert(ROUTE_GET == 1u << http_conn::GET && ROUTE_POST == 1u << http_conn::POST
+            && ROUTE_HEAD == 1u << http_conn::HEAD, "RouteMethod must match http_conn::METHOD");
 
 
 int http_conn::m_user_count = 0; //静态成员变量初始化
@@ -63,11 +50,12 @@ int http_conn::m_user_count = 0; //静态成员变量初始化
 void 
 http_conn::init(sylar::Socket::ptr &client, char* root, int TRIGMode,
                 std::string user, std::string passwd, std::string sqlname,
-                bool keepalive) {
+                bool keepalive, bool use_sendfile) {
     m_user_count++;
 
     m_client = client;
     m_linger = keepalive; // 待加到config
+    m_sendfile = use_sendfile;
     m_TRIGMode = TRIGMode; // 待加到config
     doc_root = root; // 待加到config
     strcpy(sql_user, user.c_str());
@@ -87,29 +75,113 @@ http_conn::init(sylar::Socket::ptr &client, char* root, int TRIGMode,
 ///check_state默认为分析请求行状态
 void 
 http_conn::init(){
-    mysql = nullptr; 
-    bytes_to_send = 0;
-    bytes_have_send = 0;
-    m_check_state = CHECK_STATE::CHECK_STATE_REQUESTLINE;
-    m_method = METHOD::GET;
-    m_url = 0;
-    m_version = 0;
-    m_content_length = 0;
-    m_host = 0;
     m_start_line = 0;
     m_checked_idx = 0;
     m_read_idx = 0;
+    m_line_colon = -1;
+    m_colon = nullptr;
+    m_line_end = nullptr;
     m_write_idx = 0;
-    cgi = 0;
+    m_out.clear();
+    m_out_idx = 0;
+    m_pipeline_pending = false;
+    m_upgrade = UPGRADE_NONE;
+    m_h2_upgrade.reset();
+    m_ws_handler = nullptr;
     m_state = 0;
     timer_flag = 0;
     improv = 0;
-    memset(m_read_buf, '\0', READ_BUFFER_SIZE);
+    m_read_chain.consume(m_read_chain.size()); // 保留slab，复用给新连接
+    m_read_buf = m_read_chain.data();
     memset(m_write_buf, '\0', WRITE_BUFFER_SIZE);
+    init_request();
+}
+
+
+//重置单个请求的解析状态
+//流水线中的请求共用读缓冲区，这里不动读写下标
+void 
+http_conn::init_request(){
+    m_check_state = CHECK_STATE::CHECK_STATE_REQUESTLINE;
+    m_method = METHOD::GET;
+    m_url = 0;
+    m_version = 0;
+    m_content_length = 0;
+    m_headers.clear();
+    m_allow = 0;
+    m_string = 0;
+    m_range_count = 0;
+    m_accept_gzip = false;
+    m_accept_br = false;
+    m_vary = false;
+    m_content_encoding = nullptr;
+    m_variant.reset();
+    m_max_age = -1;
+    m_file_entry.reset();
+    m_response.reset();
     memset(m_real_file, '\0', FILENAME_LEN);
 }
 
 
+//一个请求处理完后，把解析位置移到流水线中下一个请求的开头
+void 
+http_conn::finish_request(){
+    if(m_check_state == CHECK_STATE_CONTENT) {
+        m_checked_idx += m_content_length; //跳过请求体
+    }
+    m_start_line = m_checked_idx;
+    init_request();
+}
+
+
+//丢弃已处理完的请求，把剩余数据移到缓冲区开头，给后续读取腾出空间
+//只在请求边界进行，请求解析到一半时已解析出的指针(url、host等)还指向缓冲区
+void 
+http_conn::compact_read_buf(){
+    if(m_check_state != CHECK_STATE_REQUESTLINE) {
+        return;
+    }
+
+    m_read_chain.consume(m_start_line);
+    m_read_buf = m_read_chain.data();
+    m_read_idx = m_read_chain.size();
+    m_checked_idx -= m_start_line;
+    if(m_line_colon >= 0) m_line_colon -= m_start_line;
+    m_start_line = 0;
+}
+
+
+//保证读缓冲区还有空间可读，满了时把当前行(或请求体)搬到新的块里
+//请求体需要连续存放，按m_content_length一次申请够
+bool 
+http_conn::reserve_read_buf(){
+    size_t need = (m_check_state == CHECK_STATE_CONTENT) ? m_content_length : 0;
+    long shift = m_read_chain.reserve(m_start_line, need);
+    if(shift < 0) { // 请求超过MAX_REQUEST_SIZE
+        return false;
+    }
+
+    m_read_buf = m_read_chain.data();
+    m_read_idx = m_read_chain.size();
+    m_checked_idx -= shift;
+    m_start_line -= shift;
+    if(m_line_colon >= 0) m_line_colon -= shift;
+    return true;
+}
+
+
+//连接关闭时调用，读缓冲区的slab归还到池中
+void 
+http_conn::release_buffer(){
+    m_read_chain.release();
+    m_read_buf = nullptr;
+    m_read_idx = 0;
+    m_checked_idx = 0;
+    m_start_line = 0;
+    m_line_colon = -1;
+}
+
+
 //关闭连接，客户总量-1
 //可以发现，此时关闭了连接，但是似乎没有关闭当前定时器！
 //待发现是否存在bug
@@ -126,22 +198,25 @@ void http_conn::close_conn(bool real_close) {
 // process_read 依赖 read_once 提供的数据：read_once 将数据从 socket 中读取到缓冲区，然后 process_read 在缓冲区中解析数据。
 // read_once 只负责数据读取，而 process_read 负责数据解析,后者可以真正做到数据读取的拦截
 bool http_conn::read_once() {
-    if(m_read_idx >= READ_BUFFER_SIZE)
-        return false;
+    compact_read_buf();
 
     int bytes_read = 0;
     if(m_TRIGMode == 0) {  // LT读取数据(水平触发)
-        bytes_read = m_client->recv(m_read_buf + m_read_idx, READ_BUFFER_SIZE - m_read_idx, 0);
-        m_read_idx += bytes_read;
-
+        if(!reserve_read_buf())
+            return false;
+        bytes_read = m_client->recv(m_read_buf + m_read_idx, m_read_chain.writable(), 0);
         if(bytes_read <= 0)
             return false;
+        m_read_chain.commit(bytes_read);
+        m_read_idx += bytes_read;
         return true;
     }
     else {  // ET读取数据(边沿触发)
         //由于这个是需要一次性读取完数据的，所以有循环et模式和非循环et模式，
         while(true) {
-            bytes_read = m_client->recv(m_read_buf + m_read_idx, READ_BUFFER_SIZE - m_read_idx, 0);
+            if(!reserve_read_buf())
+                return false;
+            bytes_read = m_client->recv(m_read_buf + m_read_idx, m_read_chain.writable(), 0);
             if(bytes_read == -1) {
                 if(errno == EAGAIN || errno == EWOULDBLOCK) //说明后面没有数据了
                     break;
@@ -150,6 +225,7 @@ bool http_conn::read_once() {
             else if(bytes_read == 0) { // 说明根本就没有读的内容
                 return false;
             }
+            m_read_chain.commit(bytes_read);
             m_read_idx += bytes_read; // 说明有内容
         }
         return true;
@@ -166,7 +242,18 @@ http_conn::parse_line(){
 
     // m_read_idx: 一开始用水平触发LT或者边缘触发ET读取的内容数据的长度，
     // 数据是存放到m_read_buf中的，通过webserver调用read_once
-    for (; m_checked_idx < m_read_idx; ++m_checked_idx) {
+    // ScanLine一次跳到下一个'\r'或'\n'，顺便记下行内第一个':'给parse_headers用
+    while(m_checked_idx < m_read_idx) {
+        LineScan scan;
+        ScanLine(m_read_buf + m_checked_idx, m_read_idx - m_checked_idx, scan);
+        if(m_line_colon < 0 && scan.colon != LineScan::npos) {
+            m_line_colon = m_checked_idx + scan.colon;
+        }
+        m_checked_idx += scan.end;
+        if(m_checked_idx == m_read_idx) {
+            break;
+        }
+
         temp = m_read_buf[m_checked_idx];
         if(temp == '\r') { //回车符号
             if( (m_checked_idx + 1) == m_read_idx) {
@@ -175,15 +262,16 @@ http_conn::parse_line(){
             else if(m_read_buf[m_checked_idx+1] == '\n'){ // correct
                 m_read_buf[m_checked_idx++] = '\0';
                 m_read_buf[m_checked_idx++] = '\0';
-                return LINE_OK;
+                return finish_line();
             }
+            ++m_checked_idx; // 行内单独的'\r'，继续找
         } 
-        else if(temp =='\n'){
+        else { // '\n'
             //加上m_checked_idx > 1的目的是防止溢出
             if(m_checked_idx > 1 && m_read_buf[m_checked_idx-1] =='\r') {
                 m_read_buf[m_checked_idx-1] = '\0';
                 m_read_buf[m_checked_idx++] = '\0';
-                return LINE_OK;
+                return finish_line();
             }
             return LINE_BAD;
         }
@@ -192,11 +280,26 @@ http_conn::parse_line(){
 }
 
 
+//读到完整的一行，把行内':'的位置交给parse_headers，开始记录下一行
+http_conn::LINE_STATUS 
+http_conn::finish_line(){
+    m_colon = (m_line_colon >= 0) ? m_read_buf + m_line_colon : nullptr;
+    m_line_end = m_read_buf + m_checked_idx - 2;
+    m_line_colon = -1;
+    return LINE_OK;
+}
+
+
 //解析http请求行，获得请求方法，目标url以及版本号
 //这里解析的内容主要放置到类的成员先储存起来，后面会用到
 //请求行的意思详情看语雀笔记
 http_conn::HTTP_CODE 
 http_conn::parse_request_line(char* text) {
+    // HTTP/2连接前言的第一行，之后的数据交给Http2Conn
+    if(strcmp(text, "PRI * HTTP/2.0") == 0) {
+        return H2_PREFACE;
+    }
+
     //返回出现在这个第二个字符串集合中的第一个属于字符串1的下标的后面的内容
     m_url = strpbrk(text," \t");
     if(!m_url) {
@@ -209,7 +312,6 @@ http_conn::parse_request_line(char* text) {
         m_method = GET;
     else if(strcasecmp(method, "POST") == 0){
         m_method = POST;
-        cgi = 1; //为什么：这个cgi是用来干嘛的？是否启用的post
     }
     else {
         return BAD_REQUEST; // 如果都没有这两个请求，这个项目只处理了get和post
@@ -240,9 +342,6 @@ http_conn::parse_request_line(char* text) {
     if(!m_url || m_url[0] != '/') { //说明出现了错误了，可能后面没有内容了，所以没有截取到'/'
         return BAD_REQUEST;
     }
-    //当url为/时，显示判断界面         为什么此时要
-    if(strlen(m_url) == 1)
-        strcat(m_url, "judge.html");
     m_check_state = CHECK_STATE_HEADER;
     return NO_REQUEST;
 }
@@ -250,6 +349,7 @@ http_conn::parse_request_line(char* text) {
 
 //解析http请求的一个头部信息(逐行解析)
 //这里的内容会被循环调用
+//所有请求头都原样记入m_headers(不拷贝)，只有影响解析和响应方式的几个在这里处理
 http_conn::HTTP_CODE 
 http_conn::parse_headers(char* text, bool& decide_proxy){
     if(text[0] =='\0') {
@@ -259,35 +359,40 @@ http_conn::parse_headers(char* text, bool& decide_proxy){
         }
         return GET_REQUEST;
     }
-    else if(strncasecmp(text, "Connection:", 11) == 0) {
-        text += 11;
-        text += strspn(text," \t");
-        ////已删除根据客户端的意愿而设置是否为长还是短连接(改成服务端自行选择）
-//        if(strcasecmp(text,"keep-alive")==0)
-//        {
-//            m_linger=true;
-//        }
-    }
-    else if (strncasecmp(text, "Content-length:", 15) == 0) {
-        text+=15;
-        text+=strspn(text," \t");
-        m_content_length=atol(text); //获取这个字符串的长度
-    }
-    else if(strncasecmp(text, "Host:", 5) == 0 ) {  //比较text字符串前5个字符组成的字符串是否与Host:匹配
-        text += 5;
-        text += strspn(text," \t"); //重置这里为开头
-        m_host = text;             //获取其内容
-    }
-    // else if(strncasecmp(text,"X-Forwarded-By:",15)==0 ) { //说明是nginx转发的
-    //     if(obj->ProxyType==1) //如果没有选择nginx反向代理，固然将nginx访问过来的数据进行拦截
-    //     {
-    //         return BAD_REQUEST;
-    //     }
-    //     decide_proxy=false; //为了最后进行判断的时候用到的（判断有nginx的时候是否用了对应的无nginx模式）
-    // }
-    else {
-        //输出到日志系统，查看头部有什么额外的标识，可能是发送方自己多额外增加了一些标识
-        LOG_INFO("[HTTP_CONN] oop!unknow header: %s", text);
+    if(!m_colon) { // 不是"名字: 值"格式的请求头，忽略
+        return NO_REQUEST;
+    }
+
+    // 名字的长度和值的位置在扫描行尾时已经得到，去掉值前后的空白
+    size_t name_len = m_colon - text;
+    char* value = m_colon + 1;
+    value += strspn(value, " \t");
+    char* end = m_line_end;
+    while(end > value && (end[-1] == ' ' || end[-1] == '\t')) {
+        --end;
+    }
+    *end = '\0';
+
+    HeaderId id = LookupHeader(text, name_len);
+    if(!m_headers.add(id, text, name_len, value, end - value)) { // 请求头太多
+        return BAD_REQUEST;
+    }
+
+    switch(id) {
+    case HeaderId::CONTENT_LENGTH:
+        m_content_length=atol(value); //获取这个字符串的长度
+        if(m_content_length < 0 || m_content_length > MAX_REQUEST_SIZE) {
+            return BAD_REQUEST;
+        }
+        break;
+    case HeaderId::ACCEPT_ENCODING:
+        parse_accept_encoding(value);
+        break;
+    // Connection: 已删除根据客户端的意愿而设置是否为长还是短连接(改成服务端自行选择）
+    // Range/If-Range/If-None-Match/If-Modified-Since: 在do_request/process_write中从m_headers取用
+    // X-Forwarded-For等代理请求头: 留给处理函数从m_headers取用
+    default:
+        break;
     }
     
     return NO_REQUEST;
@@ -298,8 +403,8 @@ http_conn::parse_headers(char* text, bool& decide_proxy){
 http_conn::HTTP_CODE 
 http_conn::parse_content(char * text) {
     if(m_read_idx >= (m_content_length + m_checked_idx) ) {
-        text[m_content_length] ='\0';
         //post请求中最后为输入的用户名和密码
+        //请求体后面可能紧跟着流水线的下一个请求，不能补'\0'，按m_content_length取用
         m_string = text;
         return GET_REQUEST;
     }
@@ -320,11 +425,11 @@ http_conn::process_read() {
     //否则出现了全局的错误（即有一个nginx的请求过来，那么此时将变量设置了false，那么再来一个9006端口，就会误认为是nginx请求过来的）
 
     //这个循环一开始默认是进入 ||右边的那个 ( (line_status=parse_line() )==LINE_OK，后面弄完之后就会开始请求头以及请求体的处理了
+    //请求体不按行解析：请求体分几次读到时，m_checked_idx要一直停在请求体开头
     while( (m_check_state==CHECK_STATE_CONTENT &&line_status==LINE_OK)
-          || ( (line_status=parse_line() )==LINE_OK) ) //分析当前行状态是否和此时设置的line_status状态一致
+          || (m_check_state!=CHECK_STATE_CONTENT && (line_status=parse_line() )==LINE_OK) ) //分析当前行状态是否和此时设置的line_status状态一致
     {
         text=get_line();
-        LOG_INFO("[HTTP_CONN]: %s", text);
 
         m_start_line = m_checked_idx;
 
@@ -336,6 +441,9 @@ http_conn::process_read() {
                 if(ret==BAD_REQUEST){
                     return BAD_REQUEST;       //比如说不能处理put这些请求的情况，会出现BAD_REQUEST
                 }
+                if(ret==H2_PREFACE){
+                    return H2_PREFACE;
+                }
                 break;
             }
             case CHECK_STATE_HEADER:
@@ -382,114 +490,95 @@ http_conn::do_request(bool & decide_proxy) {
     //     }
     // }
 
-    strcpy(m_real_file, doc_root); //将文件的根目录，然后赋值到m_real_file这里
-    int len = strlen(doc_root);
-    
-    const char* p = strrchr(m_url, '/'); //里面的值不能变,查找'/'第一次出现的位置
-    //处理cgi，判断是哪种请求方式
-    if(cgi == 1 && (*(p+1) == '2' || *(p+1) == '3' ) ){
-        
-        // char flag = m_url[1]; // 判断是登录检测还是注册检测
-
-        // step1: 提取真正的URL
-        char* m_url_real = (char *)malloc(sizeof(char) * 200);
-        strcpy(m_url_real, "/");
-        strcat(m_url_real, m_url + 2);
-        // 将m_url_real的字符串复制前第三个参数然后给到第一个字符串中
-        strncpy(m_real_file + len, m_url_real, FILENAME_LEN-len-1); 
-        free(m_url_real);
-    
-        // step2: 提取用户名和密码
-        // ex: name=absc&password=123456
-        char name[100], password[100];
-        {
-            int i = 0;
-            for(i = 5; m_string[i] != '&'; ++i) // 因为m_string[5]才是信息
-                name[i-5] = m_string[i];
-            name[i-5] ='\0';
-
-            int j = 0;
-            for(i = i + 10; m_string[i] != '\0'; ++i,++j) // 因为m_string[5]才是信息
-                password[j] = m_string[i];
-            password[j] ='\0';
-        }
-
-        // step3: 处理业务
-        if(*(p+1) == '3') { // 注册
-            // 先检测数据库中是否有重名的，没有重名才允许加
-            char* sql_insert = (char*)malloc(sizeof(char)*200);
-            strcpy(sql_insert, "INSERT INTO user(username, passwd) VALUES(");
-            strcat(sql_insert, "'");
-            strcat(sql_insert, name);
-            strcat(sql_insert, "', '");
-            strcat(sql_insert, password);
-            strcat(sql_insert, "')");
-
-            if(users.find(name) == users.end()) { //说明没有找到,用户表维护在一个map中
-                m_lock.lock();
-                int res = mysql_query(mysql, sql_insert); //访问连接的数据库里面是否有记录
-                users[name] = password;
-                m_lock.unlock();
-
-                if(!res) //说明没有，则重新回到登录界面，先进行一个赋值
-                    strcpy(m_url, "/log.html");
-                else 
-                    strcpy(m_url, "/registerError.html");
-            }
-            else {
-                strcpy(m_url, "/registerError.html");
-            }
-            //如果是登录，直接判断
-            //若浏览器端输入的用户名和密码在表中可以查找到，返回1，否则返回0
-        }
-        else if (*(p + 1) == '2') {
-            if(users.find(name) != users.end() && users[name] == password)
-                // 登录成功
-                strcpy(m_url, "/welcome.html");
-            else 
-                strcpy(m_url, "/logError.html");
-        }
+    // h2c升级：回复101之后这个请求作为HTTP/2的流1处理，带请求体的请求不升级
+    if(m_content_length == 0 && save_h2_upgrade()) {
+        return H2_UPGRADE;
     }
 
-    //上面的2或者3代表登录以及注册
-    //下面的就是其他状态的界面了
-    if( *(p+1) == '0') {
-        char *m_url_real=(char*)malloc(sizeof(char)*200 );
-        strcpy(m_url_real, "/register.html");
-        strncpy(m_real_file+len,m_url_real,strlen(m_url_real) );
+    // 路由：首页、页面跳转、登录/注册交给注册的处理函数，其余按静态文件处理
+    // m_url在读缓冲区里，不能原地改写(后面可能是流水线的下一个请求)，路径和查询串都只引用
+    HttpRequest req;
+    size_t url_len = strcspn(m_url, "?");
+    req.method = m_method;
+    req.path = std::string_view(m_url, url_len);
+    if(m_url[url_len] == '?') {
+        req.query = std::string_view(m_url + url_len + 1);
+    }
+    if(m_string) { // 请求体没有'\0'结尾，按m_content_length取用
+        req.body = std::string_view(m_string, m_content_length);
+    }
+    req.headers = &m_headers;
 
-        free(m_url_real);
+    // WebSocket握手：只接受注册了处理函数的路径
+    if(m_headers.has(HeaderId::SEC_WEBSOCKET_KEY)) {
+        HTTP_CODE ret = check_websocket(req.path);
+        if(ret != NO_REQUEST) {
+            return ret;
+        }
     }
-    else if( *(p+1) == '1') {
-        char * m_url_real=(char*)malloc(sizeof(char)*200 );
-        strcpy(m_url_real,"/log.html");
-        strncpy(m_real_file + len, m_url_real, strlen(m_url_real));
 
-        free(m_url_real);
+    std::string_view file;  // 最终要返回的页面
+    switch(Router::get_instance()->dispatch(1u << m_method, req, file, &m_allow)) {
+    case 200: break;
+    case 400: return BAD_REQUEST;
+    case 403: return FORBIDDEN_REQUEST;
+    case 404: return NO_RESOURCE;
+    case 405: return BAD_METHOD;
+    default: return INTERNAL_ERROR;
+    }
+
+    int len = strlen(doc_root);
+    size_t file_len = std::min(file.size(), (size_t)(FILENAME_LEN - len - 1));
+    memcpy(m_real_file, doc_root, len); //将文件的根目录，然后赋值到m_real_file这里
+    memcpy(m_real_file + len, file.data(), file_len);
+    m_real_file[len + file_len] = '\0';
+
+    // 按扩展名的Cache-Control，预压缩文件也按原文件的类型
+    m_max_age = CacheControl::get_instance()->getMaxAge(m_real_file);
+
+    // 可压缩类型按Accept-Encoding发送.br/.gz预压缩文件或压缩缓存，Range请求只针对原文件；
+    // 但带Range的请求回退成200时同样可能进响应缓存，Vary不能因为Range而省掉
+    if(CompressCache::isCompressible(m_real_file)) {
+        m_vary = true;
+        if(!m_headers.has(HeaderId::RANGE) && select_encoding()) { // 压缩缓存命中
+            return is_not_modified(m_headers, m_file_stat, m_content_encoding) ? NOT_MODIFIED : FILE_REQUEST;
+        }
     }
-    else if( *(p+1) == '5') {
-        char *m_url_real = (char *)malloc(sizeof(char) * 200);
-        strcpy(m_url_real, "/picture.html");
-        strncpy(m_real_file + len, m_url_real, strlen(m_url_real));
 
-        free(m_url_real);
+    // 响应缓存命中时整条响应已序列化好，不再stat/open/mmap，也不再格式化响应头
+    ResponseCache* resp_cache = ResponseCache::get_instance();
+    if(resp_cache->isEnabled()) {
+        m_response = resp_cache->lookup(m_real_file, m_linger);
+        if(m_response) {
+            m_file_stat = m_response->st;
+            if(is_not_modified(m_headers, m_file_stat, m_content_encoding)) {
+                m_response.reset();
+                return NOT_MODIFIED;
+            }
+            return FILE_REQUEST;
+        }
     }
-    else if( *(p+1) == '6') {
-        char *m_url_real = (char *)malloc(sizeof(char) * 200);
-        strcpy(m_url_real, "/video.html");
-        strncpy(m_real_file + len, m_url_real, strlen(m_url_real));
 
-        free(m_url_real);
+    // 条件请求只stat，文件没有变化时直接回复304，不再open/mmap
+    if(m_headers.has(HeaderId::IF_NONE_MATCH) || m_headers.has(HeaderId::IF_MODIFIED_SINCE)) {
+        if(stat(m_real_file, &m_file_stat) == 0
+            && S_ISREG(m_file_stat.st_mode)
+            && (m_file_stat.st_mode & S_IROTH)
+            && is_not_modified(m_headers, m_file_stat, m_content_encoding)) {
+            return NOT_MODIFIED;
+        }
     }
-    else if( *(p+1) == '7') {
-        char *m_url_real = (char *)malloc(sizeof(char) * 200);
-        strcpy(m_url_real, "/fans.html");
-        strncpy(m_real_file + len, m_url_real, strlen(m_url_real));
 
-        free(m_url_real);
+    // 打开文件缓存命中时直接复用缓存的fd、stat和映射，不再stat/open/mmap
+    // 未命中且不是可读普通文件时，仍走下面的流程区分出错类型
+    FileCache* file_cache = FileCache::get_instance();
+    if(file_cache->isEnabled()) {
+        m_file_entry = file_cache->acquire(m_real_file);
+        if(m_file_entry) {
+            m_file_stat = m_file_entry->st;
+            return FILE_REQUEST;
+        }
     }
-    else 
-        strncpy(m_real_file+len, m_url, FILENAME_LEN-len-1);
 
     //stat 函数将把所获取的文件状态信息填充到这个结构体中文件类型（如常规文件、目录等）
     ////文件权限
@@ -507,147 +596,630 @@ http_conn::do_request(bool & decide_proxy) {
         return BAD_REQUEST;
 
     int fd = open(m_real_file,O_RDONLY); //只读的方式打开这个文件，然后由于在linux下，返回一个文件描述符（这个文件就是要发送的文件了）
+    if(fd < 0) {
+        return NO_RESOURCE;
+    }
+
+    // sendfile模式：保留fd，发送时由内核直接从页缓存拷贝到socket，不做映射
+    // 不入缓存的文件也用FileCache::Entry包装，发送完最后一个引用释放时close/munmap
+    if(m_sendfile) {
+        m_file_entry = std::make_shared<FileCache::Entry>(m_real_file, fd, m_file_stat, nullptr);
+        return FILE_REQUEST;
+    }
+
         ////  MAP_PRIVATE 对映射区域的写入操作会产生一个映射文件的复制，即私人的“写入时复制”（copy on write）对此区域作的任何修改都不会写回原来的文件内容
         ////  m_file_address是系统帮你映射的那个内存地址
-    m_file_address = (char*)mmap(0, m_file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0); //做映射，具体看语雀(这个和要传输的视频文件相关联的)(它也可以做到内存共享)
-    //这里主要是将一个普通文件映射到内存中，通常在需要对文件进行频繁读写时使用
+    char* file_address = nullptr;
+    if(m_file_stat.st_size > 0) {
+        file_address = (char*)mmap(0, m_file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0); //做映射，具体看语雀(这个和要传输的视频文件相关联的)(它也可以做到内存共享)
+        //这里主要是将一个普通文件映射到内存中，通常在需要对文件进行频繁读写时使用
+        if(file_address == MAP_FAILED) {
+            ::close(fd);
+            return INTERNAL_ERROR;
+        }
+    }
     ::close(fd);
+    m_file_entry = std::make_shared<FileCache::Entry>(m_real_file, -1, m_file_stat, file_address);
     
     return FILE_REQUEST;
 }
 
 
-//解除上面函数最后所做的那个映射
+//把一段内存数据加入发送队列，hold保证数据在发送完之前有效
 void 
-http_conn::unmap() {
-    if(m_file_address) {
-        munmap(m_file_address, m_file_stat.st_size);
-        m_file_address = 0; // reset
+http_conn::push_segment(const char* base, size_t len, std::shared_ptr<const void> hold) {
+    if(len == 0) {
+        return;
     }
+    m_out.push_back(out_segment{base, len, -1, 0, std::move(hold)});
 }
 
 
-//write 则负责实际将数据发送给客户端，处理发送中的错误、进度更新等操作。
+//把文件的一段区间加入发送队列，由sendfile发送
+void 
+http_conn::push_file_segment(int fd, off_t offset, size_t len, std::shared_ptr<const void> hold) {
+    if(len == 0) {
+        return;
+    }
+    m_out.push_back(out_segment{nullptr, len, fd, offset, std::move(hold)});
+}
+
+
+//把文件的[offset, offset+len)加入发送队列
+//响应缓存命中时从缓存的响应体里取，sendfile模式用文件区间，否则用映射
+void 
+http_conn::push_body(off_t offset, size_t len) {
+    if(m_variant) {
+        push_segment(m_variant->data.data() + offset, len, m_variant);
+    }
+    else if(m_response) {
+        const std::string& data = m_response->data;
+        push_segment(data.data() + data.size() - m_file_stat.st_size + offset, len, m_response);
+    }
+    else if(m_sendfile && m_file_entry->fd != -1) {
+        push_file_segment(m_file_entry->fd, offset, len, m_file_entry);
+    }
+    else {
+        push_segment(m_file_entry->addr + offset, len, m_file_entry);
+    }
+}
+
+
+//解析Range请求头，只支持bytes单位，例如：bytes=0-499, 1000-, -500
+//没有Range、语法错误或区间数超过MAX_RANGES时忽略Range，返回整个文件
+//返回值：200整个文件，206部分内容(区间在m_ranges中)，416区间都超出了文件大小
+int 
+http_conn::parse_range() {
+    m_range_count = 0;
+    off_t size = m_file_stat.st_size;
+    const char* range = m_headers.getCStr(HeaderId::RANGE);
+    if(!range || size == 0 || strncasecmp(range, "bytes=", 6) != 0) {
+        return 200;
+    }
+    if(m_headers.has(HeaderId::IF_RANGE) && !if_range_match()) { // 文件已经变化，返回整个文件
+        return 200;
+    }
+
+    char* p = (char*)range + 6; // strtoll需要char**
+    while(true) {
+        p += strspn(p, " \t");
+        off_t start = -1, end = size - 1;
+        if(*p == '-') { // 后缀区间：最后n个字节
+            ++p;
+            if(!isdigit(*p)) {
+                return 200;
+            }
+            off_t n = strtoll(p, &p, 10);
+            if(n > 0) {
+                start = (n >= size) ? 0 : size - n;
+            }
+        }
+        else {
+            if(!isdigit(*p)) {
+                return 200;
+            }
+            start = strtoll(p, &p, 10);
+            if(*p++ != '-') {
+                return 200;
+            }
+            if(isdigit(*p)) {
+                end = strtoll(p, &p, 10);
+                if(end < start) {
+                    return 200;
+                }
+                end = std::min(end, size - 1);
+            }
+            if(start >= size) { // 不可满足的区间跳过
+                start = -1;
+            }
+        }
+
+        if(start != -1) {
+            if(m_range_count == MAX_RANGES) {
+                return 200;
+            }
+            m_ranges[m_range_count].start = start;
+            m_ranges[m_range_count].end = end;
+            ++m_range_count;
+        }
+
+        p += strspn(p, " \t");
+        if(*p == '\0') {
+            break;
+        }
+        if(*p++ != ',') {
+            return 200;
+        }
+    }
+    return m_range_count > 0 ? 206 : 416;
+}
+
+
+//If-Range为实体标签时与当前ETag做强比较，为HTTP日期时与文件的修改时间比较
+//一致才按Range返回
 bool 
-http_conn::write() {
-    int temp = 0;
-    if(bytes_to_send == 0) {//发送字节数==0
-        //改成关注读事件
-        init(); //这个是初始化新的连接,将很多置为0
-        return true;
+http_conn::if_range_match() {
+    const char* if_range = m_headers.getCStr(HeaderId::IF_RANGE);
+    if(if_range[0] == '"') {
+        char etag[64];
+        bool weak;
+        make_etag(m_file_stat, m_content_encoding, etag, sizeof(etag), weak);
+        return !weak && strcmp(if_range, etag) == 0;
+    }
+    if(strncmp(if_range, "W/", 2) == 0) { // 弱ETag不能用于If-Range
+        return false;
+    }
+
+    char date[32];
+    FormatHttpDate(m_file_stat.st_mtime, date, sizeof(date));
+    return strcmp(if_range, date) == 0;
+}
+
+
+//由inode、大小、修改时间生成ETag，压缩版本带上编码以区别于原文件
+//文件在1秒内刚被修改过时，同一秒内再次修改修改时间不会变，只能生成弱ETag
+int 
+http_conn::make_etag(const struct stat& st, const char* encoding, char* buf, size_t len, bool& weak) {
+    weak = (time(NULL) - st.st_mtime) < 1;
+    // 最长为 W/"16-16-16-encoding" 
+    size_t enc_len = encoding ? strlen(encoding) : 0;
+    if(len < 2 + 3 * 17 + 2 + enc_len + 1) {
+        return -1;
     }
 
-    while(1) {
-        //疑问：如果当前sockfd被删除了，这个函数会出现段错误吗？可能会，具体得调试(具体得看响应时间，即write的时间，以及主线程中定时器处理当前m_sockfd的超时时间）
-        //一旦epoll数量大，那么就会出现很多错误
-        //具体看语雀：【（重点）项目缺点：考虑epoll监听数量大的时候会出现的问题】
-        temp = m_client->writev(m_iv, m_iv_count);
-        if(temp < 0) { //表示写入失败
-            if (errno == EAGAIN) { //这种可能还没有写入的权力，那么我们就将其关注写的能力，将当前协程yield,然后到点的时候回来
+    char* p = buf;
+    if(weak) {
+        *p++ = 'W';
+        *p++ = '/';
+    }
+    *p++ = '"';
+    p += FormatHex((uint64_t)st.st_ino, p);
+    *p++ = '-';
+    p += FormatHex((uint64_t)st.st_size, p);
+    *p++ = '-';
+    p += FormatHex((uint64_t)st.st_mtime, p);
+    if(encoding) {
+        *p++ = '-';
+        memcpy(p, encoding, enc_len);
+        p += enc_len;
+    }
+    *p++ = '"';
+    *p = '\0';
+    return p - buf;
+}
+
+
+//条件请求：If-None-Match优先，按弱比较匹配列表中的任意一个ETag；否则看If-Modified-Since
+bool 
+http_conn::is_not_modified(const HeaderTable& headers, const struct stat& st, const char* encoding) {
+    const char* if_none_match = headers.getCStr(HeaderId::IF_NONE_MATCH);
+    const char* if_modified_since = headers.getCStr(HeaderId::IF_MODIFIED_SINCE);
+    if(if_none_match) {
+        if(strcmp(if_none_match, "*") == 0) {
+            return true;
+        }
+
+        char etag[64];
+        bool weak;
+        make_etag(st, encoding, etag, sizeof(etag), weak);
+        const char* opaque = weak ? etag + 2 : etag; // 去掉"W/"
+        size_t len = strlen(opaque);
+
+        const char* p = if_none_match;
+        while(*p) {
+            p += strspn(p, " \t,");
+            if(strncmp(p, "W/", 2) == 0) {
+                p += 2;
+            }
+            if(strncmp(p, opaque, len) == 0 
+                && (p[len] == '\0' || p[len] == ',' || p[len] == ' ' || p[len] == '\t')) {
                 return true;
             }
-            unmap();
+            p += strcspn(p, ",");
+        }
+        return false;
+    }
+
+    if(if_modified_since) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        if(strptime(if_modified_since, "%a, %d %b %Y %H:%M:%S GMT", &tm)) {
+            return st.st_mtime <= timegm(&tm);
+        }
+    }
+    return false;
+}
+
+
+//验证器和缓存策略：ETag、Last-Modified、按扩展名配置的Cache-Control，以及内容编码
+bool 
+http_conn::add_validators() {
+    char etag[64];
+    bool weak;
+    int etag_len = make_etag(m_file_stat, m_content_encoding, etag, sizeof(etag), weak);
+    char date[32];
+    size_t date_len = FormatHttpDate(m_file_stat.st_mtime, date, sizeof(date));
+    if(!add_literal("ETag:") || !add_bytes(etag, etag_len) 
+        || !add_literal("\r\nLast-Modified:") || !add_bytes(date, date_len) || !add_literal("\r\n")) {
+        return false;
+    }
+
+    if(m_max_age >= 0 
+        && (!add_literal("Cache-Control:max-age=") || !add_uint(m_max_age) || !add_literal("\r\n"))) {
+        return false;
+    }
+    if(m_content_encoding 
+        && (!add_literal("Content-Encoding:") || !add_bytes(m_content_encoding, strlen(m_content_encoding)) 
+            || !add_literal("\r\n"))) {
+        return false;
+    }
+    if(m_vary) {
+        return add_literal("Vary:Accept-Encoding\r\n");
+    }
+    return true;
+}
+
+
+//解析Accept-Encoding，例如：gzip, deflate, br;q=0.8，q=0表示不接受
+void 
+http_conn::parse_accept_encoding(const char* text) {
+    const char* p = text;
+    while(*p) {
+        p += strspn(p, " \t,");
+        const char* name = p;
+        size_t len = strcspn(p, " \t,;");
+        p += len;
+
+        bool accept = true;
+        size_t param_len = strcspn(p, ",");
+        const char* q = (const char*)memmem(p, param_len, "q=", 2);
+        if(q && atof(q + 2) == 0) {
+            accept = false;
+        }
+        p += param_len;
+
+        if(len == 4 && strncasecmp(name, "gzip", 4) == 0) {
+            m_accept_gzip = accept;
+        }
+        else if(len == 2 && strncasecmp(name, "br", 2) == 0) {
+            m_accept_br = accept;
+        }
+    }
+}
+
+
+//Upgrade: h2c且HTTP2-Settings合法时，把请求转换成HTTP/2形式保存下来
+//伪头部在前，名字转为小写，去掉逐跳请求头
+bool 
+http_conn::save_h2_upgrade() {
+    const char* upgrade = m_headers.getCStr(HeaderId::UPGRADE);
+    const char* settings = m_headers.getCStr(HeaderId::HTTP2_SETTINGS);
+    if(!upgrade || !settings || strcasecmp(upgrade, "h2c") != 0) {
+        return false;
+    }
+
+    std::unique_ptr<Http2Upgrade> up(new Http2Upgrade);
+    if(!Base64Decode(settings, up->settings)) {
+        return false;
+    }
+
+    static const char* method_names[] = {"GET", "POST", "HEAD", "PUT", "DELETE", "TRACE", "OPTIONS", "CONNECT", "PATCH"};
+    up->headers.push_back(HpackHeader{":method", method_names[m_method]});
+    up->headers.push_back(HpackHeader{":scheme", "http"});
+    up->headers.push_back(HpackHeader{":path", m_url});
+    if(m_headers.has(HeaderId::HOST)) {
+        up->headers.push_back(HpackHeader{":authority", std::string(m_headers.get(HeaderId::HOST))});
+    }
+    for(const HttpHeader& h : m_headers) {
+        switch(h.id) {
+        case HeaderId::HOST:
+        case HeaderId::CONNECTION:
+        case HeaderId::KEEP_ALIVE:
+        case HeaderId::PROXY_CONNECTION:
+        case HeaderId::TRANSFER_ENCODING:
+        case HeaderId::UPGRADE:
+        case HeaderId::HTTP2_SETTINGS:
+            continue;
+        default:
+            break;
+        }
+        HpackHeader header{std::string(h.getName()), std::string(h.getValue())};
+        std::transform(header.name.begin(), header.name.end(), header.name.begin(), ::tolower);
+        up->headers.push_back(std::move(header));
+    }
+    m_h2_upgrade = std::move(up);
+    return true;
+}
+
+
+//WebSocket握手(RFC 6455 4.2.1)：GET、Upgrade: websocket、版本13、16字节的key
+//路径没有注册处理函数时返回NO_REQUEST，按普通请求处理
+http_conn::HTTP_CODE 
+http_conn::check_websocket(std::string_view path) {
+    const char* upgrade = m_headers.getCStr(HeaderId::UPGRADE);
+    if(!upgrade || strcasecmp(upgrade, "websocket") != 0) {
+        return NO_REQUEST;
+    }
+    const WebSocketRouter::Handler* handler = WebSocketRouter::get_instance()->find(path);
+    if(!handler) {
+        return NO_REQUEST;
+    }
+
+    std::string_view key = m_headers.get(HeaderId::SEC_WEBSOCKET_KEY);
+    std::string nonce;
+    if(m_method != GET || m_content_length != 0 
+        || m_headers.get(HeaderId::SEC_WEBSOCKET_VERSION) != "13"
+        || !Base64Decode(key, nonce) || nonce.size() != 16) {
+        return BAD_REQUEST;
+    }
+
+    std::string accept;
+    WebSocket::AcceptKey(key, accept);
+    memcpy(m_ws_accept, accept.data(), accept.size());
+    m_ws_accept[accept.size()] = '\0';
+    m_ws_handler = handler;
+    return WS_UPGRADE;
+}
+
+
+//选择压缩版本：原文件旁边有.br/.gz预压缩文件时替换m_real_file，按普通文件发送；
+//否则查gzip压缩缓存，未命中时由后台线程压缩，本次发送原文件
+//压缩缓存命中返回true
+bool 
+http_conn::select_encoding() {
+    size_t len = strlen(m_real_file);
+    struct stat st;
+    if(len + 3 < FILENAME_LEN) {
+        if(m_accept_br) {
+            strcpy(m_real_file + len, ".br");
+            if(stat(m_real_file, &st) == 0 && S_ISREG(st.st_mode)) {
+                m_content_encoding = "br";
+                return false;
+            }
+        }
+        if(m_accept_gzip) {
+            strcpy(m_real_file + len, ".gz");
+            if(stat(m_real_file, &st) == 0 && S_ISREG(st.st_mode)) {
+                m_content_encoding = "gzip";
+                return false;
+            }
+        }
+        m_real_file[len] = '\0';
+    }
+
+    CompressCache* compress_cache = CompressCache::get_instance();
+    if(m_accept_gzip && compress_cache->isEnabled()
+        && stat(m_real_file, &st) == 0
+        && S_ISREG(st.st_mode)
+        && (st.st_mode & S_IROTH)) {
+        m_variant = compress_cache->lookup(m_real_file, st);
+        if(m_variant) {
+            m_file_stat = st;
+            m_file_stat.st_size = m_variant->data.size();
+            m_content_encoding = "gzip";
+            return true;
+        }
+    }
+    return false;
+}
+
+
+//生成206响应，只有请求的字节区间被发送
+//单个区间直接作为响应体；多个区间用multipart/byteranges，各部分的分隔行放在一块单独的内存里
+bool 
+http_conn::add_partial_content(int start) {
+    off_t size = m_file_stat.st_size;
+    add_status_line(206);
+    add_validators();
+
+    if(m_range_count == 1) {
+        const byte_range& r = m_ranges[0];
+        add_literal("Content-Range:bytes ");
+        add_uint(r.start);
+        add_literal("-");
+        add_uint(r.end);
+        add_literal("/");
+        add_uint(size);
+        add_literal("\r\n");
+        if(!add_headers(r.end - r.start + 1)) {
             return false;
         }
+        push_segment(m_write_buf + start, m_write_idx - start);
+        push_body(r.start, r.end - r.start + 1);
+        return true;
+    }
+
+    std::shared_ptr<std::string> parts = std::make_shared<std::string>();
+    size_t offsets[MAX_RANGES + 1];
+    off_t content_len = 0;
+    char line[128];
+    for(int i = 0; i < m_range_count; ++i) {
+        offsets[i] = parts->size();
+        int n = snprintf(line, sizeof(line), "\r\n--%s\r\nContent-Range:bytes %lld-%lld/%lld\r\n\r\n", 
+                        byteranges_boundary, (long long)m_ranges[i].start, 
+                        (long long)m_ranges[i].end, (long long)size);
+        parts->append(line, n);
+        content_len += m_ranges[i].end - m_ranges[i].start + 1;
+    }
+    offsets[m_range_count] = parts->size();
+    parts->append("\r\n--").append(byteranges_boundary).append("--\r\n");
+    content_len += parts->size();
+
+    add_literal("Content-Type:multipart/byteranges; boundary=");
+    add_bytes(byteranges_boundary, strlen(byteranges_boundary));
+    add_literal("\r\n");
+    if(!add_headers(content_len)) {
+        return false;
+    }
+    push_segment(m_write_buf + start, m_write_idx - start);
+    for(int i = 0; i < m_range_count; ++i) {
+        push_segment(parts->data() + offsets[i], offsets[i+1] - offsets[i], parts);
+        push_body(m_ranges[i].start, m_ranges[i].end - m_ranges[i].start + 1);
+    }
+    push_segment(parts->data() + offsets[m_range_count], 
+                parts->size() - offsets[m_range_count], parts);
+    return true;
+}
 
-        bytes_have_send += temp; //写入的个数+
-        bytes_to_send -= temp;   //待写的个数-
-        if(bytes_have_send >= m_iv[0].iov_len) { //说明第一个的数据发送完了，然后开始对第二个进行操作
-            m_iv[0].iov_len = 0;
-            m_iv[1].iov_base = m_file_address + (bytes_have_send-m_write_idx);
-            m_iv[1].iov_len = bytes_to_send;
+
+//write 则负责实际将数据发送给客户端，处理发送中的错误、进度更新等操作。
+//发送队列里是一批流水线响应：相邻的内存块(响应头、映射的文件、缓存的响应)合并成一次writev，
+//文件区间用sendfile发送，其前面的内存块带MSG_MORE发出，让内核与随后的文件数据合并成满MSS的报文
+//hook后的writev/sendmsg/sendfile遇到EAGAIN会挂起当前协程，恢复后从断点继续发送
+bool 
+http_conn::write() {
+    if(m_out.empty()) { // 没有要发送的响应(请求还不完整)
+        return true;
+    }
+
+    struct iovec iv[MAX_IOV];
+    while(m_out_idx < m_out.size()) {
+        out_segment& seg = m_out[m_out_idx];
+        ssize_t temp = 0;
+
+        if(seg.fd != -1) { // 文件区间
+            temp = m_client->sendfile(seg.fd, &seg.offset, seg.len);
+            if(temp <= 0) { // 0表示文件在发送过程中被截断
+                if(temp < 0 && errno == EAGAIN) {
+                    return true;
+                }
+                break;
+            }
         }
-        else {
-            m_iv[0].iov_base = m_write_buf + bytes_have_send;
-            m_iv[0].iov_len = m_iv[0].iov_len - bytes_have_send;
-        }
-
-        //bytes_to_send <= 0说明已经成功写入到客户端了,将数据发送过去了
-        if(bytes_to_send <= 0){
-            unmap();
-            // 为了保证是短连接，所以此时不用将其监听成读，后面在handle中自动删除这个事件，以及描述符
-            // 这个的作用是为了查看这个外来请求是否是长短连接的，如果是，那么就true，否则为false,
-            // 然后对应定时器的这些都会被线程池处理掉
-            if(m_linger){
-                init();
-                return true;
+        else { // 合并相邻的内存块
+            int cnt = 0;
+            size_t idx = m_out_idx;
+            for(; idx < m_out.size() && m_out[idx].fd == -1 && cnt < MAX_IOV; ++idx, ++cnt) {
+                iv[cnt].iov_base = (void*)m_out[idx].base;
+                iv[cnt].iov_len = m_out[idx].len;
+            }
+            if(idx < m_out.size() && m_out[idx].fd != -1) {
+                temp = m_client->send(iv, cnt, MSG_MORE);
             }
             else {
-                return false;
+                temp = m_client->writev(iv, cnt);
+            }
+            if(temp < 0) { //表示写入失败
+                if(errno == EAGAIN) {
+                    return true;
+                }
+                break;
+            }
+        }
+
+        // 按已发送的字节数推进发送队列
+        size_t sent = temp;
+        while(sent > 0 && m_out_idx < m_out.size()) {
+            out_segment& cur = m_out[m_out_idx];
+            if(cur.fd != -1) { // sendfile已经推进了offset
+                cur.len -= sent;
+                sent = 0;
+            }
+            else if(sent < cur.len) {
+                cur.base += sent;
+                cur.len -= sent;
+                sent = 0;
+            }
+            else {
+                sent -= cur.len;
+                cur.len = 0;
+            }
+            if(cur.len == 0) {
+                cur.hold.reset();
+                ++m_out_idx;
             }
         }
     }
+
+    bool done = (m_out_idx >= m_out.size());
+    m_out.clear();
+    m_out_idx = 0;
+    m_write_idx = 0;
+    // 为了保证是短连接，所以此时不用将其监听成读，后面在handle中自动删除这个事件，以及描述符
+    return done && m_linger;
 }
 
 
-//这个不是响应部分，这个是用于输出到日志上的，通过流，输出到日志是通过套接字函数来输出的write吧
-bool http_conn::add_response(const char * format,...) {
-    if(m_write_idx>=WRITE_BUFFER_SIZE)
-        return false;   
-    
-    va_list arg_list;
-    va_start(arg_list, format);
-    int len = vsnprintf(m_write_buf+m_write_idx, WRITE_BUFFER_SIZE-1-m_write_idx, format, arg_list);
-    // m_write_idx为偏移量大小
-    if (len >= (WRITE_BUFFER_SIZE - 1 - m_write_idx)) {
-        va_end(arg_list);
+//响应头直接拷贝进写缓冲区，放不下时返回false
+//不格式化、不分配内存、不打日志：每个响应都会调用很多次
+bool 
+http_conn::add_bytes(const char* data, size_t len) {
+    if(m_write_idx + len >= WRITE_BUFFER_SIZE) {
         return false;
     }
+    memcpy(m_write_buf + m_write_idx, data, len);
     m_write_idx += len;
-    va_end(arg_list);
+    return true;
+}
+
 
-    // 将对应内容打到一个日志中，这个是最终目的
-    LOG_INFO("[HTTP_CONN] request: %s\n", m_write_buf);
+bool 
+http_conn::add_uint(uint64_t value) {
+    if(m_write_idx + 20 >= WRITE_BUFFER_SIZE) {
+        return false;
+    }
+    m_write_idx += FormatUint(value, m_write_buf + m_write_idx);
     return true;
 }
 
 
-bool http_conn::add_status_line(int status,const char * title) {
-    return add_response("%s %d %s\r\n","HTTP/1.1",status,title);
+//预先拼好的状态行，加上每秒刷新一次的Date
+bool 
+http_conn::add_status_line(int status) {
+    const status_line* line = &status_lines[sizeof(status_lines) / sizeof(status_lines[0]) - 1]; // 未知状态码按500
+    for(const status_line& l : status_lines) {
+        if(l.status == status) {
+            line = &l;
+            break;
+        }
+    }
+    return add_bytes(line->line, line->len) 
+        && add_literal("Date:") && add_bytes(GetCachedHttpDate(), 29) && add_literal("\r\n");
 }
 
 
 bool 
-http_conn::add_headers(int content_len) {
+http_conn::add_headers(off_t content_len) {
     return add_content_length(content_len)&&add_linger()&&add_blank_line();
 }
 
 
 bool 
-http_conn::add_content_length(int content_len) {    //将数据长度给弄出来，将其长度输出到日志上
-    return add_response("Content-Length:%d\r\n",content_len);
+http_conn::add_content_length(off_t content_len) {
+    return add_literal("Content-Length:") && add_uint(content_len) && add_literal("\r\n");
 }
 
 
 bool http_conn::add_content_type() {
-    return add_response("Content-Type:%s\r\n","text/html");
+    return add_literal("Content-Type:text/html\r\n");
 }
 
 
 bool http_conn::add_linger() {
-    return add_response("Connection:%s\r\n", (m_linger == true) ? "keep-alive" : "close"); //将其是否连接状态发给到对应的日志上
+    return m_linger ? add_literal("Connection:keep-alive\r\n") : add_literal("Connection:close\r\n");
 }
 
 
 bool http_conn::add_blank_line() { //用于换行的
-    return add_response("%s", "\r\n");
+    return add_literal("\r\n");
 }
 
 
 bool http_conn::add_content(const char * content) {
-    return add_response("%s",content);
+    return add_bytes(content, strlen(content));
 }
 
 
-//这个函数的输出是将需要发送的响应数据准备好，并设置好 iovec 结构（m_iv）和总字节数 (bytes_to_send)，以便后续通过 write 函数实际发送。
+//这个函数的输出是将需要发送的响应数据准备好，响应头追加到写缓冲区，连同响应体一起按顺序加入发送队列，以便后续通过 write 函数实际发送。
 //主要负责构建 HTTP 响应数据，并准备好数据结构，供后续发送使用
 bool 
 http_conn::process_write(HTTP_CODE ret) {
+    int start = m_write_idx; // 流水线中前面请求的响应头还在写缓冲区里
     switch(ret)
     {
         case INTERNAL_ERROR:
         {
-            add_status_line(500,error_500_title);
+            add_status_line(500);
             add_headers(strlen(error_500_form) );
             if(!add_content(error_500_form) )
                 return false;
@@ -655,7 +1227,15 @@ http_conn::process_write(HTTP_CODE ret) {
         }
         case BAD_REQUEST:
         {
-            add_status_line(404, error_404_title);
+            add_status_line(404);
+            add_headers(strlen(error_404_form));
+            if (!add_content(error_404_form))
+                return false;
+            break;
+        }
+        case NO_RESOURCE:
+        {
+            add_status_line(404);
             add_headers(strlen(error_404_form));
             if (!add_content(error_404_form))
                 return false;
@@ -663,23 +1243,103 @@ http_conn::process_write(HTTP_CODE ret) {
         }
         case FORBIDDEN_REQUEST:
         {
-            add_status_line(403, error_403_title);
+            add_status_line(403);
             add_headers(strlen(error_403_form));
             if (!add_content(error_403_form))
                 return false;
             break;
         }
+        case BAD_METHOD:
+        {
+            add_status_line(405);
+            add_literal("Allow:");
+            if((m_allow & ROUTE_GET) && (m_allow & ROUTE_POST)) {
+                add_literal("GET, POST");
+            }
+            else if(m_allow & ROUTE_GET) {
+                add_literal("GET");
+            }
+            else if(m_allow & ROUTE_POST) {
+                add_literal("POST");
+            }
+            add_literal("\r\n");
+            add_headers(strlen(error_405_form));
+            if (!add_content(error_405_form))
+                return false;
+            break;
+        }
+        case H2_UPGRADE:
+        {
+            add_status_line(101);
+            if(!add_literal("Connection:Upgrade\r\nUpgrade:h2c\r\n\r\n"))
+                return false;
+            m_linger = true; // 之后由Http2Conn接管连接
+            break;
+        }
+        case WS_UPGRADE:
+        {
+            add_status_line(101);
+            if(!add_literal("Connection:Upgrade\r\nUpgrade:websocket\r\nSec-WebSocket-Accept:")
+                || !add_bytes(m_ws_accept, strlen(m_ws_accept)) || !add_literal("\r\n\r\n"))
+                return false;
+            m_linger = true; // 之后由WebSocket接管连接
+            break;
+        }
+        case NOT_MODIFIED:
+        {
+            add_status_line(304);
+            if(!add_validators() || !add_linger() || !add_blank_line())
+                return false;
+            break;
+        }
         case FILE_REQUEST:
         {
-            add_status_line(200,ok_200_title);
+            int status = parse_range();
+            if(status == 206) { // 只发送请求的字节区间
+                return add_partial_content(start);
+            }
+            if(status == 416) {
+                add_status_line(416);
+                add_literal("Content-Range:bytes */");
+                add_uint(m_file_stat.st_size);
+                add_literal("\r\n");
+                if(!add_headers(0))
+                    return false;
+                break;
+            }
+
+            // 状态行和Date每次生成，响应缓存里只有之后的响应头和响应体
+            add_status_line(200);
+            size_t status_len = m_write_idx - start;
+            if(m_response) { // 响应缓存命中
+                push_segment(m_write_buf + start, m_write_idx - start);
+                push_segment(m_response->data.data(), m_response->data.size(), m_response);
+                return true;
+            }
+
             if(m_file_stat.st_size != 0) { //首先检查文件大小是否为0
-                add_headers(m_file_stat.st_size);
-                m_iv[0].iov_base = m_write_buf;
-                m_iv[0].iov_len = m_write_idx;
-                m_iv[1].iov_base = m_file_address;
-                m_iv[1].iov_len = m_file_stat.st_size;
-                m_iv_count = 2; //表示要发送两个数据块
-                bytes_to_send = m_write_idx+m_file_stat.st_size;
+                add_literal("Accept-Ranges:bytes\r\n");
+                add_validators();
+                if(!add_headers(m_file_stat.st_size)) {
+                    return false;
+                }
+
+                // 小文件连同响应头一起放入响应缓存，之后从缓存发送
+                const char* body = m_variant ? nullptr : m_file_entry->addr; // 压缩缓存本身就在内存里
+                ResponseCache* resp_cache = ResponseCache::get_instance();
+                if(body && resp_cache->isCacheable(m_file_stat.st_size)) {
+                    size_t head = start + status_len;
+                    m_response = resp_cache->insert(m_real_file, m_linger, 
+                                                    m_write_buf + head, m_write_idx - head, 
+                                                    body, m_file_stat);
+                    m_write_idx = head; // 其余响应头已经在缓存的响应里了
+                    push_segment(m_write_buf + start, head - start);
+                    push_segment(m_response->data.data(), m_response->data.size(), m_response);
+                    return true;
+                }
+
+                push_segment(m_write_buf + start, m_write_idx - start);
+                push_body(0, m_file_stat.st_size); // sendfile模式下文件内容不经过用户态
                 return true;
             }
             else {
@@ -689,35 +1349,55 @@ http_conn::process_write(HTTP_CODE ret) {
                     return false;
                 }
             }
+            break;
         }
         default:
             return false;
     }
-    m_iv[0].iov_base = m_write_buf;
-    m_iv[0].iov_len = m_write_idx;
-    m_iv_count = 1;
-    bytes_to_send = m_write_idx;
+    push_segment(m_write_buf + start, m_write_idx - start);
     return true;
 }
 
 
+//处理读缓冲区里所有完整的请求(HTTP/1.1流水线)，响应按请求顺序加入发送队列，由一次write批量发出
+//写缓冲区快满时先停下，剩余的请求等这批响应发送完再处理
 bool 
 http_conn::process() {
     HTTP_CODE read_ret;
+    m_pipeline_pending = false;
 
-    // 读取请求
-    if( (read_ret=process_read()) == NO_REQUEST) {
-        return false;
-    }
-    
-    // 处理请求
-    bool write_ret = process_write(read_ret);
-    if (!write_ret) {
-        close_conn();
-        return false;
+    // 读取请求，NO_REQUEST说明剩下的数据不是完整的请求，等待继续读取
+    while( (read_ret=process_read()) != NO_REQUEST) {
+        if(read_ret == H2_PREFACE) { // 剩下的数据都交给Http2Conn
+            m_upgrade = UPGRADE_H2;
+            break;
+        }
+        if(read_ret == BAD_REQUEST) { // 无法再定位下一个请求的开头，回复后关闭连接
+            m_linger = false;
+        }
+
+        // 处理请求
+        bool write_ret = process_write(read_ret);
+        finish_request();
+        if (!write_ret) {
+            close_conn();
+            return false;
+        }
+
+        if(read_ret == H2_UPGRADE || read_ret == WS_UPGRADE) { // 101之后的数据都交给新协议
+            m_upgrade = (read_ret == H2_UPGRADE) ? UPGRADE_H2 : UPGRADE_WEBSOCKET;
+            break;
+        }
+        if(!m_linger) {
+            break;
+        }
+        if(m_write_idx > WRITE_BUFFER_SIZE - WRITE_RESERVE) {
+            m_pipeline_pending = true;
+            break;
+        }
     }
 
     return true;
 }
 
-} // namespace bryant
\ No newline at end of file
+} // namespace bryant
@@ -22,23 +22,43 @@
 // 该头文件声明了一些与I/O向量操作相关的函数和结构体。
 // 其中最常用的结构体是iovec，它用于在一次系统调用中传输多个非连续内存区域的数据
 // 例如在网络编程中使用readv()和writev()函数来进行分散读取和聚集写入。
+#include <algorithm>
 #include <map>
-#include <mysql/mysql.h>
+#include <memory>
+#include <vector>
 
 #include "../util/socket.hh"
 #include "../util/locker.hh"
+#include "../util/chain_buffer.hh"
 #include "../fiberLibrary/iomanager.hh"
 #include "../log/logger.hh"
-#include "../CGImysql/sql_connection_pool.hh"
+#include "file_cache.hh"
+#include "response_cache.hh"
+#include "cache_control.hh"
+#include "compress_cache.hh"
+#include "http_header.hh"
+#include "router.hh"
+#include "http2.hh"
+#include "websocket.hh"
 
 
 namespace bryant{
 
+// 错误页的内容, HTTP/2也使用
+extern const char *error_400_form;
+extern const char *error_403_form;
+extern const char *error_404_form;
+extern const char *error_405_form;
+extern const char *error_500_form;
+
 class http_conn {
 public:
     static const int FILENAME_LEN = 200;       // 文件名长度 静态即初始化
-    static const int READ_BUFFER_SIZE = 2048;  // 读入的缓冲区大小
+    static const int MAX_REQUEST_SIZE = 64 * 1024; // 单个请求(请求行+请求头+请求体)占用读缓冲区的上限
     static const int WRITE_BUFFER_SIZE = 1024; // 写入的缓冲区大小
+    static const int WRITE_RESERVE = 512;      // 流水线请求：写缓冲剩余不足该值时先发送已生成的响应
+    static const int MAX_IOV = 64;             // 一次writev合并的最大数据块数
+    static const int MAX_RANGES = 8;           // 一个Range请求最多的区间数，超出时返回整个文件
     
     // http请求方法
     enum METHOD
@@ -71,8 +91,21 @@ public:
         NO_RESOURCE,
         FORBIDDEN_REQUEST,
         FILE_REQUEST,
+        NOT_MODIFIED,
+        BAD_METHOD,
         INTERNAL_ERROR,
-        CLOSED_CONNECTION
+        CLOSED_CONNECTION,
+        H2_PREFACE,     // HTTP/2连接前言(先验知识)
+        H2_UPGRADE,     // Upgrade: h2c
+        WS_UPGRADE      // Upgrade: websocket
+    };
+
+    // 连接切换到的协议
+    enum UPGRADE
+    {
+        UPGRADE_NONE = 0,
+        UPGRADE_H2,
+        UPGRADE_WEBSOCKET
     };
 
     // 行状态
@@ -96,10 +129,11 @@ public:
      * @param passwd 
      * @param sqlname 
      * @param keepalive whether if keep long connection 
+     * @param use_sendfile send static file by sendfile instead of mmap+writev
      */
     void init(sylar::Socket::ptr &client, char* root, int TRIGMode, 
             std::string user, std::string passwd, std::string sqlname, 
-            bool keepalive);
+            bool keepalive, bool use_sendfile = false);
     
     /**
      * @brief close connection instance
@@ -109,13 +143,27 @@ public:
     void close_conn(bool real_close = true);
 
     /**
-     * @brief process
+     * @brief process all complete requests in read buffer (HTTP/1.1 pipelining)
      * 
      * @return true 
      * @return false 
      */
     bool process();
 
+    /**
+     * @brief whether if complete requests are left in read buffer because write buffer was full
+     * 
+     * @return true process() again before reading
+     */
+    bool has_pending_request() const {return m_pipeline_pending;}
+
+    /**
+     * @brief 读缓冲区里没有未处理的数据(没有读了一半的请求), 此时连接可以挂起
+     */
+    bool is_idle() const {
+        return !m_pipeline_pending && m_check_state == CHECK_STATE_REQUESTLINE && m_start_line == m_read_idx;
+    }
+
     /**
      * @brief read function in ET mode
      * 
@@ -143,29 +191,88 @@ public:
     }
 
     /**
-     * @brief initialize mysql result
+     * @brief Get the m_read_buf
      * 
-     * @param conn_pool 
+     * @return const char* 
      */
-    void initmysql_result(Connection_pool* conn_pool);
+    const char* getReadBuf() const {return m_read_buf;}
 
     /**
-     * @brief Get the m_read_buf
+     * @brief 当前请求的全部请求头, 指向读缓冲区, 请求处理完之前有效
      * 
-     * @return const char* 
+     * @return const HeaderTable& 
      */
-    const char* getReadBuf() const {return m_read_buf;}
+    const HeaderTable& getHeaders() const {return m_headers;}
+
+    /**
+     * @brief 连接要切换的协议: 收到了HTTP/2连接前言, 或者已经生成了h2c/WebSocket升级的101响应
+     */
+    UPGRADE get_upgrade() const {return m_upgrade;}
+
+    /**
+     * @brief h2c升级前的请求, 先验知识方式为nullptr
+     */
+    const Http2Upgrade* get_h2_upgrade() const {return m_h2_upgrade.get();}
+
+    /**
+     * @brief WebSocket升级的请求路径对应的处理函数
+     */
+    const WebSocketRouter::Handler* get_ws_handler() const {return m_ws_handler;}
+
+    /**
+     * @brief 读缓冲区中还没处理的数据, 切换协议时交给新协议
+     */
+    std::string_view pending_data() const {return std::string_view(m_read_buf + m_start_line, m_read_idx - m_start_line);}
+
+    /**
+     * @brief 连接关闭时调用，读缓冲区的slab归还到池中
+     */
+    void release_buffer();
+
+    /**
+     * @brief 由inode、大小、修改时间生成ETag, HTTP/2也使用
+     *
+     * @param st 文件状态
+     * @param encoding 压缩版本的编码, 原文件为nullptr
+     * @param buf
+     * @param len
+     * @param weak 返回是否为弱ETag
+     * @return int 长度, buf不够时返回-1
+     */
+    static int make_etag(const struct stat& st, const char* encoding, char* buf, size_t len, bool& weak);
+
+    /**
+     * @brief 条件请求(If-None-Match/If-Modified-Since)的验证器与文件是否一致
+     */
+    static bool is_not_modified(const HeaderTable& headers, const struct stat& st, const char* encoding);
 
 public:
     int timer_flag; // 用于定时器
     int improv;
 
     static int m_user_count;    // conn连接数
-    MYSQL* mysql;               // mysql对象
     int m_state;                // 读为0, 写为1, 设置状态的
 
+private:
+    // 发送队列中的一段数据：内存块由writev合并发送，文件区间由sendfile发送
+    struct out_segment {
+        const char* base;                   // 内存数据，fd为-1时有效
+        size_t len;                         // 剩余待发送字节数
+        int fd;                             // sendfile发送的文件
+        off_t offset;                       // 文件发送偏移
+        std::shared_ptr<const void> hold;   // 保证数据在发送完之前有效(文件缓存/响应缓存句柄)
+    };
+
+    // Range请求中的一个字节区间，闭区间
+    struct byte_range {
+        off_t start;
+        off_t end;
+    };
+
 private:
     void init();
+    void init_request();                                     // 重置单个请求的解析状态
+    void finish_request();                                   // 定位到流水线中的下一个请求
 
     // 解析请求
     HTTP_CODE process_read();                                // 进程读取
@@ -178,19 +285,35 @@ private:
     // tool
     char* get_line() { return m_read_buf + m_start_line; };  // 获取行
     LINE_STATUS parse_line();                                // 解析行
-    void unmap();
+    LINE_STATUS finish_line();                               // 读到完整的一行
+    void compact_read_buf();                                 // 丢弃已处理的请求，未处理的数据移到缓冲区开头
+    bool reserve_read_buf();                                 // 保证读缓冲区有空间，必要时增长
 
     // 响应请求
     bool process_write(HTTP_CODE ret);                       // 进程写入
-
-    bool add_response(const char* format, ...);              // 生成响应(总)->有限状态机：行、头、体
-    bool add_status_line(int status, const char* title);
-    bool add_headers(int content_length);
+    void push_segment(const char* base, size_t len, std::shared_ptr<const void> hold = nullptr);
+    void push_file_segment(int fd, off_t offset, size_t len, std::shared_ptr<const void> hold);
+    void push_body(off_t offset, size_t len);               // 把文件的一段加入发送队列(映射/sendfile/响应缓存)
+    int parse_range();                                       // 解析Range，返回响应状态码200/206/416
+    bool if_range_match();                                   // If-Range与当前文件是否一致
+    bool add_validators();                                   // ETag、Last-Modified、Cache-Control、内容编码
+    void parse_accept_encoding(const char* text);            // 解析Accept-Encoding
+    bool save_h2_upgrade();                                  // 保存h2c升级前的请求
+    HTTP_CODE check_websocket(std::string_view path);        // WebSocket握手
+    bool select_encoding();                                  // 选择预压缩文件或压缩缓存
+    bool add_partial_content(int start);                     // 生成206响应(单区间或multipart/byteranges)
+
+    bool add_bytes(const char* data, size_t len);             // 生成响应(总)：拷贝进写缓冲区
+    template<size_t N>
+    bool add_literal(const char (&text)[N]) {return add_bytes(text, N - 1);}
+    bool add_uint(uint64_t value);
+    bool add_status_line(int status);                        // 状态行 + Date
+    bool add_headers(off_t content_length);
     bool add_content(const char* content);
     
     // tool
     bool add_content_type();
-    bool add_content_length(int content_length);
+    bool add_content_length(off_t content_length);
     bool add_linger(); // 是否keep-Alive
     bool add_blank_line();
 
@@ -198,33 +321,50 @@ private:
     sylar::Socket::ptr m_client;            // 套接字的文件描述符对应的封装
     sockaddr_in m_address;                  // 为什么：用户socket地址？
 
-    char m_read_buf[READ_BUFFER_SIZE];      // 读缓冲区
+    ChainBuffer m_read_chain{MAX_REQUEST_SIZE}; // 由slab串起来的读缓冲区
+    char* m_read_buf;                       // 读缓冲区: m_read_chain当前的tail块，解析都在这里进行
     long m_read_idx;                        // 记录当前读取的下标位置
     long m_checked_idx;                     // 记录当前位置
     int m_start_line;                       // 记录开始行
+    long m_line_colon;                      // 正在扫描的行内第一个':'的位置，-1为还没有
+    char* m_colon;                          // 刚读完的一行中第一个':'，nullptr为没有
+    char* m_line_end;                       // 刚读完的一行的结尾('\0'的位置)
 
     char *m_url;                            // 存储URL
     char *m_version;                        // 存储HTTP版本
-    char *m_host;                           // 存储host名
+    HeaderTable m_headers;                  // 请求头表，名字和值都指向读缓冲区
     long m_content_length;                  // 存储报文内容长度
     bool m_linger;                          // 是否keep-Alive
     char* m_string;                         // 存储请求头数据
 
-    char *m_file_address;                   // 为什么：文件描述符的地址？
+    bool m_sendfile;                        // 是否用sendfile发送静态文件
+    FileCache::Entry::ptr m_file_entry;     // 文件句柄(映射/fd)，持有期间有效
+    ResponseCache::Response::ptr m_response;// 响应缓存句柄，非空时直接发送整条响应
     struct stat m_file_stat;                // 文件状态
+    bool m_accept_gzip;                     // 客户端接受gzip
+    bool m_accept_br;                       // 客户端接受br
+    bool m_vary;                            // 可压缩类型，响应随Accept-Encoding变化
+    const char* m_content_encoding;         // 发送的压缩版本的编码, 原文件为nullptr
+    CompressCache::Variant::ptr m_variant;  // 压缩缓存句柄，非空时发送缓存的gzip数据
+    int m_max_age;                          // Cache-Control: max-age, -1为不发送
+    byte_range m_ranges[MAX_RANGES];        // 解析出的字节区间
+    int m_range_count;                      // 字节区间数
     char m_real_file[FILENAME_LEN];         // 文件
-    int cgi;                                // 是否启用的post
+    uint32_t m_allow;                       // 405响应的Allow: 路径允许的方法(RouteMethod)
+    UPGRADE m_upgrade;                      // 切换到的协议
+    std::unique_ptr<Http2Upgrade> m_h2_upgrade; // h2c升级前的请求
+    const WebSocketRouter::Handler* m_ws_handler; // WebSocket连接的处理函数
+    char m_ws_accept[32];                   // Sec-WebSocket-Accept
     char* doc_root;                         // 已解决:服务器根目录
 
-    char m_write_buf[WRITE_BUFFER_SIZE];    // 写缓冲区
+    char m_write_buf[WRITE_BUFFER_SIZE];    // 写缓冲区，依次存放一批流水线响应的响应头
     int m_write_idx;                        // 记录当前写入的下标位置
     CHECK_STATE m_check_state;              // 当前状态：行，头，体
     METHOD m_method;                        // 返回一个请求方法类型
 
-    struct iovec m_iv[2];                   // writev相关
-    int m_iv_count;                         // writev相关
-    int bytes_to_send;                      // 当前待发送的字节数
-    int bytes_have_send;                    // 当前已发送的字节数
+    std::vector<out_segment> m_out;         // 发送队列，一批流水线响应按顺序排列
+    size_t m_out_idx;                       // 当前发送到的数据段
+    bool m_pipeline_pending;                // 写缓冲满时读缓冲中还留有未处理的请求
 
     int m_TRIGMode;                         // 触发模式
 
@@ -0,0 +1,202 @@
+#include <string.h>
+#include <strings.h>
+#include <array>
+
+#include "http_header.hh"
+
+namespace bryant{
+
+
+// 与HeaderId顺序一致
+static constexpr std::string_view s_names[] = {
+    "Accept",
+    "Accept-Charset",
+    "Accept-Encoding",
+    "Accept-Language",
+    "Authorization",
+    "Cache-Control",
+    "Connection",
+    "Content-Encoding",
+    "Content-Length",
+    "Content-Type",
+    "Cookie",
+    "Date",
+    "Expect",
+    "Forwarded",
+    "From",
+    "Host",
+    "HTTP2-Settings",
+    "If-Match",
+    "If-Modified-Since",
+    "If-None-Match",
+    "If-Range",
+    "If-Unmodified-Since",
+    "Keep-Alive",
+    "Origin",
+    "Pragma",
+    "Proxy-Connection",
+    "Range",
+    "Referer",
+    "Sec-WebSocket-Extensions",
+    "Sec-WebSocket-Key",
+    "Sec-WebSocket-Protocol",
+    "Sec-WebSocket-Version",
+    "TE",
+    "Transfer-Encoding",
+    "Upgrade",
+    "User-Agent",
+    "Via",
+    "X-Forwarded-For",
+    "X-Forwarded-Proto",
+    "X-Real-IP",
+};
+
+static_assert(sizeof(s_names) / sizeof(s_names[0]) == HEADER_ID_COUNT, "s_names must match HeaderId");
+
+
+static const size_t TABLE_SIZE = 128;   // 2的幂, 约为已知请求头数的3倍, 容易找到无冲突的种子
+
+static constexpr size_t max_name_len(){
+    size_t len = 0;
+    for(std::string_view name : s_names){
+        len = name.size() > len ? name.size() : len;
+    }
+    return len;
+}
+
+static const size_t MAX_NAME_LEN = max_name_len();
+
+
+// FNV-1a, 字符|0x20统一成小写(请求头名字只含字母、数字和'-', 不影响区分)
+static constexpr uint32_t hash_name(const char* s, size_t len, uint32_t seed){
+    uint32_t h = 2166136261u ^ seed ^ (uint32_t)len;
+    for(size_t i = 0; i < len; ++i){
+        h = (h ^ (uint8_t)(s[i] | 0x20)) * 16777619u;
+    }
+    return (h ^ (h >> 15)) & (TABLE_SIZE - 1);
+}
+
+
+// 编译期逐个尝试种子，直到所有已知请求头落在不同的槽里
+static constexpr uint32_t find_seed(){
+    for(uint32_t seed = 0; ; ++seed){
+        bool used[TABLE_SIZE] = {false};
+        bool ok = true;
+        for(std::string_view name : s_names){
+            uint32_t h = hash_name(name.data(), name.size(), seed);
+            if(used[h]){
+                ok = false;
+                break;
+            }
+            used[h] = true;
+        }
+        if(ok){
+            return seed;
+        }
+    }
+}
+
+static constexpr uint32_t s_seed = find_seed();
+
+
+// 槽 -> HeaderId, 空槽为UNKNOWN
+static constexpr std::array<HeaderId, TABLE_SIZE> build_table(){
+    std::array<HeaderId, TABLE_SIZE> table{};
+    for(size_t i = 0; i < TABLE_SIZE; ++i){
+        table[i] = HeaderId::UNKNOWN;
+    }
+    for(size_t i = 0; i < HEADER_ID_COUNT; ++i){
+        table[hash_name(s_names[i].data(), s_names[i].size(), s_seed)] = (HeaderId)i;
+    }
+    return table;
+}
+
+static constexpr std::array<HeaderId, TABLE_SIZE> s_table = build_table();
+
+
+HeaderId
+LookupHeader(const char* name, size_t len){
+    if(len == 0 || len > MAX_NAME_LEN){
+        return HeaderId::UNKNOWN;
+    }
+    // 一次哈希定位到唯一的候选，再比较一次名字
+    HeaderId id = s_table[hash_name(name, len, s_seed)];
+    if(id == HeaderId::UNKNOWN){
+        return id;
+    }
+    std::string_view expect = s_names[(size_t)id];
+    if(expect.size() != len || strncasecmp(name, expect.data(), len) != 0){
+        return HeaderId::UNKNOWN;
+    }
+    return id;
+}
+
+
+const char*
+HeaderName(HeaderId id){
+    if(id >= HeaderId::UNKNOWN){
+        return "";
+    }
+    return s_names[(size_t)id].data();
+}
+
+
+void
+HeaderTable::clear(){
+    memset(m_index, 0, sizeof(m_index));
+    m_size = 0;
+}
+
+
+bool
+HeaderTable::add(HeaderId id, const char* name, size_t name_len, const char* value, size_t value_len){
+    if(m_size >= MAX_HEADERS){
+        return false;
+    }
+    HttpHeader& header = m_headers[m_size++];
+    header.id = id;
+    header.name_len = (uint16_t)name_len;
+    header.value_len = (uint32_t)value_len;
+    header.name = name;
+    header.value = value;
+    if(id != HeaderId::UNKNOWN && m_index[(size_t)id] == 0){
+        m_index[(size_t)id] = (uint8_t)m_size;
+    }
+    return true;
+}
+
+
+std::string_view
+HeaderTable::get(HeaderId id) const{
+    if(id >= HeaderId::UNKNOWN || m_index[(size_t)id] == 0){
+        return std::string_view();
+    }
+    return m_headers[m_index[(size_t)id] - 1].getValue();
+}
+
+
+const char*
+HeaderTable::getCStr(HeaderId id) const{
+    if(id >= HeaderId::UNKNOWN || m_index[(size_t)id] == 0){
+        return nullptr;
+    }
+    return m_headers[m_index[(size_t)id] - 1].value;
+}
+
+
+std::string_view
+HeaderTable::get(std::string_view name) const{
+    HeaderId id = LookupHeader(name.data(), name.size());
+    if(id != HeaderId::UNKNOWN){
+        return get(id);
+    }
+    for(size_t i = 0; i < m_size; ++i){
+        const HttpHeader& header = m_headers[i];
+        if(header.name_len == name.size() && strncasecmp(header.name, name.data(), name.size()) == 0){
+            return header.getValue();
+        }
+    }
+    return std::string_view();
+}
+
+} // namespace bryant
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+namespace bryant{
+
+// 已知的请求头, 名字到编号的映射由编译期生成的完美哈希完成(见http_header.cc)
+enum class HeaderId : uint8_t {
+    ACCEPT = 0,
+    ACCEPT_CHARSET,
+    ACCEPT_ENCODING,
+    ACCEPT_LANGUAGE,
+    AUTHORIZATION,
+    CACHE_CONTROL,
+    CONNECTION,
+    CONTENT_ENCODING,
+    CONTENT_LENGTH,
+    CONTENT_TYPE,
+    COOKIE,
+    DATE,
+    EXPECT,
+    FORWARDED,
+    FROM,
+    HOST,
+    HTTP2_SETTINGS,
+    IF_MATCH,
+    IF_MODIFIED_SINCE,
+    IF_NONE_MATCH,
+    IF_RANGE,
+    IF_UNMODIFIED_SINCE,
+    KEEP_ALIVE,
+    ORIGIN,
+    PRAGMA,
+    PROXY_CONNECTION,
+    RANGE,
+    REFERER,
+    SEC_WEBSOCKET_EXTENSIONS,
+    SEC_WEBSOCKET_KEY,
+    SEC_WEBSOCKET_PROTOCOL,
+    SEC_WEBSOCKET_VERSION,
+    TE,
+    TRANSFER_ENCODING,
+    UPGRADE,
+    USER_AGENT,
+    VIA,
+    X_FORWARDED_FOR,
+    X_FORWARDED_PROTO,
+    X_REAL_IP,
+    UNKNOWN     // 其他请求头, 同时也是已知请求头的个数
+};
+
+static const size_t HEADER_ID_COUNT = (size_t)HeaderId::UNKNOWN;
+
+/**
+ * @brief 请求头名字 -> 编号, 不区分大小写
+ *
+ * @param name
+ * @param len
+ * @return HeaderId 不是已知请求头时返回UNKNOWN
+ */
+HeaderId LookupHeader(const char* name, size_t len);
+
+/**
+ * @brief 已知请求头的标准写法, UNKNOWN返回""
+ */
+const char* HeaderName(HeaderId id);
+
+
+// 一个请求头, 名字和值都直接指向读缓冲区, 值以'\0'结尾, 前后的空白已去掉
+struct HttpHeader {
+    HeaderId id;
+    uint16_t name_len;
+    uint32_t value_len;
+    const char* name;
+    const char* value;
+
+    std::string_view getName() const {return std::string_view(name, name_len);}
+    std::string_view getValue() const {return std::string_view(value, value_len);}
+};
+
+
+// 一个请求的全部请求头(零拷贝)
+// 按出现顺序保存，已知请求头另有按编号的索引，同名请求头重复出现时索引指向第一个。
+// 数据都在读缓冲区里，请求处理完(finish_request)之前有效。
+class HeaderTable {
+public:
+    static const size_t MAX_HEADERS = 64;   // 一个请求最多的请求头数
+
+    /**
+     * @brief 清空, 开始解析新请求时调用
+     */
+    void clear();
+
+    /**
+     * @brief 追加一个请求头
+     *
+     * @return false 请求头数超过上限
+     */
+    bool add(HeaderId id, const char* name, size_t name_len, const char* value, size_t value_len);
+
+    /**
+     * @brief 是否有这个已知请求头
+     */
+    bool has(HeaderId id) const {return id < HeaderId::UNKNOWN && m_index[(size_t)id] != 0;}
+
+    /**
+     * @brief 已知请求头的值, 没有时返回空
+     */
+    std::string_view get(HeaderId id) const;
+
+    /**
+     * @brief 已知请求头的值(以'\0'结尾), 没有时返回nullptr
+     */
+    const char* getCStr(HeaderId id) const;
+
+    /**
+     * @brief 按名字查找(不区分大小写), 也能查到未知请求头, 没有时返回空
+     */
+    std::string_view get(std::string_view name) const;
+
+    size_t size() const {return m_size;}
+
+    const HttpHeader& operator[](size_t i) const {return m_headers[i];}
+
+    const HttpHeader* begin() const {return m_headers;}
+
+    const HttpHeader* end() const {return m_headers + m_size;}
+
+private:
+    uint8_t m_index[HEADER_ID_COUNT] = {0};  // 编号 -> 在m_headers中的位置+1, 0为没有
+    size_t m_size = 0;
+    HttpHeader m_headers[MAX_HEADERS];        // 不初始化，只有前m_size个有效
+};
+
+} // namespace bryant
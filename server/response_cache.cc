@@ -0,0 +1,154 @@
+#include "response_cache.hh"
+#include "../util/util.hh"
+#include "../log/logger.hh"
+
+namespace bryant{
+
+
+// 同一文件的keep-alive/close两种响应头不同，分别缓存
+static std::string make_key(const char* path, bool keepalive){
+    std::string key(path);
+    key += keepalive ? "|k" : "|c";
+    return key;
+}
+
+
+ResponseCache*
+ResponseCache::get_instance(){
+    static ResponseCache cache;
+    return &cache;
+}
+
+
+void
+ResponseCache::init(size_t max_bytes, size_t max_body, uint64_t ttl_ms, bool stats){
+    m_mutex.lock();
+    m_max_bytes = max_bytes;
+    m_max_body = max_body;
+    m_ttl = ttl_ms;
+    m_stats = stats;
+    m_mutex.unlock();
+}
+
+
+ResponseCache::Response::ptr
+ResponseCache::lookup(const char* path, bool keepalive){
+    std::string key = make_key(path, keepalive);
+    uint64_t now = GetCurrentMS();
+    Response::ptr resp;
+
+    m_mutex.lock();
+    auto it = m_index.find(key);
+    if(it != m_index.end()){
+        resp = *it->second;
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        if(now - resp->check_time < m_ttl){
+            m_mutex.unlock();
+            if(m_stats){
+                ++m_hits;
+            }
+            return resp;
+        }
+    }
+    m_mutex.unlock();
+
+    // 过期则stat校验，文件未变化只刷新校验时间
+    if(resp){
+        struct stat st;
+        if(stat(path, &st) == 0
+            && st.st_ino == resp->st.st_ino
+            && st.st_size == resp->st.st_size
+            && st.st_mtime == resp->st.st_mtime){
+            m_mutex.lock();
+            resp->check_time = now;
+            m_mutex.unlock();
+            if(m_stats){
+                ++m_hits;
+            }
+            return resp;
+        }
+
+        m_mutex.lock();
+        auto cur = m_index.find(key);
+        if(cur != m_index.end() && *cur->second == resp){
+            eraseNoLock(key);
+        }
+        m_mutex.unlock();
+    }
+
+    if(m_stats){
+        ++m_misses;
+    }
+    return nullptr;
+}
+
+
+ResponseCache::Response::ptr
+ResponseCache::insert(const char* path, bool keepalive,
+                    const char* header, size_t header_len,
+                    const char* body, const struct stat& st){
+    std::shared_ptr<Response> resp = std::make_shared<Response>();
+    resp->key = make_key(path, keepalive);
+    resp->data.reserve(header_len + st.st_size);
+    resp->data.append(header, header_len);
+    resp->data.append(body, st.st_size);
+    resp->st = st;
+    resp->check_time = GetCurrentMS();
+
+    m_mutex.lock();
+    eraseNoLock(resp->key);
+    m_lru.push_front(resp);
+    m_index[resp->key] = m_lru.begin();
+    m_bytes += resp->data.size();
+
+    // 超出总字节数时从尾部淘汰
+    while(!m_lru.empty() && m_bytes > m_max_bytes){
+        eraseNoLock(m_lru.back()->key);
+    }
+    m_mutex.unlock();
+    return resp;
+}
+
+
+void
+ResponseCache::eraseNoLock(const std::string& key){
+    auto it = m_index.find(key);
+    if(it == m_index.end()){
+        return;
+    }
+    // 先删索引再删节点，key可能引用的就是被删节点里的字符串
+    LruList::iterator node = it->second;
+    m_index.erase(it);
+    m_bytes -= (*node)->data.size();
+    m_lru.erase(node);
+}
+
+
+void
+ResponseCache::clear(){
+    m_mutex.lock();
+    m_index.clear();
+    m_lru.clear();
+    m_bytes = 0;
+    m_mutex.unlock();
+}
+
+
+void
+ResponseCache::report(){
+    if(!m_stats){
+        return;
+    }
+    m_mutex.lock();
+    size_t entries = m_index.size();
+    size_t bytes = m_bytes;
+    m_mutex.unlock();
+
+    uint64_t hits = m_hits.load(std::memory_order_relaxed);
+    uint64_t misses = m_misses.load(std::memory_order_relaxed);
+    LOG_INFO("[ResponseCache] %zu entries, %zu bytes, hits %llu, misses %llu, hit rate %.2f%%",
+             entries, bytes, (unsigned long long)hits, (unsigned long long)misses,
+             hits + misses ? 100.0 * hits / (hits + misses) : 0.0);
+}
+
+} // namespace bryant
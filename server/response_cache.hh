@@ -0,0 +1,121 @@
+#pragma once
+
+#include <sys/stat.h>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "../util/locker.hh"
+
+namespace bryant{
+
+// 小文件的完整响应缓存
+// 响应头和文件内容序列化在一块连续内存里，命中时与状态行一起一次writev即可发完
+// 状态行和Date每次由http_conn生成，不放进缓存
+class ResponseCache {
+public:
+    /**
+     * @brief 缓存的响应，以shared_ptr作为引用计数句柄
+     */
+    struct Response {
+        using ptr = std::shared_ptr<const Response>;
+
+        std::string key;        // 文件路径 + 连接方式
+        std::string data;       // 响应头(状态行和Date之后的部分) + 响应体
+        struct stat st;         // 生成响应时的文件状态
+        mutable uint64_t check_time; // 最近一次校验文件未变化的时间(ms)
+    };
+
+    /**
+     * @brief Get the instance
+     *
+     * @return ResponseCache*
+     */
+    static ResponseCache* get_instance();
+
+    /**
+     * @brief initialize cache parameters
+     *
+     * @param max_bytes 缓存总字节数上限, 0表示关闭缓存
+     * @param max_body 可缓存文件的大小上限
+     * @param ttl_ms 缓存项有效期, 过期后命中时重新stat校验
+     * @param stats 是否统计命中/未命中次数
+     */
+    void init(size_t max_bytes, size_t max_body, uint64_t ttl_ms, bool stats);
+
+    /**
+     * @brief whether if cache is enabled
+     */
+    bool isEnabled() const {return m_max_bytes > 0;}
+
+    /**
+     * @brief whether if a file of this size can be cached
+     */
+    bool isCacheable(size_t body_size) const {return isEnabled() && body_size <= m_max_body;}
+
+    /**
+     * @brief 查找path对应的响应
+     *
+     * @param path 文件路径
+     * @param keepalive 响应头里的连接方式
+     * @return Response::ptr 未命中或文件已变化时返回nullptr
+     */
+    Response::ptr lookup(const char* path, bool keepalive);
+
+    /**
+     * @brief 缓存一条响应
+     *
+     * @param path 文件路径
+     * @param keepalive 响应头里的连接方式
+     * @param header 响应头(不含状态行和Date)
+     * @param header_len
+     * @param body 文件内容
+     * @param st 文件状态
+     * @return Response::ptr 新缓存的响应
+     */
+    Response::ptr insert(const char* path, bool keepalive,
+                        const char* header, size_t header_len,
+                        const char* body, const struct stat& st);
+
+    /**
+     * @brief 清空缓存
+     */
+    void clear();
+
+    /**
+     * @brief 输出缓存项数、字节数和命中率到日志, 未开启统计时什么都不做
+     */
+    void report();
+
+    uint64_t getHits() const {return m_hits;}
+
+    uint64_t getMisses() const {return m_misses;}
+
+private:
+    ResponseCache() = default;
+
+    /**
+     * @brief 删除缓存项, 需持有锁
+     */
+    void eraseNoLock(const std::string& key);
+
+private:
+    using LruList = std::list<Response::ptr>;
+
+    Mutex m_mutex;
+    LruList m_lru;                                              // 头部为最近使用
+    std::unordered_map<std::string, LruList::iterator> m_index; // key -> LRU节点
+
+    size_t m_max_bytes = 0;     // 最大总字节数
+    size_t m_max_body = 0;      // 单个文件上限
+    uint64_t m_ttl = 0;         // 有效期(ms)
+    size_t m_bytes = 0;         // 当前总字节数
+
+    bool m_stats = false;                   // 是否统计
+    std::atomic<uint64_t> m_hits = {0};     // 命中次数
+    std::atomic<uint64_t> m_misses = {0};   // 未命中次数
+};
+
+} // namespace bryant
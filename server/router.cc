@@ -0,0 +1,209 @@
+#include <string.h>
+
+#include "router.hh"
+
+namespace bryant{
+
+
+std::string_view
+HttpRequest::param(std::string_view name) const{
+    for(int i = 0; i < param_count; ++i){
+        if(params[i].name == name){
+            return params[i].value;
+        }
+    }
+    return std::string_view();
+}
+
+
+// trie的一个节点，对应路径中的一段
+struct Router::Node {
+    std::string segment;                            // 静态段的内容
+    std::vector<std::unique_ptr<Node> > children;   // 静态子节点
+    std::unique_ptr<Node> param;                    // ":name"子节点
+    std::string param_name;
+    std::unique_ptr<Node> wildcard;                 // "*name"子节点, 匹配剩余全部路径
+    std::string wildcard_name;
+
+    uint32_t methods = 0;                                   // 已注册的方法
+    std::vector<std::pair<uint32_t, Handler> > handlers;    // 方法 -> 处理函数
+};
+
+
+Router*
+Router::get_instance(){
+    static Router router;
+    return &router;
+}
+
+
+Router::Router()
+    :m_root(new Node){
+}
+
+
+Router::~Router(){
+}
+
+
+bool
+Router::addRoute(uint32_t methods, const std::string& pattern, Handler handler){
+    if(pattern.empty() || pattern[0] != '/' || methods == 0 || !handler){
+        return false;
+    }
+
+    Node* node = m_root.get();
+    int param_count = 0;
+    size_t pos = 0; // 指向'/'
+    while(pos != std::string::npos){
+        size_t start = pos + 1;
+        size_t next = pattern.find('/', start);
+        std::string seg = pattern.substr(start, next == std::string::npos ? std::string::npos : next - start);
+        pos = next;
+
+        if(!seg.empty() && (seg[0] == ':' || seg[0] == '*')){
+            std::string name = seg.substr(1);
+            if(name.empty() || ++param_count > HttpRequest::MAX_PARAMS){
+                return false;
+            }
+            bool is_param = (seg[0] == ':');
+            if(!is_param && pos != std::string::npos){ // "*name"只能是最后一段
+                return false;
+            }
+            std::unique_ptr<Node>& child = is_param ? node->param : node->wildcard;
+            std::string& child_name = is_param ? node->param_name : node->wildcard_name;
+            if(!child){
+                child.reset(new Node);
+                child_name = name;
+            }
+            else if(child_name != name){
+                return false;
+            }
+            node = child.get();
+            continue;
+        }
+
+        Node* found = nullptr;
+        for(auto& child : node->children){
+            if(child->segment == seg){
+                found = child.get();
+                break;
+            }
+        }
+        if(!found){
+            found = new Node;
+            found->segment = seg;
+            node->children.emplace_back(found);
+        }
+        node = found;
+    }
+
+    if(node->methods & methods){
+        return false;
+    }
+    node->methods |= methods;
+    node->handlers.emplace_back(methods, std::move(handler));
+    return true;
+}
+
+
+const Router::Node*
+Router::match(const Node* node, const char* pos, const char* end, HttpRequest& req) const{
+    if(pos == end){
+        return node->methods ? node : nullptr;
+    }
+
+    const char* start = pos + 1;
+    const char* slash = (const char*)memchr(start, '/', end - start);
+    if(!slash){
+        slash = end;
+    }
+    size_t len = slash - start;
+
+    // 静态段优先
+    for(const auto& child : node->children){
+        if(child->segment.size() == len && memcmp(child->segment.data(), start, len) == 0){
+            const Node* found = match(child.get(), slash, end, req);
+            if(found){
+                return found;
+            }
+            break;
+        }
+    }
+
+    // 参数段匹配一个非空的段，失败时撤销
+    if(node->param && len > 0 && req.param_count < HttpRequest::MAX_PARAMS){
+        HttpRequest::Param& param = req.params[req.param_count++];
+        param.name = node->param_name;
+        param.value = std::string_view(start, len);
+        const Node* found = match(node->param.get(), slash, end, req);
+        if(found){
+            return found;
+        }
+        --req.param_count;
+    }
+
+    // 通配段匹配剩余的全部路径
+    if(node->wildcard && node->wildcard->methods && req.param_count < HttpRequest::MAX_PARAMS){
+        HttpRequest::Param& param = req.params[req.param_count++];
+        param.name = node->wildcard_name;
+        param.value = std::string_view(start, end - start);
+        return node->wildcard.get();
+    }
+    return nullptr;
+}
+
+
+Router::Result
+Router::route(uint32_t method, HttpRequest& req, const Handler*& handler, uint32_t* allow) const{
+    handler = nullptr;
+    req.param_count = 0;
+    if(req.path.empty() || req.path[0] != '/'){
+        return NOT_FOUND;
+    }
+
+    const Node* node = match(m_root.get(), req.path.data(), req.path.data() + req.path.size(), req);
+    if(!node){
+        return NOT_FOUND;
+    }
+    for(const auto& entry : node->handlers){
+        if(entry.first & method){
+            handler = &entry.second;
+            return MATCHED;
+        }
+    }
+    if(allow){
+        *allow = node->methods;
+    }
+    return METHOD_NOT_ALLOWED;
+}
+
+
+int
+Router::dispatch(uint32_t method, HttpRequest& req, std::string_view& file, uint32_t* allow) const{
+    file = req.path;
+    const Handler* handler = nullptr;
+    switch(route(method, req, handler, allow)){
+    case MATCHED:
+    {
+        HttpResponse resp;
+        (*handler)(req, resp);
+        if(resp.status == 200 && !resp.file.empty()){
+            file = resp.file;
+        }
+        return resp.status;
+    }
+    case METHOD_NOT_ALLOWED:
+        return 405;
+    default: // 没有路由的按静态文件处理
+        return 200;
+    }
+}
+
+
+void
+Router::clear(){
+    m_root.reset(new Node);
+}
+
+} // namespace bryant
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "http_header.hh"
+
+namespace bryant{
+
+// 路由匹配的请求方法(位掩码), 第i位对应http_conn::METHOD中取值为i的方法
+enum RouteMethod : uint32_t {
+    ROUTE_GET = 1u << 0,
+    ROUTE_POST = 1u << 1,
+    ROUTE_HEAD = 1u << 2,
+    ROUTE_PUT = 1u << 3,
+    ROUTE_DELETE = 1u << 4,
+    ROUTE_ANY = 0xffffffffu
+};
+
+
+// 交给处理函数的请求，所有字段都指向连接的读缓冲区，处理函数返回后失效
+struct HttpRequest {
+    static const int MAX_PARAMS = 4;    // 路径参数(":name")的最大个数
+
+    struct Param {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    int method = 0;                     // http_conn::METHOD
+    std::string_view path;              // 不含查询串
+    std::string_view query;             // '?'之后的部分
+    std::string_view body;              // 请求体
+    const HeaderTable* headers = nullptr;
+    Param params[MAX_PARAMS];           // 路由匹配出的路径参数
+    int param_count = 0;
+
+    /**
+     * @brief 已知请求头的值, 没有时返回空
+     */
+    std::string_view header(HeaderId id) const {return headers ? headers->get(id) : std::string_view();}
+
+    /**
+     * @brief 路径参数的值, 没有时返回空
+     */
+    std::string_view param(std::string_view name) const;
+};
+
+
+// 处理函数的结果
+struct HttpResponse {
+    int status = 200;               // 200返回file, 400/403/404/500返回对应的错误页
+    std::string_view file;          // 要返回的页面(相对于根目录), 为空时返回请求路径对应的文件
+};
+
+
+// URL路由，启动时注册一次，之后只读，多个工作线程并发查找不加锁
+// 按路径段('/'分隔)组织的trie：静态段优先，其次":name"参数段，最后"*name"匹配剩余全部路径；
+// 查找只比较路径段，不分配内存，代价与路径长度成正比
+class Router {
+public:
+    using Handler = std::function<void(const HttpRequest& req, HttpResponse& resp)>;
+
+    enum Result {
+        MATCHED = 0,
+        NOT_FOUND,
+        METHOD_NOT_ALLOWED
+    };
+
+    /**
+     * @brief Get the instance
+     *
+     * @return Router*
+     */
+    static Router* get_instance();
+
+    Router();
+    ~Router();
+
+    Router(const Router&) = delete;
+    Router& operator=(const Router&) = delete;
+
+    /**
+     * @brief 注册路由
+     *
+     * @param methods RouteMethod的组合
+     * @param pattern 以'/'开头, 例如"/user/:id"; 以'*'开头的段(只能是最后一段)匹配剩余路径
+     * @param handler
+     * @return false 格式错误, 或同一路径同一方法已注册, 或同一位置参数名不一致
+     */
+    bool addRoute(uint32_t methods, const std::string& pattern, Handler handler);
+
+    /**
+     * @brief 查找路由, 匹配到的路径参数写入req.params
+     *
+     * @param method 请求方法的位(RouteMethod)
+     * @param req 输入req.path
+     * @param handler 匹配到的处理函数
+     * @param allow 路径存在但方法不匹配时返回允许的方法
+     * @return Result
+     */
+    Result route(uint32_t method, HttpRequest& req, const Handler*& handler, uint32_t* allow = nullptr) const;
+
+    /**
+     * @brief 查找路由并调用处理函数, HTTP/1.1和HTTP/2共用
+     *
+     * @param method 请求方法的位(RouteMethod)
+     * @param req
+     * @param file 返回要发送的页面: 处理函数指定的页面, 没有时为请求路径
+     * @param allow 返回405时为路径允许的方法
+     * @return int 200按file返回静态文件(包括没有匹配的路由), 405方法不允许, 其余为处理函数给出的错误状态
+     */
+    int dispatch(uint32_t method, HttpRequest& req, std::string_view& file, uint32_t* allow) const;
+
+    /**
+     * @brief 删除所有路由
+     */
+    void clear();
+
+private:
+    struct Node;
+
+    /**
+     * @brief 从node开始匹配path[pos, end), pos指向'/'
+     */
+    const Node* match(const Node* node, const char* pos, const char* end, HttpRequest& req) const;
+
+private:
+    std::unique_ptr<Node> m_root;
+};
+
+} // namespace bryant
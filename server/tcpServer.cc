@@ -1,4 +1,5 @@
 #include "tcpServer.hh"
+#include "../fiberLibrary/hook.hh"
 
 using namespace std;
 
@@ -89,6 +90,42 @@ void TcpServer::startAccept(sylar::Socket::ptr sock) {
 }
 
 
+//读事件回调和超时定时器谁先到谁处理，另一个什么都不做
+bool 
+TcpServer::parkClient(sylar::Socket::ptr client) {
+    IOManager* iom = IOManager::GetThis();
+    if(!iom) {
+        return false;
+    }
+
+    // 读事件回调和超时定时器谁先把fired置为true谁接管连接: exchange返回旧值, 为true说明对方已经接管
+    auto fired = std::make_shared<std::atomic<bool> >(false);
+    Timer::ptr timer = iom->addTimer(m_recvTimeout, [iom, client, fired]() {
+        if(fired->exchange(true)) {
+            return;
+        }
+        set_hook_enable(true);
+        iom->cancelAll(client->getSocket()); // 读事件回调被触发一次，看到fired后直接返回
+        client->close();
+    });
+
+    auto self = shared_from_this();
+    int rt = iom->addEvent(client->getSocket(), IOManager::READ, [self, client, timer, fired]() {
+        if(fired->exchange(true)) {
+            return;
+        }
+        timer->cancel();
+        self->handleClient(client);
+    });
+    if(rt) {
+        timer->cancel();
+        // 旧值为true: 定时器已经关闭了连接, 调用方不能再用; 为false: 这里抢到了, 定时器之后不会再动连接, 交还调用方
+        return fired->exchange(true);
+    }
+    return true;
+}
+
+
 bool TcpServer::start() {
     if(!m_isStop) { // 已经开启
         return true;
@@ -118,6 +118,16 @@ protected:
     */
     virtual void startAccept(sylar::Socket::ptr sock);
 
+    /**
+    * @brief 挂起空闲连接：不占用协程，只在epoll上登记一个读事件回调
+    * @details 下一次可读时在新协程里重新调用handleClient；超过接收超时仍没有数据时关闭连接
+    *
+    * @param client 没有读了一半的请求的连接
+    * @return true 连接已交出去(读事件回调或超时定时器负责)，调用方不能再使用client
+    * @return false 登记失败且连接仍然打开，调用方继续在本协程里阻塞读
+    */
+    bool parkClient(sylar::Socket::ptr client);
+
 protected:
     std::vector<sylar::Socket::ptr> m_socks;   // 监听Socket数组
 
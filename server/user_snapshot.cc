@@ -0,0 +1,272 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "user_snapshot.hh"
+#include "user_store.hh"
+#include "../log/logger.hh"
+
+namespace bryant{
+
+static const char MAGIC[8] = {'B', 'R', 'Y', 'U', 'S', 'N', 'A', 'P'};
+static const int TAG_SHIFT = 40;                            // 槽位的高24位是哈希, 低40位是偏移
+static const uint64_t OFFSET_MASK = (1ULL << TAG_SHIFT) - 1;
+static const size_t ENTRY_HEADER = 4;                       // 两个uint16长度
+static const size_t MIN_SLOTS = 16;
+
+
+UserSnapshot::~UserSnapshot(){
+    if(m_data){
+        munmap(m_data, m_size);
+    }
+}
+
+
+bool
+UserSnapshot::open(const std::string& path){
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0){
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(Header)){
+        close(fd);
+        LOG_ERROR("[UserSnapshot] %s: too small", path.c_str());
+        return false;
+    }
+    size_t size = st.st_size;
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED){
+        LOG_ERROR("[UserSnapshot] %s: mmap error %d", path.c_str(), errno);
+        return false;
+    }
+
+    //各段都必须落在文件内, 槽位数是2的幂且有空槽位(查找一定能结束)
+    const Header* header = (const Header*)data;
+    bool ok = memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0
+              && header->version == VERSION && header->header_size == sizeof(Header)
+              && header->heap_offset >= sizeof(Header) && header->heap_offset <= size
+              && header->heap_size <= size - header->heap_offset
+              && header->heap_size <= OFFSET_MASK
+              && header->slots_offset % sizeof(uint64_t) == 0 && header->slots_offset <= size
+              && header->slot_count >= MIN_SLOTS && (header->slot_count & (header->slot_count - 1)) == 0
+              && header->slot_count <= (size - header->slots_offset) / sizeof(uint64_t)
+              && header->count < header->slot_count;
+    if(!ok){
+        munmap(data, size);
+        LOG_ERROR("[UserSnapshot] %s: bad header or version", path.c_str());
+        return false;
+    }
+
+    if(m_data){
+        munmap(m_data, m_size);
+    }
+    m_data = data;
+    m_size = size;
+    m_header = header;
+    m_heap = (const char*)data + header->heap_offset;
+    m_slots = (const uint64_t*)((const char*)data + header->slots_offset);
+    return true;
+}
+
+
+bool
+UserSnapshot::entry(uint64_t offset, std::string_view* name, std::string_view* password) const{
+    uint64_t heap_size = m_header->heap_size;
+    if(offset < HEAP_START || offset > heap_size || heap_size - offset < ENTRY_HEADER){
+        return false;
+    }
+    uint16_t name_len, password_len;
+    memcpy(&name_len, m_heap + offset, sizeof(uint16_t));
+    memcpy(&password_len, m_heap + offset + sizeof(uint16_t), sizeof(uint16_t));
+    if(heap_size - offset - ENTRY_HEADER < (uint64_t)name_len + password_len){
+        return false;
+    }
+    const char* data = m_heap + offset + ENTRY_HEADER;
+    *name = std::string_view(data, name_len);
+    *password = std::string_view(data + name_len, password_len);
+    return true;
+}
+
+
+bool
+UserSnapshot::find(std::string_view name, std::string_view* password) const{
+    if(!m_header){
+        return false;
+    }
+    uint64_t hash = UserStore::Hash(name);
+    uint64_t tag = hash >> TAG_SHIFT;
+    uint64_t mask = m_header->slot_count - 1;
+    for(uint64_t n = 0, i = hash & mask; n <= mask; ++n, i = (i + 1) & mask){
+        uint64_t slot = m_slots[i];
+        if(slot == 0){
+            return false;
+        }
+        std::string_view entry_name, entry_password;
+        if((slot >> TAG_SHIFT) == tag && entry(slot & OFFSET_MASK, &entry_name, &entry_password) && entry_name == name){
+            if(password){
+                *password = entry_password;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void
+UserSnapshot::foreach(const std::function<void(std::string_view name, std::string_view password)>& cb) const{
+    if(!m_header){
+        return;
+    }
+    uint64_t offset = HEAP_START;
+    std::string_view name, password;
+    for(uint64_t n = 0; n < m_header->count && entry(offset, &name, &password); ++n){
+        cb(name, password);
+        offset += ENTRY_HEADER + name.size() + password.size();
+    }
+}
+
+
+std::string_view
+UserSnapshot::high_water_name() const{
+    std::string_view name, password;
+    if(!m_header || !entry(m_header->high_water_entry, &name, &password)){
+        return std::string_view();
+    }
+    return name;
+}
+
+
+UserSnapshotWriter::~UserSnapshotWriter(){
+    abort();
+}
+
+
+bool
+UserSnapshotWriter::open(const std::string& path){
+    abort();
+    m_path = path;
+    m_tmp_path = path + ".tmp";
+    //快照里有明文密码, 只允许属主读写; 临时文件是上次留下的时O_CREAT不改权限, 再fchmod一次, rename后权限不变
+    int fd = ::open(m_tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if(fd < 0 || fchmod(fd, 0600) < 0 || !(m_file = fdopen(fd, "wb"))){
+        LOG_ERROR("[UserSnapshot] create %s error %d", m_tmp_path.c_str(), errno);
+        if(fd >= 0){
+            close(fd);
+            unlink(m_tmp_path.c_str());
+        }
+        return false;
+    }
+    //文件头最后再写, 先占位; 堆前面留HEAP_START字节, 偏移0表示空槽位
+    char zeros[sizeof(UserSnapshot::Header) + UserSnapshot::HEAP_START] = {0};
+    m_heap_size = UserSnapshot::HEAP_START;
+    m_high_water = 0;
+    m_high_water_entry = 0;
+    m_entries.clear();
+    if(fwrite(zeros, sizeof(zeros), 1, m_file) != 1){
+        abort();
+        return false;
+    }
+    return true;
+}
+
+
+bool
+UserSnapshotWriter::append(std::string_view name, std::string_view password, uint64_t id){
+    if(!m_file){
+        return false;
+    }
+    if(name.size() > UINT16_MAX || password.size() > UINT16_MAX
+       || m_heap_size + ENTRY_HEADER + name.size() + password.size() > OFFSET_MASK){
+        LOG_ERROR("[UserSnapshot] user too long or snapshot too large, abort");
+        abort();
+        return false;
+    }
+    uint16_t lengths[2] = {(uint16_t)name.size(), (uint16_t)password.size()};
+    if(fwrite(lengths, sizeof(lengths), 1, m_file) != 1
+       || fwrite(name.data(), 1, name.size(), m_file) != name.size()
+       || fwrite(password.data(), 1, password.size(), m_file) != password.size()){
+        LOG_ERROR("[UserSnapshot] write %s error %d", m_tmp_path.c_str(), errno);
+        abort();
+        return false;
+    }
+    m_entries.emplace_back(UserStore::Hash(name), m_heap_size);
+    if(id > m_high_water){
+        m_high_water = id;
+        m_high_water_entry = m_heap_size;
+    }
+    m_heap_size += ENTRY_HEADER + name.size() + password.size();
+    return true;
+}
+
+
+bool
+UserSnapshotWriter::commit(){
+    if(!m_file){
+        return false;
+    }
+    size_t slot_count = MIN_SLOTS;
+    while(slot_count < m_entries.size() * 2){
+        slot_count *= 2;
+    }
+    //同名用户(表上没有唯一索引时)都放进去, 查找时先插入的在前
+    std::vector<uint64_t> slots(slot_count, 0);
+    for(const auto& entry : m_entries){
+        size_t i = entry.first & (slot_count - 1);
+        while(slots[i]){
+            i = (i + 1) & (slot_count - 1);
+        }
+        slots[i] = (entry.first >> TAG_SHIFT) << TAG_SHIFT | entry.second;
+    }
+
+    UserSnapshot::Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = UserSnapshot::VERSION;
+    header.header_size = sizeof(header);
+    header.count = m_entries.size();
+    header.high_water = m_high_water;
+    header.high_water_entry = m_high_water_entry;
+    header.heap_offset = sizeof(header);
+    header.heap_size = m_heap_size;
+    header.slots_offset = (header.heap_offset + m_heap_size + 7) & ~7ULL;
+    header.slot_count = slot_count;
+
+    char padding[8] = {0};
+    size_t pad = header.slots_offset - header.heap_offset - m_heap_size;
+    bool ok = fwrite(padding, 1, pad, m_file) == pad
+              && fwrite(slots.data(), sizeof(uint64_t), slot_count, m_file) == slot_count
+              && fseek(m_file, 0, SEEK_SET) == 0
+              && fwrite(&header, sizeof(header), 1, m_file) == 1
+              && fflush(m_file) == 0
+              && fsync(fileno(m_file)) == 0;
+    ok = fclose(m_file) == 0 && ok;
+    m_file = nullptr;
+    if(!ok || rename(m_tmp_path.c_str(), m_path.c_str()) < 0){
+        LOG_ERROR("[UserSnapshot] commit %s error %d", m_path.c_str(), errno);
+        unlink(m_tmp_path.c_str());
+        return false;
+    }
+    m_entries.clear();
+    m_entries.shrink_to_fit();
+    return true;
+}
+
+
+void
+UserSnapshotWriter::abort(){
+    if(m_file){
+        fclose(m_file);
+        m_file = nullptr;
+        unlink(m_tmp_path.c_str());
+    }
+    m_entries.clear();
+    m_entries.shrink_to_fit();
+}
+
+} // namespace bryant
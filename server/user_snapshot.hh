@@ -0,0 +1,133 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bryant{
+
+// 用户表的磁盘快照: 启动时mmap进来直接查, 不用再从数据库读整张表。
+// 文件布局: Header | 字符串堆 | 槽位数组
+//   字符串堆: 逐个存放用户 [uint16 用户名长度][uint16 密码长度][用户名][密码]
+//   槽位数组: 线性探测的开放寻址表, 槽位数是2的幂, 负载因子不超过1/2;
+//            每个槽位是定长的uint64: 高24位是用户名哈希(UserStore::Hash)的高位, 低40位是用户在堆中的偏移,
+//            0表示空槽位(堆的偏移从HEAP_START开始, 不会是0)
+// high_water是快照里最大的user.id, 启动时到数据库核对这一行还在, 再补读id更大的行。
+// 快照只读, 写快照由UserSnapshotWriter先写临时文件再rename, 已经映射的旧快照不受影响。
+class UserSnapshot {
+public:
+    static const uint32_t VERSION = 1;
+    static const size_t HEAP_START = 8;     // 堆里第一个用户的偏移
+
+    struct Header {
+        char magic[8];              // "BRYUSNAP"
+        uint32_t version;
+        uint32_t header_size;
+        uint64_t count;             // 用户数
+        uint64_t high_water;        // 最大的user.id
+        uint64_t high_water_entry;  // high_water那一行在堆中的偏移, 没有用户时为0
+        uint64_t heap_offset;       // 堆在文件中的偏移
+        uint64_t heap_size;
+        uint64_t slots_offset;      // 槽位数组在文件中的偏移(8字节对齐)
+        uint64_t slot_count;
+    };
+
+    UserSnapshot() = default;
+    ~UserSnapshot();
+
+    UserSnapshot(const UserSnapshot&) = delete;
+    UserSnapshot& operator=(const UserSnapshot&) = delete;
+
+    /**
+     * @brief 映射快照文件, 检查魔数、版本和各段的范围
+     *
+     * @return false 文件不存在或者不是可用的快照
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief 查找用户
+     *
+     * @param password 不为nullptr时指向映射里的密码
+     * @return false 用户不在快照里
+     */
+    bool find(std::string_view name, std::string_view* password = nullptr) const;
+
+    /**
+     * @brief 按堆中的顺序遍历所有用户
+     */
+    void foreach(const std::function<void(std::string_view name, std::string_view password)>& cb) const;
+
+    size_t size() const {return m_header ? m_header->count : 0;}
+
+    uint64_t high_water() const {return m_header ? m_header->high_water : 0;}
+
+    /**
+     * @brief high_water那一行的用户名, 用来核对数据库里的这一行没有变
+     */
+    std::string_view high_water_name() const;
+
+private:
+    /**
+     * @brief 取堆中offset处的用户, 越界时返回false
+     */
+    bool entry(uint64_t offset, std::string_view* name, std::string_view* password) const;
+
+private:
+    void* m_data = nullptr;
+    size_t m_size = 0;
+    const Header* m_header = nullptr;
+    const char* m_heap = nullptr;
+    const uint64_t* m_slots = nullptr;
+};
+
+
+// 写快照: 用户边读边写进临时文件的堆里, 内存里只留每个用户的哈希和偏移(16字节),
+// commit时建槽位数组、写文件头、fsync, 再rename成正式文件
+class UserSnapshotWriter {
+public:
+    UserSnapshotWriter() = default;
+    ~UserSnapshotWriter();
+
+    UserSnapshotWriter(const UserSnapshotWriter&) = delete;
+    UserSnapshotWriter& operator=(const UserSnapshotWriter&) = delete;
+
+    /**
+     * @brief 创建临时文件path.tmp, 权限0600
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief 追加一个用户
+     *
+     * @param id user.id, 不是来自数据库的行(比如旧快照里的)传0
+     */
+    bool append(std::string_view name, std::string_view password, uint64_t id = 0);
+
+    /**
+     * @brief 写完并替换正式文件
+     */
+    bool commit();
+
+    /**
+     * @brief 放弃, 删除临时文件
+     */
+    void abort();
+
+    size_t size() const {return m_entries.size();}
+
+private:
+    std::string m_path;
+    std::string m_tmp_path;
+    FILE* m_file = nullptr;
+    uint64_t m_heap_size = 0;
+    uint64_t m_high_water = 0;
+    uint64_t m_high_water_entry = 0;
+    std::vector<std::pair<uint64_t, uint64_t>> m_entries;  // (哈希, 堆中的偏移)
+};
+
+} // namespace bryant
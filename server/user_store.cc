@@ -0,0 +1,429 @@
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "user_store.hh"
+#include "user_snapshot.hh"
+
+namespace bryant{
+
+// 墓碑只用作标记, 不会被解引用
+static char s_tombstone;
+UserStore::Entry* const UserStore::TOMBSTONE = reinterpret_cast<UserStore::Entry*>(&s_tombstone);
+
+
+// 读者登记记录, 每个线程占一条, 线程退出后留给之后的线程复用(只增不删)
+struct ReaderRecord {
+    std::atomic<uint64_t> epoch{0};     // 0表示不在读, 否则是进入时的全局纪元
+    std::atomic<bool> in_use{false};
+    ReaderRecord* next = nullptr;
+};
+
+static std::atomic<uint64_t> s_epoch{1};                // 全局纪元, 所有UserStore共用
+static std::atomic<ReaderRecord*> s_readers{nullptr};   // 读者记录链表
+
+
+// 线程第一次读时认领一条空闲记录(没有就新建一条挂到链表头), 线程退出时归还
+class ReaderHandle {
+public:
+    ReaderHandle(){
+        for(ReaderRecord* r = s_readers.load(std::memory_order_acquire); r; r = r->next){
+            bool expected = false;
+            if(r->in_use.compare_exchange_strong(expected, true)){
+                m_record = r;
+                return;
+            }
+        }
+        m_record = new ReaderRecord;
+        m_record->in_use.store(true, std::memory_order_relaxed);
+        ReaderRecord* head = s_readers.load(std::memory_order_relaxed);
+        do{
+            m_record->next = head;
+        }while(!s_readers.compare_exchange_weak(head, m_record, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    ~ReaderHandle(){
+        m_record->epoch.store(0, std::memory_order_release);
+        m_record->in_use.store(false, std::memory_order_release);
+    }
+
+    ReaderRecord* record() const {return m_record;}
+
+private:
+    ReaderRecord* m_record;
+};
+
+
+// find/check的读临界区: 先登记纪元再读表, 登记和之后的读之间要有全序屏障,
+// 与reclaim里扫描读者之前的屏障配对: 要么回收者看到这次登记, 要么这里看到已经摘掉的指针
+class ReadGuard {
+public:
+    ReadGuard(){
+        static thread_local ReaderHandle t_handle;
+        m_record = t_handle.record();
+        m_record->epoch.store(s_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    ~ReadGuard(){
+        m_record->epoch.store(0, std::memory_order_release);
+    }
+
+private:
+    ReaderRecord* m_record;
+};
+
+
+// 所有正在读的线程都登记的是当前纪元时才推进一次, 返回推进后的纪元
+static uint64_t
+advance_epoch(){
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t epoch = s_epoch.load(std::memory_order_seq_cst);
+    for(ReaderRecord* r = s_readers.load(std::memory_order_acquire); r; r = r->next){
+        uint64_t e = r->epoch.load(std::memory_order_seq_cst);
+        if(e && e != epoch){
+            return epoch;
+        }
+    }
+    if(s_epoch.compare_exchange_strong(epoch, epoch + 1)){
+        return epoch + 1;
+    }
+    return epoch;   // 已被别的写者推进, epoch里是新值
+}
+
+
+UserStore*
+UserStore::get_instance(){
+    static UserStore store;
+    return &store;
+}
+
+
+//FNV-1a, 再用murmur3的fmix64打散: 分片取高位、槽位取低位, 两端都需要分布均匀
+uint64_t
+UserStore::Hash(std::string_view name){
+    uint64_t h = 14695981039346656037ULL;
+    for(unsigned char c : name){
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+
+UserStore::~UserStore(){
+    for(Shard& shard : m_shards){
+        Table* table = shard.table.load(std::memory_order_relaxed);
+        if(table){
+            for(size_t i = 0; i <= table->mask; ++i){
+                Entry* entry = table->slots[i].load(std::memory_order_relaxed);
+                if(entry && entry != TOMBSTONE){
+                    free(entry);
+                }
+            }
+            free(table);
+        }
+        for(const Retired& retired : shard.retired){
+            free(retired.ptr);
+        }
+    }
+}
+
+
+UserStore::Entry*
+UserStore::newEntry(uint64_t hash, std::string_view name, std::string_view password){
+    Entry* entry = (Entry*)malloc(sizeof(Entry) + name.size() + password.size());
+    if(!entry){
+        throw std::bad_alloc();
+    }
+    entry->hash = hash;
+    entry->name_len = name.size();
+    entry->password_len = password.size();
+    memcpy(entry->data, name.data(), name.size());
+    memcpy(entry->data + name.size(), password.data(), password.size());
+    return entry;
+}
+
+
+UserStore::Table*
+UserStore::newTable(size_t capacity){
+    Table* table = (Table*)malloc(sizeof(Table) + capacity * sizeof(std::atomic<Entry*>));
+    if(!table){
+        throw std::bad_alloc();
+    }
+    table->mask = capacity - 1;
+    for(size_t i = 0; i < capacity; ++i){
+        new (&table->slots[i]) std::atomic<Entry*>(nullptr);
+    }
+    return table;
+}
+
+
+//读者只看到完整发布的条目: 槽位里的指针以release写入, 这里以acquire读出
+const UserStore::Entry*
+UserStore::lookup(std::string_view name) const{
+    uint64_t hash = Hash(name);
+    const Table* table = shardOf(hash).table.load(std::memory_order_acquire);
+    if(!table){
+        return nullptr;
+    }
+    for(size_t i = hash & table->mask; ; i = (i + 1) & table->mask){
+        const Entry* entry = table->slots[i].load(std::memory_order_acquire);
+        if(!entry){
+            return nullptr;
+        }
+        if(entry != TOMBSTONE && entry->hash == hash && entry->name() == name){
+            return entry;
+        }
+    }
+}
+
+
+long
+UserStore::locate(const Table* table, uint64_t hash, std::string_view name) const{
+    if(!table){
+        return -1;
+    }
+    for(size_t i = hash & table->mask; ; i = (i + 1) & table->mask){
+        const Entry* entry = table->slots[i].load(std::memory_order_relaxed);
+        if(!entry){
+            return -1;
+        }
+        if(entry != TOMBSTONE && entry->hash == hash && entry->name() == name){
+            return i;
+        }
+    }
+}
+
+
+bool
+UserStore::find(std::string_view name, std::string* password) const{
+    ReadGuard guard;
+    const Entry* entry = lookup(name);
+    if(entry){
+        if(password){
+            password->assign(entry->password());
+        }
+        return true;
+    }
+    const UserSnapshot* snapshot = m_snapshot.load(std::memory_order_acquire);
+    std::string_view stored;
+    if(snapshot && snapshot->find(name, &stored)){
+        if(password){
+            password->assign(stored);
+        }
+        return true;
+    }
+    return false;
+}
+
+
+bool
+UserStore::check(std::string_view name, std::string_view password) const{
+    ReadGuard guard;
+    const Entry* entry = lookup(name);
+    if(entry){
+        return entry->password() == password;
+    }
+    const UserSnapshot* snapshot = m_snapshot.load(std::memory_order_acquire);
+    std::string_view stored;
+    return snapshot && snapshot->find(name, &stored) && stored == password;
+}
+
+
+//负载因子(含墓碑)不超过1/2, 保证探测链短且一定有空槽位结束查找;
+//超过时条目数超过1/4才扩容, 否则只是清掉墓碑
+void
+UserStore::add(Shard& shard, Entry* entry){
+    Table* table = shard.table.load(std::memory_order_relaxed);
+    if(!table || (shard.used + 1) * 2 > table->mask + 1){
+        size_t capacity = table ? table->mask + 1 : INITIAL_CAPACITY;
+        while((shard.live + 1) * 4 > capacity){
+            capacity *= 2;
+        }
+        rehash(shard, capacity);
+        table = shard.table.load(std::memory_order_relaxed);
+    }
+
+    size_t i = entry->hash & table->mask;
+    while(true){
+        Entry* slot = table->slots[i].load(std::memory_order_relaxed);
+        if(!slot || slot == TOMBSTONE){
+            if(!slot){
+                ++shard.used;
+            }
+            break;
+        }
+        i = (i + 1) & table->mask;
+    }
+    table->slots[i].store(entry, std::memory_order_release);
+    ++shard.live;
+}
+
+
+//新表里只放条目(墓碑被清掉), 建好之后一次发布; 旧表等可能还在读它的读者退出后再释放
+void
+UserStore::rehash(Shard& shard, size_t capacity){
+    Table* old = shard.table.load(std::memory_order_relaxed);
+    Table* table = newTable(capacity);
+    if(old){
+        for(size_t i = 0; i <= old->mask; ++i){
+            Entry* entry = old->slots[i].load(std::memory_order_relaxed);
+            if(!entry || entry == TOMBSTONE){
+                continue;
+            }
+            size_t j = entry->hash & table->mask;
+            while(table->slots[j].load(std::memory_order_relaxed)){
+                j = (j + 1) & table->mask;
+            }
+            table->slots[j].store(entry, std::memory_order_relaxed);
+        }
+    }
+    shard.used = shard.live;
+    shard.table.store(table, std::memory_order_release);
+    if(old){
+        retire(shard, old);
+    }
+}
+
+
+//退役时记下的纪元必须在摘下指针之后读: 之后才登记的读者不可能再拿到它
+void
+UserStore::retire(Shard& shard, void* ptr){
+    shard.retired.push_back({s_epoch.load(std::memory_order_seq_cst), ptr});
+}
+
+
+//纪元e退役的内存: 纪元推进到e+1时登记e之前的读者都已退出, 推进到e+2时登记e的也都已退出
+void
+UserStore::reclaim(Shard& shard){
+    if(shard.retired.empty()){
+        return;
+    }
+    uint64_t epoch = advance_epoch();
+    size_t n = 0;
+    while(n < shard.retired.size() && shard.retired[n].epoch + 2 <= epoch){
+        free(shard.retired[n].ptr);
+        ++n;
+    }
+    shard.retired.erase(shard.retired.begin(), shard.retired.begin() + n);
+}
+
+
+bool
+UserStore::insert(std::string_view name, std::string_view password){
+    // 快照只读, 先查不用加锁
+    const UserSnapshot* snapshot = m_snapshot.load(std::memory_order_acquire);
+    if(snapshot && snapshot->find(name)){
+        return false;
+    }
+    uint64_t hash = Hash(name);
+    Shard& shard = shardOf(hash);
+    shard.mutex.lock();
+    if(locate(shard.table.load(std::memory_order_relaxed), hash, name) >= 0){
+        shard.mutex.unlock();
+        return false;
+    }
+    add(shard, newEntry(hash, name, password));
+    reclaim(shard);
+    shard.mutex.unlock();
+    return true;
+}
+
+
+void
+UserStore::set(std::string_view name, std::string_view password){
+    uint64_t hash = Hash(name);
+    Shard& shard = shardOf(hash);
+    Entry* entry = newEntry(hash, name, password);
+    shard.mutex.lock();
+    Table* table = shard.table.load(std::memory_order_relaxed);
+    long i = locate(table, hash, name);
+    if(i >= 0){ // 原位替换, 旧条目可能还在被读
+        Entry* old = table->slots[i].load(std::memory_order_relaxed);
+        table->slots[i].store(entry, std::memory_order_release);
+        retire(shard, old);
+    }
+    else{
+        add(shard, entry);
+    }
+    reclaim(shard);
+    shard.mutex.unlock();
+}
+
+
+bool
+UserStore::erase(std::string_view name){
+    uint64_t hash = Hash(name);
+    Shard& shard = shardOf(hash);
+    shard.mutex.lock();
+    Table* table = shard.table.load(std::memory_order_relaxed);
+    long i = locate(table, hash, name);
+    if(i < 0){
+        shard.mutex.unlock();
+        return false;
+    }
+    // 留下墓碑而不是空槽位, 否则会截断经过这里的探测链
+    Entry* old = table->slots[i].load(std::memory_order_relaxed);
+    table->slots[i].store(TOMBSTONE, std::memory_order_release);
+    retire(shard, old);
+    --shard.live;
+    reclaim(shard);
+    shard.mutex.unlock();
+    return true;
+}
+
+
+size_t
+UserStore::size() const{
+    size_t n = 0;
+    for(const Shard& shard : m_shards){
+        shard.mutex.lock();
+        n += shard.live;
+        shard.mutex.unlock();
+    }
+    const UserSnapshot* snapshot = m_snapshot.load(std::memory_order_acquire);
+    return snapshot ? n + snapshot->size() : n;
+}
+
+
+size_t
+UserStore::retired() const{
+    size_t n = 0;
+    for(const Shard& shard : m_shards){
+        shard.mutex.lock();
+        n += shard.retired.size();
+        shard.mutex.unlock();
+    }
+    return n;
+}
+
+
+void
+UserStore::clear(){
+    for(Shard& shard : m_shards){
+        shard.mutex.lock();
+        Table* table = shard.table.load(std::memory_order_relaxed);
+        if(table){
+            shard.table.store(nullptr, std::memory_order_release);
+            for(size_t i = 0; i <= table->mask; ++i){
+                Entry* entry = table->slots[i].load(std::memory_order_relaxed);
+                if(entry && entry != TOMBSTONE){
+                    retire(shard, entry);
+                }
+            }
+            retire(shard, table);
+        }
+        shard.used = shard.live = 0;
+        reclaim(shard);
+        shard.mutex.unlock();
+    }
+    m_snapshot.store(nullptr, std::memory_order_release);
+}
+
+} // namespace bryant
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../util/locker.hh"
+
+namespace bryant{
+
+class UserSnapshot;
+
+// 用户名 -> 密码的内存表, 登录/注册时查询, 所有IOManager工作线程共享
+// 按用户名哈希的高位分成SHARDS个分片, 每个分片是一张线性探测的开放寻址表:
+// 读不加锁, 只用acquire读出表指针和槽位里的条目指针；写在分片锁内进行,
+// 条目写好后才以release发布到槽位, 扩容时建好新表再整体发布。
+// 被替换/删除的条目和旧表不能立即释放(读者可能还在访问), 用纪元(epoch)回收:
+// find/check期间当前线程登记进入时的全局纪元, 退出时清零(期间不会让出协程);
+// 退役的内存记下退役时的纪元挂在分片上, 写者每次修改后尝试推进全局纪元
+// (所有正在读的线程都已看到当前纪元时才能推进), 纪元推进两次之后就没有读者还能拿到它, 随即释放。
+// 每个分片待释放的只是最近两个纪元内退役的(除非有读者一直停在find/check里), 不随修改次数增长。
+// 可以挂一个只读的磁盘快照(UserSnapshot)作为底层: 内存表里查不到时再查快照,
+// 快照里已有的用户不能再插入; 覆盖和删除只作用于内存表。
+class UserStore {
+public:
+    static const int SHARD_BITS = 6;
+    static const size_t SHARDS = 1 << SHARD_BITS; // 分片数, 取哈希的高SHARD_BITS位
+    static const size_t INITIAL_CAPACITY = 64;  // 每个分片表的初始槽位数, 2的幂
+
+    /**
+     * @brief Get the instance
+     *
+     * @return UserStore*
+     */
+    static UserStore* get_instance();
+
+    /**
+     * @brief 用户名的哈希, 与运行环境无关(可用于持久化)
+     */
+    static uint64_t Hash(std::string_view name);
+
+    UserStore() = default;
+    ~UserStore();
+
+    UserStore(const UserStore&) = delete;
+    UserStore& operator=(const UserStore&) = delete;
+
+    /**
+     * @brief 查找用户, 不加锁
+     *
+     * @param name
+     * @param password 不为nullptr时取出密码
+     * @return false 用户不存在
+     */
+    bool find(std::string_view name, std::string* password = nullptr) const;
+
+    /**
+     * @brief 用户存在且密码一致, 不加锁、不拷贝
+     */
+    bool check(std::string_view name, std::string_view password) const;
+
+    /**
+     * @brief 插入新用户(注册), 同名用户已存在时不修改
+     *
+     * @return false 用户已存在
+     */
+    bool insert(std::string_view name, std::string_view password);
+
+    /**
+     * @brief 插入或覆盖(从数据库加载)
+     */
+    void set(std::string_view name, std::string_view password);
+
+    /**
+     * @brief 删除用户(注册写入数据库失败时回滚)
+     *
+     * @return false 用户不存在
+     */
+    bool erase(std::string_view name);
+
+    /**
+     * @brief 用户数(含快照里的)
+     */
+    size_t size() const;
+
+    /**
+     * @brief 删除所有用户, 同时卸下快照
+     */
+    void clear();
+
+    /**
+     * @brief 已退役还没释放的条目和旧表数
+     */
+    size_t retired() const;
+
+    /**
+     * @brief 挂上只读快照, 快照由调用方持有, 在UserStore之后释放
+     */
+    void attach(const UserSnapshot* snapshot) {m_snapshot.store(snapshot, std::memory_order_release);}
+
+private:
+    // 不可变的条目: 用户名和密码连续存放在data里
+    struct Entry {
+        uint64_t hash;
+        uint32_t name_len;
+        uint32_t password_len;
+        char data[];
+
+        std::string_view name() const {return std::string_view(data, name_len);}
+        std::string_view password() const {return std::string_view(data + name_len, password_len);}
+    };
+
+    // 一张开放寻址表, 槽位为空(nullptr)、墓碑(TOMBSTONE)或条目
+    struct Table {
+        size_t mask;                    // 槽位数-1
+        std::atomic<Entry*> slots[];
+    };
+
+    // 退役的条目或旧表(都是malloc出来的), 纪元推进到epoch+2之后释放
+    struct Retired {
+        uint64_t epoch;
+        void* ptr;
+    };
+
+    struct alignas(64) Shard {
+        mutable Mutex mutex;            // 写锁
+        std::atomic<Table*> table{nullptr};
+        size_t used = 0;                // 条目数+墓碑数
+        size_t live = 0;                // 条目数
+        std::vector<Retired> retired;   // 被替换/删除的条目和扩容前的表, 按纪元递增
+    };
+
+    static Entry* const TOMBSTONE;
+
+    static Entry* newEntry(uint64_t hash, std::string_view name, std::string_view password);
+    static Table* newTable(size_t capacity);
+
+    Shard& shardOf(uint64_t hash) {return m_shards[hash >> (64 - SHARD_BITS)];}
+    const Shard& shardOf(uint64_t hash) const {return m_shards[hash >> (64 - SHARD_BITS)];}
+
+    /**
+     * @brief 不加锁查找, 返回条目或nullptr
+     */
+    const Entry* lookup(std::string_view name) const;
+
+    /**
+     * @brief 分片锁内查找, 返回槽位下标, 不存在时返回-1
+     */
+    long locate(const Table* table, uint64_t hash, std::string_view name) const;
+
+    /**
+     * @brief 分片锁内插入新条目(调用方已确认不存在), 必要时扩容
+     */
+    void add(Shard& shard, Entry* entry);
+
+    /**
+     * @brief 分片锁内扩容/清理墓碑
+     */
+    void rehash(Shard& shard, size_t capacity);
+
+    /**
+     * @brief 分片锁内退役已经从表上摘下来的条目或旧表
+     */
+    static void retire(Shard& shard, void* ptr);
+
+    /**
+     * @brief 分片锁内尝试推进纪元, 释放已经没有读者的退役内存
+     */
+    static void reclaim(Shard& shard);
+
+private:
+    Shard m_shards[SHARDS];
+    std::atomic<const UserSnapshot*> m_snapshot{nullptr};
+};
+
+} // namespace bryant
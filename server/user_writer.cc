@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <mysql/errmsg.h>
+
+#include "user_writer.hh"
+#include "user_store.hh"
+#include "../CGImysql/sql_connection_pool.hh"
+#include "../fiberLibrary/hook.hh"
+#include "../log/logger.hh"
+
+namespace bryant{
+
+static const char SQL_INSERT_USER[] = "INSERT INTO user(username, passwd) VALUES(?, ?)";
+
+
+// rows行的多行INSERT, 和SQL_INSERT_USER一样走预处理语句;
+// 每种行数在每个连接上prepare一次, 最多BATCH_ROWS种
+static std::string
+insert_users_sql(size_t rows){
+    std::string sql = SQL_INSERT_USER;
+    sql.reserve(sql.size() + (rows - 1) * 7);
+    for(size_t i = 1; i < rows; ++i){
+        sql += ",(?, ?)";
+    }
+    return sql;
+}
+
+
+UserWriter*
+UserWriter::get_instance(){
+    static UserWriter writer;
+    return &writer;
+}
+
+
+void
+UserWriter::start(IOManager* iom, bool durable, size_t batch_rows, uint64_t flush_ms, size_t capacity){
+    m_mutex.lock();
+    m_iom = iom;
+    m_durable = durable;
+    m_batch_rows = std::min(std::max<size_t>(batch_rows, 1), Connection_pool::MAX_PARAMS / 2);
+    m_flush_ms = flush_ms;
+    m_capacity = std::max(capacity, m_batch_rows);
+    m_mutex.unlock();
+}
+
+
+bool
+UserWriter::write(std::string_view name, std::string_view password, bool durable){
+    m_mutex.lock();
+    if(!m_iom || m_queue.size() >= m_capacity){
+        m_mutex.unlock();
+        return writeNow(name, password);
+    }
+
+    std::shared_ptr<Ticket> ticket;
+    if(durable){
+        ticket = std::make_shared<Ticket>();
+        IOManager* iom = is_hook_enable() ? IOManager::GetThis() : nullptr;
+        if(iom){
+            ticket->fiber = Fiber::GetThis();
+            ticket->scheduler = iom;
+        }
+    }
+    m_queue.push_back(Row{std::string(name), std::string(password), ticket});
+    scheduleFlush();
+    m_mutex.unlock();
+
+    if(!ticket){
+        return true;
+    }
+    // 挂起到所在的批提交, 由写入协程唤醒
+    if(ticket->fiber){
+        Fiber::GetThis()->yield();
+    }
+    else{
+        ticket->sem.wait();
+    }
+    return ticket->ok;
+}
+
+
+bool
+UserWriter::writeNow(std::string_view name, std::string_view password){
+    Connection_pool* conn_pool = Connection_pool::get_instance();
+    MYSQL* mysql = nullptr;
+    connectionRAII mysqlcon(&mysql, conn_pool);
+    unsigned int err = mysql ? conn_pool->execute(mysql, SQL_INSERT_USER, {name, password}) : CR_UNKNOWN_ERROR;
+    if(err){
+        LOG_ERROR("[UserWriter] insert error: %u", err);
+        UserStore::get_instance()->erase(name);
+        return false;
+    }
+    return true;
+}
+
+
+void
+UserWriter::scheduleFlush(){
+    if(m_flushing){ // 写入协程写完当前这批会接着写
+        return;
+    }
+    if(m_queue.size() >= m_batch_rows){
+        m_flushing = true;
+        m_iom->schedule([this](){flush();});
+        return;
+    }
+    if(m_timer){
+        return;
+    }
+    m_timer = true;
+    m_iom->addTimer(m_flush_ms, [this](){
+        m_mutex.lock();
+        m_timer = false;
+        if(m_flushing || m_queue.empty()){
+            m_mutex.unlock();
+            return;
+        }
+        m_flushing = true;
+        m_mutex.unlock();
+        flush();
+    });
+}
+
+
+void
+UserWriter::flush(){
+    std::vector<Row> rows;
+    while(true){
+        m_mutex.lock();
+        if(m_queue.empty()){
+            m_flushing = false;
+            m_mutex.unlock();
+            return;
+        }
+        size_t n = std::min(m_queue.size(), m_batch_rows);
+        rows.clear();
+        for(size_t i = 0; i < n; ++i){
+            rows.push_back(std::move(m_queue.front()));
+            m_queue.pop_front();
+        }
+        m_mutex.unlock();
+
+        writeBatch(rows);
+
+        m_mutex.lock();
+        ++m_batches;
+        m_mutex.unlock();
+        for(Row& row : rows){
+            if(row.ticket){
+                wake(*row.ticket);
+            }
+        }
+    }
+}
+
+
+void
+UserWriter::writeBatch(std::vector<Row>& rows){
+    // 后台写入不设超时: 放弃这一批就会丢掉已经能登录的用户
+    Connection_pool* conn_pool = Connection_pool::get_instance();
+    MYSQL* mysql = conn_pool->get_connection(-1);
+    if(!mysql){
+        LOG_ERROR("[UserWriter] no mysql connection, %zu users dropped", rows.size());
+        for(Row& row : rows){
+            UserStore::get_instance()->erase(row.name);
+        }
+        return;
+    }
+
+    // 一条语句在自动提交下就是一个事务, 一次往返; 用户名和密码只作为参数传, 不拼进SQL
+    std::vector<std::string_view> params;
+    params.reserve(rows.size() * 2);
+    for(const Row& row : rows){
+        params.push_back(row.name);
+        params.push_back(row.password);
+    }
+    unsigned int err = conn_pool->execute(mysql, insert_users_sql(rows.size()), params);
+    bool ok = err == 0;
+    if(!ok){
+        // 整批回滚了, 逐行重试, 只丢掉写不进去的行
+        LOG_ERROR("[UserWriter] batch insert error: %u, retry %zu rows one by one", err, rows.size());
+    }
+    for(Row& row : rows){
+        bool row_ok = ok || conn_pool->execute(mysql, SQL_INSERT_USER, {row.name, row.password}) == 0;
+        if(!row_ok){
+            LOG_ERROR("[UserWriter] insert error: %s", row.name.c_str());
+            UserStore::get_instance()->erase(row.name);
+        }
+        if(row.ticket){
+            row.ticket->ok = row_ok;
+        }
+    }
+    conn_pool->release_connection(mysql);
+}
+
+
+void
+UserWriter::wake(Ticket& ticket){
+    if(ticket.fiber){
+        ticket.scheduler->schedule(ticket.fiber);
+    }
+    else{
+        ticket.sem.post();
+    }
+}
+
+
+size_t
+UserWriter::pending(){
+    m_mutex.lock();
+    size_t n = m_queue.size();
+    m_mutex.unlock();
+    return n;
+}
+
+
+uint64_t
+UserWriter::batches(){
+    m_mutex.lock();
+    uint64_t n = m_batches;
+    m_mutex.unlock();
+    return n;
+}
+
+} // namespace bryant
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../util/locker.hh"
+#include "../fiberLibrary/fiber.hh"
+#include "../fiberLibrary/iomanager.hh"
+
+namespace bryant{
+
+// 注册用户的写回队列(group commit)
+// 注册时用户先进UserStore, 立即可以登录; 写库的请求进入有界队列,
+// 由后台协程攒成一条多行INSERT一次写入: 第一行入队后最多等flush_ms,
+// 或者攒够batch_rows行立即写。写入期间到达的行在这一批写完后紧接着写下一批,
+// 突发注册时每一批只有一次数据库往返。
+// 需要落库确认的调用方挂起等待所在的批提交; 写入失败的用户从UserStore里删除。
+// 没有启动或队列满时退化为逐条同步写入。
+class UserWriter {
+public:
+    static const size_t BATCH_ROWS = 256;       // 一批最多的行数
+    static const uint64_t FLUSH_INTERVAL = 5;   // 第一行入队后最多等待的时间(ms)
+    static const size_t CAPACITY = 8192;        // 队列容量
+
+    /**
+     * @brief Get the instance
+     *
+     * @return UserWriter*
+     */
+    static UserWriter* get_instance();
+
+    /**
+     * @brief 启动写回队列, 写库在iom的协程里进行
+     *
+     * @param iom
+     * @param durable write()默认是否等待落库
+     * @param batch_rows 一批最多的行数, 不超过Connection_pool::MAX_PARAMS / 2
+     * @param flush_ms 第一行入队后最多等待的时间
+     * @param capacity 队列容量, 满了以后同步写入
+     */
+    void start(IOManager* iom, bool durable, size_t batch_rows = BATCH_ROWS,
+               uint64_t flush_ms = FLUSH_INTERVAL, size_t capacity = CAPACITY);
+
+    /**
+     * @brief 写入新用户(调用方已经在UserStore里插入), 是否等待落库由start决定
+     */
+    bool write(std::string_view name, std::string_view password) {return write(name, password, m_durable);}
+
+    /**
+     * @brief 写入新用户(调用方已经在UserStore里插入)
+     *
+     * @param durable true时挂起等待所在的批提交
+     * @return false 写入失败(用户已从UserStore删除); durable为false时入队即返回true
+     */
+    bool write(std::string_view name, std::string_view password, bool durable);
+
+    /**
+     * @brief 队列中还没写入的行数
+     */
+    size_t pending();
+
+    /**
+     * @brief 已经写入的批数
+     */
+    uint64_t batches();
+
+private:
+    // 等待落库的调用方
+    struct Ticket {
+        Fiber::ptr fiber;               // 挂起的协程, 为空时是阻塞的线程
+        Scheduler* scheduler = nullptr;
+        Semaphore sem;
+        bool ok = false;
+    };
+
+    struct Row {
+        std::string name;
+        std::string password;
+        std::shared_ptr<Ticket> ticket; // 不等待时为空
+    };
+
+    /**
+     * @brief 逐条同步写入, 失败时从UserStore删除
+     */
+    bool writeNow(std::string_view name, std::string_view password);
+
+    /**
+     * @brief 加锁后调用, 安排一次写入(已经有写入协程在跑时不重复安排)
+     */
+    void scheduleFlush();
+
+    /**
+     * @brief 写入协程: 一批一批写, 直到队列为空
+     */
+    void flush();
+
+    /**
+     * @brief 一条多行INSERT写入一批, 失败时逐行重试以找出写不进去的行
+     */
+    void writeBatch(std::vector<Row>& rows);
+
+    static void wake(Ticket& ticket);
+
+private:
+    Mutex m_mutex;
+    IOManager* m_iom = nullptr;     // 为空时没有启动
+    bool m_durable = true;
+    size_t m_batch_rows = BATCH_ROWS;
+    uint64_t m_flush_ms = FLUSH_INTERVAL;
+    size_t m_capacity = CAPACITY;
+
+    std::deque<Row> m_queue;
+    bool m_flushing = false;        // 写入协程正在运行
+    bool m_timer = false;           // 已经安排了定时写入
+    uint64_t m_batches = 0;
+};
+
+} // namespace bryant
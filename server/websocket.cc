@@ -0,0 +1,319 @@
+#include <string.h>
+#include <sys/uio.h>
+#include <algorithm>
+
+#include "websocket.hh"
+#include "../util/util.hh"
+#include "../util/ws_codec.hh"
+
+namespace bryant{
+
+const char WebSocket::GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+static const size_t READ_SIZE = 16 * 1024;  // 每次读取的大小
+
+
+void
+WebSocket::AcceptKey(std::string_view key, std::string& accept){
+    std::string text(key);
+    text += GUID;
+    uint8_t digest[20];
+    Sha1(text.data(), text.size(), digest);
+    accept.clear();
+    Base64Encode(digest, sizeof(digest), accept);
+}
+
+
+WebSocket::WebSocket(sylar::Socket::ptr client, std::string_view initial, size_t max_message)
+    :m_client(client),
+     m_in(initial),
+     m_max_message(max_message){
+}
+
+
+bool
+WebSocket::fill(size_t n){
+    while(m_in.size() - m_in_pos < n){
+        if(m_in_pos > 0){
+            m_in.erase(0, m_in_pos);
+            m_in_pos = 0;
+        }
+        size_t old = m_in.size();
+        size_t want = std::max(READ_SIZE, n - old);
+        m_in.resize(old + want);
+        int len = m_client->recv(&m_in[old], want, 0);
+        if(len <= 0){
+            m_in.resize(old);
+            return false;
+        }
+        m_in.resize(old + len);
+    }
+    return true;
+}
+
+
+//一次处理一个帧：控制帧就地处理，数据帧合并到m_fragmented，收齐最后一片才返回
+bool
+WebSocket::recv(Message& msg){
+    while(!m_closed){
+        if(!fill(2)){
+            m_closed = true;
+            return false;
+        }
+        const uint8_t* p = (const uint8_t*)m_in.data() + m_in_pos;
+        bool fin = p[0] & 0x80;
+        uint8_t opcode = p[0] & 0x0f;
+        uint64_t len = p[1] & 0x7f;
+        if((p[0] & 0x70) || !(p[1] & 0x80)){ // 没有协商扩展，RSV必须为0；客户端的帧必须加掩码
+            return fail(CLOSE_PROTOCOL_ERROR);
+        }
+
+        size_t head = 2 + (len == 126 ? 2 : len == 127 ? 8 : 0) + 4;
+        if(!fill(head)){
+            m_closed = true;
+            return false;
+        }
+        p = (const uint8_t*)m_in.data() + m_in_pos;
+        if(len == 126){
+            len = ((uint64_t)p[2] << 8) | p[3];
+        }
+        else if(len == 127){
+            len = 0;
+            for(int i = 0; i < 8; ++i){
+                len = (len << 8) | p[2+i];
+            }
+            if(len >> 63){
+                return fail(CLOSE_PROTOCOL_ERROR);
+            }
+        }
+
+        bool control = opcode & 0x8;
+        if(control){
+            if(!fin || len > 125 || (opcode != CLOSE && opcode != PING && opcode != PONG)){
+                return fail(CLOSE_PROTOCOL_ERROR);
+            }
+        }
+        else{
+            if(opcode > BINARY || (opcode == CONTINUATION) != m_in_fragment){ // 分片必须连续
+                return fail(CLOSE_PROTOCOL_ERROR);
+            }
+            size_t before = (opcode == CONTINUATION) ? m_fragmented.data.size() : 0;
+            if(len > m_max_message - before){
+                return fail(CLOSE_TOO_BIG);
+            }
+        }
+
+        if(!fill(head + len)){
+            m_closed = true;
+            return false;
+        }
+        char* payload = &m_in[m_in_pos + head];
+        uint8_t key[4];
+        memcpy(key, payload - 4, 4);
+        WsMask(payload, len, key);
+        m_in_pos += head + len;
+
+        if(control){
+            std::string data(payload, len);
+            if(!handleControl((Opcode)opcode, data)){
+                return false;
+            }
+            continue;
+        }
+
+        if(opcode != CONTINUATION){
+            m_fragmented.opcode = (Opcode)opcode;
+            m_fragmented.data.clear();
+        }
+        m_fragmented.data.append(payload, len);
+        m_in_fragment = !fin;
+        if(fin){
+            if(m_fragmented.opcode == TEXT && !ValidateUtf8(m_fragmented.data.data(), m_fragmented.data.size())){
+                return fail(CLOSE_INVALID_DATA);
+            }
+            msg.opcode = m_fragmented.opcode;
+            msg.data.swap(m_fragmented.data);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool
+WebSocket::handleControl(Opcode opcode, std::string& payload){
+    switch(opcode){
+    case PING:
+        if(!m_close_sent){
+            writeFrame(PONG, payload.data(), payload.size(), true);
+        }
+        return true;
+    case PONG:
+        return true;
+    default:
+        break;
+    }
+
+    // 关闭帧：没有负载或者2字节关闭码加UTF-8的原因
+    uint16_t code = CLOSE_NO_STATUS;
+    if(payload.size() == 1){
+        return fail(CLOSE_PROTOCOL_ERROR);
+    }
+    if(payload.size() >= 2){
+        code = ((uint8_t)payload[0] << 8) | (uint8_t)payload[1];
+        bool valid = (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1011)
+                    || (code >= 3000 && code <= 4999);
+        if(!valid){
+            return fail(CLOSE_PROTOCOL_ERROR);
+        }
+        if(!ValidateUtf8(payload.data() + 2, payload.size() - 2)){
+            return fail(CLOSE_INVALID_DATA);
+        }
+    }
+
+    m_close_code = code;
+    if(!m_close_sent){ // 回复关闭帧
+        sendClose(code, std::string_view());
+    }
+    m_closed = true;
+    return false;
+}
+
+
+bool
+WebSocket::fail(uint16_t code){
+    m_close_code = code;
+    if(!m_close_sent){
+        sendClose(code, std::string_view());
+    }
+    m_closed = true;
+    return false;
+}
+
+
+bool
+WebSocket::send(std::string_view data, Opcode opcode){
+    return sendFrame(opcode, data.data(), data.size(), true);
+}
+
+
+bool
+WebSocket::sendFrame(Opcode opcode, const char* data, size_t len, bool fin){
+    if(!isOpen()){
+        return false;
+    }
+    return writeFrame(opcode, data, len, fin);
+}
+
+
+bool
+WebSocket::ping(std::string_view payload){
+    if(payload.size() > 125 || !isOpen()){
+        return false;
+    }
+    return writeFrame(PING, payload.data(), payload.size(), true);
+}
+
+
+void
+WebSocket::close(uint16_t code, std::string_view reason){
+    if(!isOpen()){
+        return;
+    }
+    if(!sendClose(code, reason)){
+        m_closed = true;
+        return;
+    }
+
+    // 等待对端的关闭帧，期间的数据消息丢弃
+    m_client->setRecvTimeout(CLOSE_TIMEOUT);
+    Message msg;
+    while(recv(msg)){
+    }
+}
+
+
+bool
+WebSocket::sendClose(uint16_t code, std::string_view reason){
+    char payload[125];
+    size_t len = 0;
+    if(code != CLOSE_NO_STATUS && code != CLOSE_ABNORMAL){
+        payload[0] = (char)(code >> 8);
+        payload[1] = (char)code;
+        len = 2 + std::min(reason.size(), sizeof(payload) - 2);
+        memcpy(payload + 2, reason.data(), len - 2);
+    }
+    m_close_sent = true;
+    return writeFrame(CLOSE, payload, len, true);
+}
+
+
+//帧头和负载用一次sendmsg发出，发送不完时从断点继续
+bool
+WebSocket::writeFrame(uint8_t opcode, const char* data, size_t len, bool fin){
+    char head[10];
+    size_t head_len = 2;
+    head[0] = (char)((fin ? 0x80 : 0) | opcode);
+    if(len < 126){
+        head[1] = (char)len;
+    }
+    else if(len <= 0xffff){
+        head[1] = 126;
+        head[2] = (char)(len >> 8);
+        head[3] = (char)len;
+        head_len = 4;
+    }
+    else{
+        head[1] = 127;
+        for(int i = 0; i < 8; ++i){
+            head[2+i] = (char)((uint64_t)len >> (56 - i * 8));
+        }
+        head_len = 10;
+    }
+
+    struct iovec iov[2];
+    iov[0].iov_base = head;
+    iov[0].iov_len = head_len;
+    iov[1].iov_base = (void*)data;
+    iov[1].iov_len = len;
+    int idx = 0, cnt = len ? 2 : 1;
+    while(idx < cnt){
+        int n = m_client->send(iov + idx, cnt - idx, 0);
+        if(n <= 0){
+            m_closed = true;
+            return false;
+        }
+        size_t sent = n;
+        while(idx < cnt && sent >= iov[idx].iov_len){
+            sent -= iov[idx].iov_len;
+            ++idx;
+        }
+        if(idx < cnt){
+            iov[idx].iov_base = (char*)iov[idx].iov_base + sent;
+            iov[idx].iov_len -= sent;
+        }
+    }
+    return true;
+}
+
+
+WebSocketRouter*
+WebSocketRouter::get_instance(){
+    static WebSocketRouter router;
+    return &router;
+}
+
+
+bool
+WebSocketRouter::addRoute(const std::string& path, Handler handler){
+    return m_routes.emplace(path, std::move(handler)).second;
+}
+
+
+const WebSocketRouter::Handler*
+WebSocketRouter::find(std::string_view path) const{
+    auto it = m_routes.find(path);
+    return it == m_routes.end() ? nullptr : &it->second;
+}
+
+} // namespace bryant
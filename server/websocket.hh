@@ -0,0 +1,196 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "../util/socket.hh"
+
+namespace bryant{
+
+// WebSocket连接(RFC 6455, 服务端)
+// 握手由http_conn完成，回复101之后在连接自己的协程里创建，读写都是阻塞式调用：
+// hook后的recv/send遇到EAGAIN只挂起当前协程，一个连接不需要额外的线程或回调。
+// 只能在所属协程里读写; 不支持扩展(permessage-deflate等)
+class WebSocket {
+public:
+    static const char GUID[];                       // 计算Sec-WebSocket-Accept用的固定串
+    static const size_t MAX_MESSAGE_SIZE = 1 << 20; // 默认的消息大小上限(分片合并后)
+    static const uint64_t CLOSE_TIMEOUT = 5000;     // 发送关闭帧后等待对端关闭帧的时间(ms)
+
+    // 帧类型
+    enum Opcode {
+        CONTINUATION = 0x0,
+        TEXT = 0x1,
+        BINARY = 0x2,
+        CLOSE = 0x8,
+        PING = 0x9,
+        PONG = 0xa
+    };
+
+    // 关闭码
+    enum CloseCode {
+        CLOSE_NORMAL = 1000,
+        CLOSE_GOING_AWAY = 1001,
+        CLOSE_PROTOCOL_ERROR = 1002,
+        CLOSE_UNSUPPORTED = 1003,
+        CLOSE_NO_STATUS = 1005,         // 关闭帧里没有关闭码(不能出现在帧里)
+        CLOSE_ABNORMAL = 1006,          // 没有收到关闭帧就断开了(不能出现在帧里)
+        CLOSE_INVALID_DATA = 1007,
+        CLOSE_POLICY = 1008,
+        CLOSE_TOO_BIG = 1009,
+        CLOSE_INTERNAL_ERROR = 1011
+    };
+
+    // 一条完整的数据消息
+    struct Message {
+        Opcode opcode = TEXT;   // TEXT或BINARY
+        std::string data;       // 分片已经合并, 已经解掩码
+    };
+
+    /**
+     * @brief 由握手的Sec-WebSocket-Key计算Sec-WebSocket-Accept
+     *
+     * @param key
+     * @param accept 28字节的base64串
+     */
+    static void AcceptKey(std::string_view key, std::string& accept);
+
+    /**
+     * @brief Construct a new Web Socket object
+     *
+     * @param client 已经回复了101的连接
+     * @param initial 101之前已经读到的数据(客户端可能紧接着握手就发送帧)
+     * @param max_message 消息大小上限, 超过时以1009关闭
+     */
+    WebSocket(sylar::Socket::ptr client, std::string_view initial = std::string_view(),
+            size_t max_message = MAX_MESSAGE_SIZE);
+
+    WebSocket(const WebSocket&) = delete;
+    WebSocket& operator=(const WebSocket&) = delete;
+
+    /**
+     * @brief 读取下一条数据消息, 期间收到的ping自动回复pong, pong忽略
+     *
+     * @param msg
+     * @return false 连接已关闭(对端关闭、协议错误或网络错误), 关闭码见getCloseCode()
+     */
+    bool recv(Message& msg);
+
+    /**
+     * @brief 发送一条不分片的消息
+     */
+    bool send(std::string_view data, Opcode opcode = TEXT);
+
+    /**
+     * @brief 发送一个帧, 用于分片发送: 第一片为TEXT/BINARY, 之后为CONTINUATION, 最后一片fin为true
+     */
+    bool sendFrame(Opcode opcode, const char* data, size_t len, bool fin);
+
+    /**
+     * @brief 发送ping, 负载不超过125字节
+     */
+    bool ping(std::string_view payload = std::string_view());
+
+    /**
+     * @brief 发送关闭帧并等待对端的关闭帧, 之后连接不能再读写
+     *
+     * @param code
+     * @param reason 不超过123字节
+     */
+    void close(uint16_t code = CLOSE_NORMAL, std::string_view reason = std::string_view());
+
+    /**
+     * @brief 连接是否还可以读写
+     */
+    bool isOpen() const {return !m_close_sent && !m_closed;}
+
+    /**
+     * @brief 对端给出的关闭码, 或者因出错关闭时的关闭码
+     */
+    uint16_t getCloseCode() const {return m_close_code;}
+
+private:
+    /**
+     * @brief 保证输入缓冲区里至少有n个字节
+     */
+    bool fill(size_t n);
+
+    /**
+     * @brief 处理一个控制帧
+     * @return false 收到了关闭帧或出错
+     */
+    bool handleControl(Opcode opcode, std::string& payload);
+
+    /**
+     * @brief 因错误关闭连接
+     */
+    bool fail(uint16_t code);
+
+    /**
+     * @brief 发送关闭帧
+     */
+    bool sendClose(uint16_t code, std::string_view reason);
+
+    /**
+     * @brief 组帧发送, 服务端发送的帧不加掩码
+     */
+    bool writeFrame(uint8_t opcode, const char* data, size_t len, bool fin);
+
+private:
+    sylar::Socket::ptr m_client;
+    std::string m_in;                   // 输入缓冲区
+    size_t m_in_pos = 0;                // 已处理到的位置
+    size_t m_max_message;               // 消息大小上限
+
+    Message m_fragmented;               // 正在接收的分片消息
+    bool m_in_fragment = false;         // 是否在接收分片消息
+
+    bool m_close_sent = false;          // 已经发送了关闭帧
+    bool m_closed = false;              // 收到了关闭帧或连接出错
+    uint16_t m_close_code = CLOSE_ABNORMAL;
+};
+
+
+// WebSocket路由：请求路径 -> 连接处理函数, 启动时注册, 之后只读
+// 处理函数在连接的协程里运行, 返回时连接关闭
+class WebSocketRouter {
+public:
+    using Handler = std::function<void(WebSocket& ws)>;
+
+    /**
+     * @brief Get the instance
+     *
+     * @return WebSocketRouter*
+     */
+    static WebSocketRouter* get_instance();
+
+    /**
+     * @brief 注册路由
+     *
+     * @param path 完整路径, 不含查询串
+     * @param handler
+     * @return false 路径已注册
+     */
+    bool addRoute(const std::string& path, Handler handler);
+
+    /**
+     * @brief 查找路由
+     *
+     * @return const Handler* 没有注册时返回nullptr
+     */
+    const Handler* find(std::string_view path) const;
+
+    /**
+     * @brief 删除所有路由
+     */
+    void clear() {m_routes.clear();}
+
+private:
+    std::map<std::string, Handler, std::less<> > m_routes;
+};
+
+} // namespace bryant
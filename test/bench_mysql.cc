@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "CGImysql/sql_connection_pool.hh"
+#include "log/logger.hh"
+#include "util/util.hh"
+
+using bryant::Connection_pool;
+
+// 用法: bench_mysql [用户名] [密码] [数据库] [行数]
+// 插入到一张临时表里(连接断开时自动删除), 不影响user表
+
+static const char SQL_CREATE[] = "CREATE TEMPORARY TABLE bench_user(username char(50) NULL, passwd char(50) NULL)";
+static const char SQL_INSERT[] = "INSERT INTO bench_user(username, passwd) VALUES(?, ?)";
+
+
+static std::string name_of(const char* prefix, int i){
+    return prefix + std::to_string(i);
+}
+
+
+// 原来的做法: 转义后拼成SQL文本, 服务端每次都要解析
+bool insert_text(MYSQL* mysql, int rows){
+    char name[128], password[128], sql[512];
+    for(int i = 0; i < rows; ++i){
+        std::string n = name_of("text", i);
+        std::string p = name_of("pwd", i);
+        mysql_real_escape_string(mysql, name, n.data(), n.size());
+        mysql_real_escape_string(mysql, password, p.data(), p.size());
+        snprintf(sql, sizeof(sql), "INSERT INTO bench_user(username, passwd) VALUES('%s', '%s')", name, password);
+        if(mysql_query(mysql, sql)){
+            printf("text insert error: %s\n", mysql_error(mysql));
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// 预处理语句: 每个连接prepare一次, 之后只传参数
+bool insert_prepared(MYSQL* mysql, int rows){
+    Connection_pool* pool = Connection_pool::get_instance();
+    for(int i = 0; i < rows; ++i){
+        std::string n = name_of("stmt", i);
+        std::string p = name_of("pwd", i);
+        if(unsigned int err = pool->execute(mysql, SQL_INSERT, {n, p})){
+            printf("prepared insert error: %u\n", err);
+            return false;
+        }
+    }
+    return true;
+}
+
+
+template<class F>
+void bench(const char* name, MYSQL* mysql, int rows, F fn){
+    uint64_t begin = bryant::GetCurrentUS();
+    if(!fn(mysql, rows)){
+        return;
+    }
+    uint64_t cost = bryant::GetCurrentUS() - begin;
+    printf("%-16s %8.0f rows/s  %8.1f us/row\n", name, rows / (cost / 1e6), (double)cost / rows);
+}
+
+
+int main(int argc, char* argv[]){
+    const char* user = argc > 1 ? argv[1] : "root";
+    const char* passwd = argc > 2 ? argv[2] : "root";
+    const char* database = argc > 3 ? argv[3] : "bryant_webserver";
+    int rows = argc > 4 ? atoi(argv[4]) : 10000;
+
+    bryant::Logger::getInstance()->init("benchMysqlLogger");
+
+    // 临时表只对创建它的连接可见, 所以只用一个连接
+    Connection_pool* pool = Connection_pool::get_instance();
+    pool->init("localhost", user, passwd, database, 3306, 1);
+    MYSQL* mysql = nullptr;
+    bryant::connectionRAII mysqlcon(&mysql, pool);
+    if(!mysql || mysql_query(mysql, SQL_CREATE)){
+        printf("create table error: %s\n", mysql ? mysql_error(mysql) : "no connection");
+        return 1;
+    }
+
+    printf("rows: %d\n", rows);
+    bench("text protocol", mysql, rows, insert_text);
+    bench("prepared", mysql, rows, insert_prepared);
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+#include <vector>
+
+#include "util/http_scan.hh"
+#include "util/util.hh"
+
+using bryant::LineScan;
+using bryant::ScanImpl;
+
+// 浏览器发出的典型请求头
+const char* sample_request =
+    "GET /xxx.jpg HTTP/1.1\r\n"
+    "Host: 127.0.0.1:9006\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+    "sec-ch-ua-platform: \"Linux\"\r\n"
+    "Accept: image/avif,image/webp,image/apng,image/svg+xml,image/*,*/*;q=0.8\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Dest: image\r\n"
+    "Referer: http://127.0.0.1:9006/picture.html\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark; lang=zh-CN\r\n"
+    "\r\n";
+
+struct Known {
+    const char* name;   // 带':'
+    size_t len;         // 不含':'
+};
+const Known known[] = {{"Connection:", 10}, {"Content-length:", 14}, {"Range:", 5}, {"If-Range:", 8}, 
+                    {"If-None-Match:", 13}, {"If-Modified-Since:", 17}, {"Accept-Encoding:", 15}, {"Host:", 4}};
+
+
+// 原来的状态机只找行尾
+size_t split_bytewise(const char* buf, size_t len){
+    size_t lines = 0;
+    for(size_t i = 0; i + 1 < len; ++i){
+        if(buf[i] == '\r' && buf[i + 1] == '\n'){
+            ++lines;
+            ++i;
+        }
+    }
+    return lines;
+}
+
+
+// 扫描器只找行尾(同时得到':')
+size_t split_scan(const char* buf, size_t len){
+    size_t lines = 0, pos = 0;
+    while(pos < len){
+        LineScan scan;
+        bryant::ScanLine(buf + pos, len - pos, scan);
+        lines += (scan.end < len - pos);
+        pos += scan.end + 2;
+    }
+    return lines;
+}
+
+
+// 原来的状态机: 逐字节找"\r\n"，再用一串strncasecmp匹配请求头
+size_t parse_bytewise(const char* buf, size_t len){
+    size_t matched = 0, start = 0;
+    for(size_t i = 0; i + 1 < len; ++i){
+        if(buf[i] == '\r' && buf[i + 1] == '\n'){
+            const char* line = buf + start;
+            for(const Known& k : known){
+                if(strncasecmp(line, k.name, k.len + 1) == 0){
+                    ++matched;
+                    break;
+                }
+            }
+            start = ++i + 1;
+        }
+    }
+    return matched;
+}
+
+
+// 扫描器: 一次得到行尾和':'，先比较名字长度
+size_t parse_scan(const char* buf, size_t len){
+    size_t matched = 0, pos = 0;
+    while(pos < len){
+        LineScan scan;
+        bryant::ScanLine(buf + pos, len - pos, scan);
+        if(scan.colon != LineScan::npos){
+            for(const Known& k : known){
+                if(scan.colon == k.len && strncasecmp(buf + pos, k.name, k.len) == 0){
+                    ++matched;
+                    break;
+                }
+            }
+        }
+        pos += scan.end + 2;
+    }
+    return matched;
+}
+
+
+template<class F>
+void bench(const char* name, const std::string& data, F fn){
+    const int rounds = 200000;
+    size_t total = 0;
+    uint64_t begin = bryant::GetCurrentUS();
+    for(int i = 0; i < rounds; ++i){
+        total += fn(data.data(), data.size());
+    }
+    uint64_t cost = bryant::GetCurrentUS() - begin;
+    double mb = (double)data.size() * rounds / (1 << 20);
+    printf("%-24s %8.1f MB/s  %6.1f ns/request  (result %zu)\n", 
+            name, mb / (cost / 1e6), cost * 1000.0 / rounds, total / rounds);
+}
+
+
+int main(){
+    std::string data(sample_request);
+    printf("request size: %zu bytes\n", data.size());
+
+    // 只切分行
+    bench("split bytewise", data, split_bytewise);
+    const ScanImpl impls[] = {ScanImpl::SCALAR, ScanImpl::SSE42, ScanImpl::AVX2};
+    for(ScanImpl impl : impls){
+        if(bryant::SetScanImpl(impl)){
+            std::string name = std::string("split ") + bryant::ScanImplName(impl);
+            bench(name.c_str(), data, split_scan);
+        }
+    }
+
+    // 切分行并匹配已知的请求头
+    bench("headers bytewise", data, parse_bytewise);
+    for(ScanImpl impl : impls){
+        if(bryant::SetScanImpl(impl)){
+            std::string name = std::string("headers ") + bryant::ScanImplName(impl);
+            bench(name.c_str(), data, parse_scan);
+        }
+    }
+    return 0;
+}
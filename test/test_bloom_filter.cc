@@ -0,0 +1,96 @@
+#include <assert.h>
+#include <stdio.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "server/bloom_filter.hh"
+#include "fiberLibrary/thread.hh"
+
+using bryant::BloomFilter;
+
+
+static std::string name_of(int i){
+    return "user" + std::to_string(i);
+}
+
+
+// 加入过的一定在; 没加入过的误判率和估计值接近, 且在设计值(约1%)附近
+void test_basic(){
+    const int N = 100000;
+    BloomFilter filter(N);
+    assert(filter.estimated_fpp() == 0);
+    for(int i = 0; i < N; ++i){
+        filter.add(name_of(i));
+    }
+    for(int i = 0; i < N; ++i){
+        assert(filter.may_contain(name_of(i)));
+    }
+
+    int positives = 0;
+    for(int i = N; i < N * 11; ++i){
+        if(filter.may_contain(name_of(i))){
+            ++positives;
+            filter.false_positive();
+        }
+    }
+    double measured = (double)positives / (N * 10);
+    printf("basic: %zu bytes, estimated fpp %.4f, measured fpp %.4f, observed fpp %.4f\n",
+           filter.bytes(), filter.estimated_fpp(), measured, filter.observed_fpp());
+    assert(measured < 0.02);
+    assert(filter.estimated_fpp() > measured * 0.7 && filter.estimated_fpp() < measured * 1.3);
+    assert(filter.observed_fpp() > measured * 0.99 && filter.observed_fpp() < measured * 1.01);
+}
+
+
+// 超出容量后误判率上升, 估计值能反映出来
+void test_overflow(){
+    const int N = 10000;
+    BloomFilter filter(N);
+    for(int i = 0; i < N * 4; ++i){
+        filter.add(name_of(i));
+    }
+    int positives = 0;
+    for(int i = N * 4; i < N * 14; ++i){
+        positives += filter.may_contain(name_of(i));
+    }
+    double measured = (double)positives / (N * 10);
+    printf("overflow: estimated fpp %.4f, measured fpp %.4f\n", filter.estimated_fpp(), measured);
+    assert(measured > 0.1);
+    assert(filter.estimated_fpp() > measured * 0.7 && filter.estimated_fpp() < measured * 1.3);
+}
+
+
+// 多个线程同时插入和查询, 插入完之后所有用户名都在
+static BloomFilter s_filter(400000);
+static const int PER_THREAD = 100000;
+
+void adder(int id){
+    for(int i = id * PER_THREAD; i < (id + 1) * PER_THREAD; ++i){
+        s_filter.add(name_of(i));
+        assert(s_filter.may_contain(name_of(i)));
+    }
+}
+
+void test_threads(){
+    std::vector<bryant::Thread::ptr> threads;
+    for(int i = 0; i < 4; ++i){
+        threads.push_back(std::make_shared<bryant::Thread>(std::bind(adder, i), "adder_" + std::to_string(i)));
+    }
+    for(auto& thread : threads){
+        thread->join();
+    }
+    for(int i = 0; i < PER_THREAD * 4; ++i){
+        assert(s_filter.may_contain(name_of(i)));
+    }
+    assert(s_filter.size() == (size_t)PER_THREAD * 4);
+    printf("threads: ok, estimated fpp %.4f\n", s_filter.estimated_fpp());
+}
+
+
+int main(){
+    test_basic();
+    test_overflow();
+    test_threads();
+    return 0;
+}
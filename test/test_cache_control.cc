@@ -0,0 +1,38 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "server/cache_control.hh"
+
+
+// 按扩展名匹配，不区分大小写
+void test_ext(){
+    bryant::CacheControl* cc = bryant::CacheControl::get_instance();
+    cc->init("html=0,gif=86400,.jpg=3600");
+    assert(cc->getMaxAge("/root/judge.html") == 0);
+    assert(cc->getMaxAge("/root/login.GIF") == 86400);
+    assert(cc->getMaxAge("/root/xxx.jpg") == 3600);
+    assert(cc->getMaxAge("/root/video.mp4") == -1);
+    assert(cc->getMaxAge("/root.d/README") == -1);
+    printf("ext: ok\n");
+}
+
+
+// "*"为默认值，无法解析的项被忽略
+void test_default(){
+    bryant::CacheControl* cc = bryant::CacheControl::get_instance();
+    cc->init("gif=60,*=10,bad,=5,png=,jpg=-1");
+    assert(cc->getMaxAge("/root/login.gif") == 60);
+    assert(cc->getMaxAge("/root/a.png") == 10);
+    assert(cc->getMaxAge("/root/a.jpg") == 10);
+    assert(cc->getMaxAge("/root/noext") == 10);
+    cc->init("");
+    assert(cc->getMaxAge("/root/login.gif") == -1);
+    printf("default: ok\n");
+}
+
+
+int main(){
+    test_ext();
+    test_default();
+    return 0;
+}
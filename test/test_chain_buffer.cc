@@ -0,0 +1,102 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "util/chain_buffer.hh"
+
+using bryant::ChainBuffer;
+using bryant::SlabPool;
+
+
+// 向tail写入字符串
+void append(ChainBuffer& buf, const char* str){
+    size_t len = strlen(str);
+    assert(buf.writable() >= len);
+    memcpy(buf.data() + buf.size(), str, len);
+    buf.commit(len);
+}
+
+
+// 小请求只占用一个slab
+void test_small(){
+    ChainBuffer buf;
+    assert(buf.reserve(0) == 0);
+    assert(buf.blocks() == 1 && buf.capacity() == SlabPool::SLAB_SIZE);
+    append(buf, "GET / HTTP/1.1\r\n\r\n");
+    assert(buf.reserve(0) == 0);
+    assert(buf.footprint() == SlabPool::SLAB_SIZE);
+    printf("small: ok\n");
+}
+
+
+// tail写满时，未解析完的数据搬到新块，之前的块保持不变
+void test_grow(){
+    ChainBuffer buf;
+    buf.reserve(0);
+    char line[SlabPool::SLAB_SIZE];
+    memset(line, 'a', sizeof(line));
+    memcpy(line, "Host: x", 7);
+    memcpy(buf.data(), line, sizeof(line));
+    buf.commit(sizeof(line));
+    char* first = buf.data();
+
+    // 前100字节已解析, 其余是半行
+    long shift = buf.reserve(100);
+    assert(shift == 100);
+    assert(buf.blocks() == 2);
+    assert(buf.size() == SlabPool::SLAB_SIZE - 100);
+    assert(buf.capacity() == SlabPool::SLAB_SIZE * 2);
+    assert(memcmp(buf.data(), line + 100, buf.size()) == 0);
+    assert(memcmp(first, "Host: x", 7) == 0); // 旧块仍然有效
+
+    // 一行超过slab时按倍数增长
+    memset(buf.data() + buf.size(), 'b', buf.writable());
+    buf.commit(buf.writable());
+    assert(buf.reserve(0) == 0);
+    assert(buf.blocks() == 2 && buf.capacity() == SlabPool::SLAB_SIZE * 4);
+    assert(buf.size() == SlabPool::SLAB_SIZE * 2 && buf.data()[0] == 'a');
+    assert(memcmp(first, "Host: x", 7) == 0);
+
+    // 请求边界: 丢弃旧块, 剩余数据放得进slab时换回slab
+    buf.consume(buf.size() - 10);
+    assert(buf.blocks() == 1 && buf.size() == 10);
+    assert(buf.footprint() == SlabPool::SLAB_SIZE);
+    printf("grow: ok\n");
+}
+
+
+// 请求体需要连续存放，超过上限时失败
+void test_body(){
+    ChainBuffer buf(16 * 1024);
+    buf.reserve(0);
+    append(buf, "POST /3 HTTP/1.1\r\n\r\nuser=");
+    long shift = buf.reserve(20, 5000);
+    assert(shift == 20);
+    assert(buf.capacity() >= 5000 && memcmp(buf.data(), "user=", 5) == 0);
+    assert(buf.reserve(0, 64 * 1024) == -1);
+    printf("body: ok\n");
+}
+
+
+// 释放后slab回到池中被复用(前面的测试已经归还过slab)
+void test_pool(){
+    SlabPool* pool = SlabPool::get_instance();
+    size_t idle = pool->idle();
+    assert(idle > 0);
+    {
+        ChainBuffer buf;
+        buf.reserve(0);
+        assert(pool->idle() == idle - 1);
+    }
+    assert(pool->idle() == idle);
+    printf("pool: ok\n");
+}
+
+
+int main(){
+    test_small();
+    test_grow();
+    test_body();
+    test_pool();
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <string>
+
+#include "server/compress_cache.hh"
+
+const char* path_a = "/tmp/test_compress_cache_a.html";
+const char* path_b = "/tmp/test_compress_cache_b.html";
+
+
+// 先写临时文件再rename，与发布静态资源的方式一致
+void write_file(const char* path, const std::string& content){
+    std::string tmp = std::string(path) + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "w");
+    fwrite(content.data(), 1, content.size(), fp);
+    fclose(fp);
+    rename(tmp.c_str(), path);
+}
+
+
+// 解压gzip数据
+std::string gunzip(const std::string& data){
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    assert(inflateInit2(&zs, 15 + 16) == Z_OK);
+    std::string out(1 << 20, '\0');
+    zs.next_in = (Bytef*)data.data();
+    zs.avail_in = data.size();
+    zs.next_out = (Bytef*)&out[0];
+    zs.avail_out = out.size();
+    assert(inflate(&zs, Z_FINISH) == Z_STREAM_END);
+    out.resize(zs.total_out);
+    inflateEnd(&zs);
+    return out;
+}
+
+
+// 等待后台线程压缩完成
+bryant::CompressCache::Variant::ptr wait_variant(const char* path){
+    struct stat st;
+    assert(stat(path, &st) == 0);
+    for(int i = 0; i < 200; ++i){
+        bryant::CompressCache::Variant::ptr variant = bryant::CompressCache::get_instance()->lookup(path, st);
+        if(variant){
+            return variant;
+        }
+        usleep(10 * 1000);
+    }
+    return nullptr;
+}
+
+
+std::string make_html(const char* word){
+    std::string html = "<html><body>";
+    for(int i = 0; i < 200; ++i){
+        html += "<p>";
+        html += word;
+        html += "</p>\n";
+    }
+    return html + "</body></html>";
+}
+
+
+// 第一次未命中，后台压缩完成后命中，解压结果与原文件一致
+void test_compress(){
+    bryant::CompressCache* cache = bryant::CompressCache::get_instance();
+    cache->init(1 << 20, 256, 6);
+    std::string html = make_html("hello");
+    write_file(path_a, html);
+
+    struct stat st;
+    stat(path_a, &st);
+    assert(cache->lookup(path_a, st) == nullptr);
+    bryant::CompressCache::Variant::ptr variant = wait_variant(path_a);
+    assert(variant);
+    assert(variant->data.size() * 4 < html.size());
+    assert(gunzip(variant->data) == html);
+    printf("compress: ok\n");
+}
+
+
+// 原文件变化后旧的压缩结果失效，重新压缩
+void test_stale(){
+    bryant::CompressCache::Variant::ptr old_variant = wait_variant(path_a);
+    std::string html = make_html("world!");
+    write_file(path_a, html);
+
+    bryant::CompressCache::Variant::ptr variant = wait_variant(path_a);
+    assert(variant && variant != old_variant);
+    assert(gunzip(variant->data) == html);
+    assert(gunzip(old_variant->data) == make_html("hello")); // 旧句柄依然有效
+    printf("stale: ok\n");
+}
+
+
+// 太小的文件和不可压缩的类型不压缩
+void test_skip(){
+    bryant::CompressCache* cache = bryant::CompressCache::get_instance();
+    write_file(path_b, "<html></html>");
+    struct stat st;
+    stat(path_b, &st);
+    assert(cache->lookup(path_b, st) == nullptr);
+    usleep(100 * 1000);
+    assert(cache->lookup(path_b, st) == nullptr);
+
+    assert(bryant::CompressCache::isCompressible("/root/judge.html"));
+    assert(bryant::CompressCache::isCompressible("/root/app.JS"));
+    assert(!bryant::CompressCache::isCompressible("/root/xxx.jpg"));
+    assert(!bryant::CompressCache::isCompressible("/root.html/noext"));
+    printf("skip: ok\n");
+}
+
+
+int main(){
+    test_compress();
+    test_stale();
+    test_skip();
+    unlink(path_a);
+    unlink(path_b);
+    return 0;
+}
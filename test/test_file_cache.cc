@@ -0,0 +1,86 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+
+#include "server/file_cache.hh"
+
+const char* path_a = "/tmp/test_file_cache_a.html";
+const char* path_b = "/tmp/test_file_cache_b.html";
+const char* path_c = "/tmp/test_file_cache_c.html";
+
+
+// 先写临时文件再rename，与发布静态资源的方式一致，避免原地修改已映射的文件
+void write_file(const char* path, const char* content){
+    std::string tmp = std::string(path) + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "w");
+    fputs(content, fp);
+    fclose(fp);
+    rename(tmp.c_str(), path);
+}
+
+
+// 命中时返回同一个缓存项，映射内容与文件一致
+void test_hit(){
+    bryant::FileCache* cache = bryant::FileCache::get_instance();
+    cache->init(2, 1 << 20, 100);
+    write_file(path_a, "<html>a</html>");
+
+    bryant::FileCache::Entry::ptr e1 = cache->acquire(path_a);
+    bryant::FileCache::Entry::ptr e2 = cache->acquire(path_a);
+    assert(e1 && e1 == e2);
+    assert(memcmp(e1->addr, "<html>a</html>", e1->st.st_size) == 0);
+    assert(cache->acquire("/tmp/test_file_cache_not_exist") == nullptr);
+    assert(cache->acquire("/tmp") == nullptr);
+    printf("hit: ok\n");
+}
+
+
+// 过期后文件变化则重新加载，旧句柄依然有效
+void test_ttl(){
+    bryant::FileCache* cache = bryant::FileCache::get_instance();
+    bryant::FileCache::Entry::ptr old_entry = cache->acquire(path_a);
+
+    write_file(path_a, "<html>changed</html>");
+    assert(cache->acquire(path_a) == old_entry); // 未过期，不校验
+
+    usleep(150 * 1000);
+    bryant::FileCache::Entry::ptr new_entry = cache->acquire(path_a);
+    assert(new_entry != old_entry);
+    assert(memcmp(new_entry->addr, "<html>changed</html>", new_entry->st.st_size) == 0);
+    assert(memcmp(old_entry->addr, "<html>a</html>", old_entry->st.st_size) == 0);
+    printf("ttl: ok\n");
+}
+
+
+// 超出文件数上限时淘汰最久未使用的文件
+void test_lru(){
+    bryant::FileCache* cache = bryant::FileCache::get_instance();
+    cache->clear();
+    write_file(path_b, "<html>b</html>");
+    write_file(path_c, "<html>c</html>");
+
+    cache->acquire(path_a);
+    cache->acquire(path_b);
+    cache->acquire(path_a);
+    cache->acquire(path_c);
+    assert(cache->size() == 2);
+
+    // path_b最久未使用，已被淘汰
+    bryant::FileCache::Entry::ptr b = cache->acquire(path_b);
+    assert(b && cache->size() == 2);
+    printf("lru: ok\n");
+}
+
+
+int main(){
+    test_hit();
+    test_ttl();
+    test_lru();
+    unlink(path_a);
+    unlink(path_b);
+    unlink(path_c);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "server/handlers.hh"
+#include "server/user_store.hh"
+#include "fiberLibrary/thread.hh"
+
+using bryant::HttpRequest;
+using bryant::HttpResponse;
+using bryant::Router;
+
+
+static std::string name_of(int i){
+    return "user" + std::to_string(i);
+}
+
+
+// 调用POST path的处理函数, 返回"状态码 页面"
+static std::string post(Router& router, const char* path, const std::string& body){
+    HttpRequest req;
+    req.path = path;
+    req.body = body;
+    const Router::Handler* handler = nullptr;
+    assert(router.route(bryant::ROUTE_POST, req, handler) == Router::MATCHED);
+    HttpResponse resp;
+    (*handler)(req, resp);
+    return std::to_string(resp.status) + " " + std::string(resp.file);
+}
+
+static std::string login(Router& router, const std::string& name, const std::string& password){
+    return post(router, "/2CGISQL.cgi", "user=" + name + "&password=" + password);
+}
+
+static std::string register_user(Router& router, const std::string& name, const std::string& password){
+    return post(router, "/3CGISQL.cgi", "user=" + name + "&password=" + password);
+}
+
+
+// 整表加载模式下, 登录/注册内存表里没有的用户时加载恰好完成: 不能碰到不存在的Bloom filter
+// 没有初始化连接池, 要查库的请求都拿不到连接, 由结果区分有没有查库
+static Router s_router;
+static std::atomic<bool> s_loaded{false};
+static std::atomic<int> s_before{0};    // 加载完以前处理的轮数
+static const int ROUNDS = 2000;
+
+void client(int id){
+    int after = 0;
+    for(int i = 0; after < ROUNDS; ++i){
+        bool loaded = s_loaded;
+        std::string name = name_of(id * 1000000 + i);
+
+        // 加载完以前查库失败, 之后不再查库; 两种结果都是登录失败
+        assert(login(s_router, name, "pwd") == "200 /logError.html");
+
+        // 加载完以前查库失败返回500; 之后直接占用户名, 写库失败再回滚
+        std::string result = register_user(s_router, name, "pwd");
+        assert(result == "500 /registerError.html" || result == "200 /registerError.html");
+        if(loaded){
+            assert(result == "200 /registerError.html");
+            ++after;
+        }
+        else{
+            ++s_before;
+        }
+
+        // 内存表里的用户不查库
+        assert(login(s_router, "alice", "123") == "200 /welcome.html");
+    }
+}
+
+void test_loading(){
+    bryant::RegisterRoutes(&s_router);
+    assert(bryant::UserStore::get_instance()->insert("alice", "123"));
+
+    std::vector<bryant::Thread::ptr> threads;
+    for(int i = 0; i < 4; ++i){
+        threads.push_back(std::make_shared<bryant::Thread>(std::bind(client, i), "client_" + std::to_string(i)));
+    }
+    // 每个线程都在查的时候加载完
+    while(s_before < 400){
+        usleep(1000);
+    }
+    bryant::MarkUsersLoaded();
+    s_loaded = true;
+    for(auto& thread : threads){
+        thread->join();
+    }
+    assert(bryant::UserStore::get_instance()->size() == 1);
+    printf("loading: ok\n");
+}
+
+
+int main(){
+    test_loading();
+    return 0;
+}
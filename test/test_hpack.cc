@@ -0,0 +1,181 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "server/hpack.hh"
+
+using bryant::HpackHeader;
+
+
+static std::string from_hex(const char* hex){
+    std::string out;
+    for(const char* p = hex; p[0] && p[1]; ){
+        if(*p == ' '){
+            ++p;
+            continue;
+        }
+        char byte[3] = {p[0], p[1], 0};
+        out.push_back((char)strtol(byte, nullptr, 16));
+        p += 2;
+    }
+    return out;
+}
+
+
+static std::string to_hex(const std::string& data){
+    std::string out;
+    char buf[3];
+    for(unsigned char c : data){
+        snprintf(buf, sizeof(buf), "%02x", c);
+        out += buf;
+    }
+    return out;
+}
+
+
+static bool decode(bryant::HpackDecoder& decoder, const char* hex, std::vector<HpackHeader>& out){
+    std::string block = from_hex(hex);
+    out.clear();
+    return decoder.decode((const uint8_t*)block.data(), block.size(), out);
+}
+
+
+// RFC 7541 附录C.4中的Huffman编码
+void test_huffman(){
+    const char* cases[][2] = {
+        {"www.example.com", "f1e3c2e5f23a6ba0ab90f4ff"},
+        {"no-cache", "a8eb10649cbf"},
+        {"custom-key", "25a849e95ba97d7f"},
+        {"custom-value", "25a849e95bb8e8b4bf"},
+        {"302", "6402"},
+        {"private", "aec3771a4b"},
+        {"Mon, 21 Oct 2013 20:13:21 GMT", "d07abe941054d444a8200595040b8166e082a62d1bff"},
+        {"https://www.example.com", "9d29ad171863c78f0b97c8e9ae82ae43d3"},
+    };
+    for(auto& c : cases){
+        std::string encoded;
+        bryant::HuffmanEncode(c[0], encoded);
+        assert(to_hex(encoded) == c[1]);
+        assert(bryant::HuffmanEncodedLength(c[0]) == encoded.size());
+
+        std::string decoded;
+        assert(bryant::HuffmanDecode((const uint8_t*)encoded.data(), encoded.size(), decoded));
+        assert(decoded == c[0]);
+    }
+
+    // 所有字节值都能往返
+    std::string all;
+    for(int i = 0; i < 256; ++i){
+        all.push_back((char)i);
+    }
+    std::string encoded, decoded;
+    bryant::HuffmanEncode(all, encoded);
+    assert(bryant::HuffmanDecode((const uint8_t*)encoded.data(), encoded.size(), decoded) && decoded == all);
+
+    // 填充不是全1、填充超过7位、包含EOS都是错误
+    std::string bad = from_hex("f1e3c2e5f23a6ba0ab90f4fe");
+    assert(!bryant::HuffmanDecode((const uint8_t*)bad.data(), bad.size(), decoded));
+    bad = from_hex("f1e3c2e5f23a6ba0ab90f4ffff");
+    assert(!bryant::HuffmanDecode((const uint8_t*)bad.data(), bad.size(), decoded));
+    bad = from_hex("ffffffff");
+    assert(!bryant::HuffmanDecode((const uint8_t*)bad.data(), bad.size(), decoded));
+    printf("huffman: ok\n");
+}
+
+
+// RFC 7541 附录C.3/C.4: 同一连接上的三个请求，动态表跨请求头块生效
+void test_decode_requests(){
+    const char* plain[] = {
+        "828684410f7777772e6578616d706c652e636f6d",
+        "828684be58086e6f2d6361636865",
+        "828785bf400a637573746f6d2d6b65790c637573746f6d2d76616c7565",
+    };
+    const char* huffman[] = {
+        "828684418cf1e3c2e5f23a6ba0ab90f4ff",
+        "828684be5886a8eb10649cbf",
+        "828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf",
+    };
+    const size_t table_size[] = {57, 110, 164};
+
+    for(const char** blocks : {plain, huffman}){
+        bryant::HpackDecoder decoder;
+        std::vector<HpackHeader> headers;
+
+        assert(decode(decoder, blocks[0], headers) && headers.size() == 4);
+        assert(headers[0].name == ":method" && headers[0].value == "GET");
+        assert(headers[1].name == ":scheme" && headers[1].value == "http");
+        assert(headers[2].name == ":path" && headers[2].value == "/");
+        assert(headers[3].name == ":authority" && headers[3].value == "www.example.com");
+        assert(decoder.tableSize() == table_size[0]);
+
+        assert(decode(decoder, blocks[1], headers) && headers.size() == 5);
+        assert(headers[3].value == "www.example.com");
+        assert(headers[4].name == "cache-control" && headers[4].value == "no-cache");
+        assert(decoder.tableSize() == table_size[1]);
+
+        assert(decode(decoder, blocks[2], headers) && headers.size() == 5);
+        assert(headers[1].value == "https" && headers[2].value == "/index.html");
+        assert(headers[4].name == "custom-key" && headers[4].value == "custom-value");
+        assert(decoder.tableSize() == table_size[2] && decoder.tableEntries() == 3);
+    }
+    printf("decode requests: ok\n");
+}
+
+
+// 动态表按大小淘汰，大小更新只能在块开头且不能超过上限
+void test_table_size(){
+    bryant::HpackDecoder decoder(100);
+    std::vector<HpackHeader> headers;
+    // custom-key: custom-value 占54字节，第二条插入时淘汰第一条
+    assert(decode(decoder, "400a637573746f6d2d6b65790c637573746f6d2d76616c7565", headers));
+    assert(decode(decoder, "400a637573746f6d2d6b65790c637573746f6d2d76616c7565", headers));
+    assert(decoder.tableEntries() == 1 && decoder.tableSize() == 54);
+
+    assert(decode(decoder, "20", headers) && decoder.tableEntries() == 0);   // 大小更新为0
+    assert(!decode(decoder, "3f46", headers));                              // 超过通告的100
+    assert(!decode(decoder, "8220", headers));                              // 不在块开头
+    assert(!decode(decoder, "be", headers));                                // 动态表里没有
+    assert(!decode(decoder, "80", headers));                                // 索引0
+    assert(!decode(decoder, "400a6375", headers));                          // 字符串被截断
+    printf("table size: ok\n");
+}
+
+
+// 编码结果可以被解码器还原
+void test_encode(){
+    std::string block;
+    bryant::HpackEncoder::encodeStatus(200, block);
+    bryant::HpackEncoder::encodeStatus(405, block);
+    bryant::HpackEncoder::encode("content-length", "586", block);
+    bryant::HpackEncoder::encode("etag", "\"11e038-24a-67260586\"", block);
+    bryant::HpackEncoder::encode("x-custom", "value", block);
+    assert((unsigned char)block[0] == 0x88);
+
+    bryant::HpackDecoder decoder;
+    std::vector<HpackHeader> headers;
+    assert(decoder.decode((const uint8_t*)block.data(), block.size(), headers) && headers.size() == 5);
+    assert(headers[0].name == ":status" && headers[0].value == "200");
+    assert(headers[1].name == ":status" && headers[1].value == "405");
+    assert(headers[2].name == "content-length" && headers[2].value == "586");
+    assert(headers[3].value == "\"11e038-24a-67260586\"");
+    assert(headers[4].name == "x-custom" && headers[4].value == "value");
+    assert(decoder.tableEntries() == 0);
+
+    // 多字节整数
+    std::string out;
+    bryant::HpackEncoder::encodeInt(1337, 5, 0, out);
+    assert(to_hex(out) == "1f9a0a");
+    printf("encode: ok\n");
+}
+
+
+int main(){
+    test_huffman();
+    test_decode_requests();
+    test_table_size();
+    test_encode();
+    return 0;
+}
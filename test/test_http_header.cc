@@ -0,0 +1,98 @@
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "server/http_header.hh"
+
+using bryant::HeaderId;
+
+
+// 每个已知请求头都能查到，不区分大小写
+void test_lookup(){
+    for(size_t i = 0; i < bryant::HEADER_ID_COUNT; ++i){
+        HeaderId id = (HeaderId)i;
+        std::string name = bryant::HeaderName(id);
+        assert(bryant::LookupHeader(name.c_str(), name.size()) == id);
+
+        std::string lower = name, upper = name;
+        for(size_t j = 0; j < name.size(); ++j){
+            lower[j] = tolower(name[j]);
+            upper[j] = toupper(name[j]);
+        }
+        assert(bryant::LookupHeader(lower.c_str(), lower.size()) == id);
+        assert(bryant::LookupHeader(upper.c_str(), upper.size()) == id);
+    }
+    printf("lookup: ok\n");
+}
+
+
+// 未知请求头、前缀、多一个字符都返回UNKNOWN
+void test_unknown(){
+    const char* names[] = {"X-Custom", "Hos", "Hostt", "Content-Lengths", "", "Sec-WebSocket-Keyx",
+                            "Accept-Encodinh", "A-very-long-header-name-that-is-not-known"};
+    for(const char* name : names){
+        assert(bryant::LookupHeader(name, strlen(name)) == HeaderId::UNKNOWN);
+    }
+    assert(strcmp(bryant::HeaderName(HeaderId::UNKNOWN), "") == 0);
+    printf("unknown: ok\n");
+}
+
+
+// 按编号/名字取值，重复的请求头取第一个，未知请求头也保留
+void test_table(){
+    char buf[] = "Host\0example.com\0X-Trace\0abc\0Cookie\0a=1\0Cookie\0b=2";
+    bryant::HeaderTable table;
+    table.clear();
+    assert(table.add(HeaderId::HOST, buf, 4, buf + 5, 11));
+    assert(table.add(HeaderId::UNKNOWN, buf + 17, 7, buf + 25, 3));
+    assert(table.add(HeaderId::COOKIE, buf + 29, 6, buf + 36, 3));
+    assert(table.add(HeaderId::COOKIE, buf + 40, 6, buf + 47, 3));
+
+    assert(table.size() == 4);
+    assert(table.has(HeaderId::HOST) && !table.has(HeaderId::RANGE) && !table.has(HeaderId::UNKNOWN));
+    assert(table.get(HeaderId::HOST) == "example.com");
+    assert(strcmp(table.getCStr(HeaderId::HOST), "example.com") == 0);
+    assert(table.getCStr(HeaderId::RANGE) == nullptr && table.get(HeaderId::RANGE).empty());
+    assert(table.get(HeaderId::COOKIE) == "a=1");
+    assert(table.get("x-trace") == "abc");
+    assert(table.get("COOKIE") == "a=1");
+    assert(table.get("X-Missing").empty());
+    assert(table[3].getValue() == "b=2");
+
+    size_t n = 0;
+    for(const bryant::HttpHeader& header : table){
+        assert(header.getName().size() > 0);
+        ++n;
+    }
+    assert(n == 4);
+
+    table.clear();
+    assert(table.size() == 0 && !table.has(HeaderId::HOST));
+    printf("table: ok\n");
+}
+
+
+// 超过上限时add失败
+void test_overflow(){
+    char name[] = "X-A";
+    char value[] = "v";
+    bryant::HeaderTable table;
+    table.clear();
+    for(size_t i = 0; i < bryant::HeaderTable::MAX_HEADERS; ++i){
+        assert(table.add(HeaderId::UNKNOWN, name, 3, value, 1));
+    }
+    assert(!table.add(HeaderId::HOST, name, 3, value, 1));
+    assert(!table.has(HeaderId::HOST));
+    printf("overflow: ok\n");
+}
+
+
+int main(){
+    test_lookup();
+    test_unknown();
+    test_table();
+    test_overflow();
+    return 0;
+}
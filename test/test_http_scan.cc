@@ -0,0 +1,82 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "util/http_scan.hh"
+
+using bryant::LineScan;
+using bryant::ScanImpl;
+
+const ScanImpl impls[] = {ScanImpl::SCALAR, ScanImpl::SSE42, ScanImpl::AVX2};
+
+
+// 各实现对同一输入的结果必须与逐字节实现一致
+void check_all(const char* buf, size_t len){
+    LineScan expect;
+    bryant::SetScanImpl(ScanImpl::SCALAR);
+    bryant::ScanLine(buf, len, expect);
+
+    for(ScanImpl impl : impls){
+        if(!bryant::SetScanImpl(impl)){
+            continue;
+        }
+        LineScan out;
+        bryant::ScanLine(buf, len, out);
+        assert(out.end == expect.end);
+        assert(out.colon == expect.colon);
+    }
+}
+
+
+// 常见的请求头
+void test_header(){
+    const char* line = "Accept-Encoding: gzip, deflate, br\r\nHost: x\r\n";
+    LineScan out;
+    bryant::ScanLine(line, strlen(line), out);
+    assert(out.end == 34 && out.colon == 15);
+
+    const char* request = "GET /judge.html HTTP/1.1\r\n";
+    bryant::ScanLine(request, strlen(request), out);
+    assert(out.end == 24 && out.colon == LineScan::npos);
+
+    const char* open = "Cookie: aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+    bryant::ScanLine(open, strlen(open), out);
+    assert(out.end == strlen(open) && out.colon == 6);
+
+    for(ScanImpl impl : impls){
+        if(bryant::SetScanImpl(impl)){
+            check_all(line, strlen(line));
+            check_all(open, strlen(open));
+        }
+    }
+    printf("header: ok\n");
+}
+
+
+// 随机输入，覆盖行尾/':'出现在块边界、尾部不足一个块等情况
+void test_random(){
+    const char alphabet[] = "abcdefghij:\r\n-";
+    char buf[256];
+    srand(2024);
+    for(int round = 0; round < 200000; ++round){
+        size_t len = rand() % sizeof(buf);
+        int sparse = rand() % 64 + 1; // 控制特殊字符的密度，让它们落在不同的块里
+        for(size_t i = 0; i < len; ++i){
+            buf[i] = (rand() % sparse == 0) ? alphabet[10 + rand() % 3] : alphabet[rand() % 10];
+        }
+        check_all(buf, len);
+    }
+    printf("random: ok\n");
+}
+
+
+int main(){
+    printf("default impl: %s\n", bryant::ScanImplName(bryant::GetScanImpl()));
+    ScanImpl impl = bryant::GetScanImpl();
+    test_header();
+    test_random();
+    bryant::SetScanImpl(impl);
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "util/object_pool.hh"
+#include "fiberLibrary/thread.hh"
+
+using bryant::ObjectPool;
+
+static int s_alive = 0; // 存活的Item数
+
+
+struct Item {
+    explicit Item(int v = 0) : value(v) {++s_alive;}
+    ~Item() {--s_alive;}
+
+    int value;
+    std::string name;
+    char pad[3000];     // 与http_conn的量级相当
+};
+
+
+// 构造/析构与slab的按需分配
+void test_alloc(){
+    ObjectPool<Item, 4> pool;
+    assert(pool.slabs() == 0);
+
+    std::vector<Item*> items;
+    std::set<Item*> addrs;
+    for(int i = 0; i < 10; ++i){
+        Item* item = pool.create(i);
+        assert(item->value == i);
+        assert(((uintptr_t)item & (alignof(Item) - 1)) == 0);
+        item->name = "item" + std::to_string(i);
+        items.push_back(item);
+        addrs.insert(item);
+    }
+    assert(addrs.size() == 10);
+    assert(s_alive == 10 && pool.live() == 10 && pool.slabs() == 3);
+
+    // 归还的位置被复用
+    Item* last = items.back();
+    items.pop_back();
+    pool.destroy(last);
+    assert(s_alive == 9);
+    Item* again = pool.create(42);
+    assert(again == last && again->value == 42 && again->name.empty());
+    items.push_back(again);
+
+    for(Item* item : items){
+        pool.destroy(item);
+    }
+    assert(s_alive == 0 && pool.live() == 0);
+    assert(pool.slabs() == 1); // 只保留一个空slab
+    printf("alloc: ok\n");
+}
+
+
+// 内存随存活对象数增减
+void test_shrink(){
+    ObjectPool<Item> pool;
+    std::vector<Item*> items;
+    for(int i = 0; i < 1000; ++i){
+        items.push_back(pool.create());
+    }
+    size_t peak = pool.slabs();
+    assert(peak == (1000 + 15) / 16);
+
+    // 只留下每个slab的第一个对象, slab数不变
+    std::vector<Item*> kept;
+    for(size_t i = 0; i < items.size(); ++i){
+        if(i % 16 == 0){
+            kept.push_back(items[i]);
+        }
+        else{
+            pool.destroy(items[i]);
+        }
+    }
+    assert(pool.slabs() == peak);
+
+    // 新对象优先填进已有的slab
+    std::vector<Item*> refill;
+    for(int i = 0; i < 500; ++i){
+        refill.push_back(pool.create());
+    }
+    assert(pool.slabs() == peak);
+
+    for(Item* item : refill){
+        pool.destroy(item);
+    }
+    for(Item* item : kept){
+        pool.destroy(item);
+    }
+    assert(pool.slabs() == 1 && pool.live() == 0);
+    printf("shrink: ok\n");
+}
+
+
+// unique_ptr离开作用域时归还
+void test_ptr(){
+    ObjectPool<Item> pool;
+    {
+        ObjectPool<Item>::ptr a = pool.make(1);
+        ObjectPool<Item>::ptr b = pool.make(2);
+        assert(a->value == 1 && b->value == 2 && pool.live() == 2);
+        b.reset();
+        assert(pool.live() == 1);
+    }
+    assert(pool.live() == 0 && s_alive == 0);
+    printf("ptr: ok\n");
+}
+
+
+// 多线程并发分配和归还
+static ObjectPool<Item> s_pool;
+
+void worker(){
+    std::vector<Item*> items;
+    for(int round = 0; round < 200; ++round){
+        for(int i = 0; i < 50; ++i){
+            items.push_back(s_pool.create(round));
+        }
+        for(Item* item : items){
+            assert(item->value == round);
+            s_pool.destroy(item);
+        }
+        items.clear();
+    }
+}
+
+void test_threads(){
+    std::vector<bryant::Thread::ptr> threads;
+    for(int i = 0; i < 4; ++i){
+        threads.push_back(std::make_shared<bryant::Thread>(worker, "pool_" + std::to_string(i)));
+    }
+    for(auto& thread : threads){
+        thread->join();
+    }
+    assert(s_pool.live() == 0 && s_pool.slabs() == 1);
+    printf("threads: ok\n");
+}
+
+
+int main(){
+    test_alloc();
+    test_shrink();
+    test_ptr();
+    test_threads();
+    return 0;
+}
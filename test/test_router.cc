@@ -0,0 +1,109 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string>
+
+#include "server/router.hh"
+
+using bryant::Router;
+using bryant::HttpRequest;
+using bryant::HttpResponse;
+
+
+// 处理函数把名字写进resp.file，用来区分匹配到了哪个路由
+static Router::Handler named(const char* name){
+    return [name](const HttpRequest&, HttpResponse& resp) {
+        resp.file = name;
+    };
+}
+
+
+// 查找path，返回匹配到的处理函数名，没有匹配返回""
+static std::string lookup(Router& router, uint32_t method, const char* path, HttpRequest& req){
+    req.path = path;
+    const Router::Handler* handler = nullptr;
+    if(router.route(method, req, handler) != Router::MATCHED){
+        return "";
+    }
+    HttpResponse resp;
+    (*handler)(req, resp);
+    return std::string(resp.file);
+}
+
+
+// 静态路径精确匹配，"/"与"/0"、前缀与多一段都不混淆
+void test_static(){
+    Router router;
+    assert(router.addRoute(bryant::ROUTE_GET, "/", named("root")));
+    assert(router.addRoute(bryant::ROUTE_GET | bryant::ROUTE_POST, "/0", named("zero")));
+    assert(router.addRoute(bryant::ROUTE_GET, "/a/b", named("ab")));
+
+    HttpRequest req;
+    assert(lookup(router, bryant::ROUTE_GET, "/", req) == "root");
+    assert(lookup(router, bryant::ROUTE_POST, "/0", req) == "zero");
+    assert(lookup(router, bryant::ROUTE_GET, "/a/b", req) == "ab");
+    assert(lookup(router, bryant::ROUTE_GET, "/0xyz", req) == "");
+    assert(lookup(router, bryant::ROUTE_GET, "/a", req) == "");
+    assert(lookup(router, bryant::ROUTE_GET, "/a/b/c", req) == "");
+    assert(lookup(router, bryant::ROUTE_GET, "/a/b/", req) == "");
+    assert(lookup(router, bryant::ROUTE_GET, "", req) == "");
+    assert(lookup(router, bryant::ROUTE_GET, "a/b", req) == "");
+    printf("static: ok\n");
+}
+
+
+// 路径存在但方法不匹配时返回允许的方法
+void test_method(){
+    Router router;
+    assert(router.addRoute(bryant::ROUTE_GET, "/login", named("get")));
+    assert(router.addRoute(bryant::ROUTE_POST, "/login", named("post")));
+    assert(!router.addRoute(bryant::ROUTE_POST, "/login", named("dup")));
+    assert(router.addRoute(bryant::ROUTE_POST, "/submit", named("submit")));
+
+    HttpRequest req;
+    assert(lookup(router, bryant::ROUTE_GET, "/login", req) == "get");
+    assert(lookup(router, bryant::ROUTE_POST, "/login", req) == "post");
+
+    req.path = "/submit";
+    const Router::Handler* handler = nullptr;
+    uint32_t allow = 0;
+    assert(router.route(bryant::ROUTE_GET, req, handler, &allow) == Router::METHOD_NOT_ALLOWED);
+    assert(handler == nullptr && allow == bryant::ROUTE_POST);
+    req.path = "/nothing";
+    assert(router.route(bryant::ROUTE_GET, req, handler, &allow) == Router::NOT_FOUND);
+    printf("method: ok\n");
+}
+
+
+// 参数段和通配段，静态段优先，不匹配时回退
+void test_params(){
+    Router router;
+    assert(router.addRoute(bryant::ROUTE_GET, "/user/:id", named("user")));
+    assert(router.addRoute(bryant::ROUTE_GET, "/user/me", named("me")));
+    assert(router.addRoute(bryant::ROUTE_GET, "/user/:id/posts/:post", named("post")));
+    assert(router.addRoute(bryant::ROUTE_GET, "/static/*path", named("static")));
+    assert(!router.addRoute(bryant::ROUTE_GET, "/user/:name/x", named("conflict")));
+    assert(!router.addRoute(bryant::ROUTE_GET, "/bad/*rest/x", named("bad")));
+    assert(!router.addRoute(bryant::ROUTE_GET, "/bad/:", named("bad")));
+
+    HttpRequest req;
+    assert(lookup(router, bryant::ROUTE_GET, "/user/me", req) == "me");
+    assert(req.param_count == 0);
+    assert(lookup(router, bryant::ROUTE_GET, "/user/42", req) == "user");
+    assert(req.param("id") == "42");
+    assert(lookup(router, bryant::ROUTE_GET, "/user/me/posts/7", req) == "post");
+    assert(req.param_count == 2 && req.param("id") == "me" && req.param("post") == "7");
+    assert(lookup(router, bryant::ROUTE_GET, "/user/", req) == "");
+    assert(lookup(router, bryant::ROUTE_GET, "/user/42/posts", req) == "");
+    assert(lookup(router, bryant::ROUTE_GET, "/static/img/a.png", req) == "static");
+    assert(req.param("path") == "img/a.png");
+    assert(req.param("missing").empty());
+    printf("params: ok\n");
+}
+
+
+int main(){
+    test_static();
+    test_method();
+    test_params();
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <string_view>
+
+#include "server/user_snapshot.hh"
+#include "server/user_store.hh"
+
+using bryant::UserSnapshot;
+using bryant::UserSnapshotWriter;
+using bryant::UserStore;
+
+static const char PATH[] = "test_user_snapshot.snap";
+
+
+static std::string name_of(int i){
+    return "user" + std::to_string(i);
+}
+
+static std::string password_of(int i){
+    return "pwd" + std::to_string(i * 7);
+}
+
+
+// 写n个用户(id从1开始), 返回是否成功
+static bool write_snapshot(int n){
+    UserSnapshotWriter writer;
+    if(!writer.open(PATH)){
+        return false;
+    }
+    for(int i = 0; i < n; ++i){
+        writer.append(name_of(i), password_of(i), i + 1);
+    }
+    return writer.commit();
+}
+
+
+// 写入后映射, 所有用户都能查到, 其他的查不到
+void test_basic(){
+    const int N = 100000;
+    // 上次留下的临时文件权限更宽, 写出来的快照仍是0600
+    std::string tmp_path = std::string(PATH) + ".tmp";
+    fclose(fopen(tmp_path.c_str(), "w"));
+    assert(chmod(tmp_path.c_str(), 0644) == 0);
+    assert(write_snapshot(N));
+    UserSnapshot snapshot;
+    assert(snapshot.open(PATH));
+    assert(snapshot.size() == N);
+    assert(snapshot.high_water() == N && snapshot.high_water_name() == name_of(N - 1));
+
+    // 快照里有明文密码, 只有属主能读写
+    struct stat st;
+    assert(stat(PATH, &st) == 0 && (st.st_mode & 0777) == 0600);
+
+    std::string_view password;
+    for(int i = 0; i < N; ++i){
+        assert(snapshot.find(name_of(i), &password) && password == password_of(i));
+    }
+    for(int i = N; i < N * 2; ++i){
+        assert(!snapshot.find(name_of(i)));
+    }
+    assert(!snapshot.find("") && !snapshot.find("user"));
+
+    int count = 0;
+    snapshot.foreach([&count](std::string_view name, std::string_view password){
+        assert(name == name_of(count) && password == password_of(count));
+        ++count;
+    });
+    assert(count == N);
+
+    // 空快照: 没有用户, high_water为0
+    assert(write_snapshot(0));
+    UserSnapshot empty;
+    assert(empty.open(PATH) && empty.size() == 0 && empty.high_water() == 0);
+    assert(empty.high_water_name().empty() && !empty.find(name_of(0)));
+
+    // 重写文件不影响已经映射的旧快照
+    assert(snapshot.find(name_of(N - 1), &password) && password == password_of(N - 1));
+    printf("basic: ok\n");
+}
+
+
+// 不存在、截断、版本不对的文件都不能打开
+void test_invalid(){
+    assert(!UserSnapshot().open("no_such_file.snap"));
+
+    assert(write_snapshot(1000));
+    assert(truncate(PATH, sizeof(UserSnapshot::Header) + 100) == 0);
+    assert(!UserSnapshot().open(PATH));
+
+    assert(write_snapshot(1000));
+    FILE* file = fopen(PATH, "r+b");
+    uint32_t version = UserSnapshot::VERSION + 1;
+    fseek(file, offsetof(UserSnapshot::Header, version), SEEK_SET);
+    fwrite(&version, sizeof(version), 1, file);
+    fclose(file);
+    assert(!UserSnapshot().open(PATH));
+
+    // 写到一半放弃, 正式文件不变
+    assert(write_snapshot(10));
+    UserSnapshotWriter writer;
+    assert(writer.open(PATH));
+    writer.append("someone", "pwd", 100);
+    writer.abort();
+    UserSnapshot snapshot;
+    assert(snapshot.open(PATH) && snapshot.size() == 10);
+    assert(access((std::string(PATH) + ".tmp").c_str(), F_OK) != 0);
+    printf("invalid: ok\n");
+}
+
+
+// 挂在UserStore底层: 快照里的用户能查到、不能重复注册; 覆盖和删除只作用于内存表
+void test_store(){
+    const int N = 1000;
+    assert(write_snapshot(N));
+    UserSnapshot snapshot;
+    assert(snapshot.open(PATH));
+
+    UserStore store;
+    store.attach(&snapshot);
+    assert(store.size() == N);
+    for(int i = 0; i < N; ++i){
+        assert(store.check(name_of(i), password_of(i)));
+        assert(!store.check(name_of(i), "wrong"));
+        assert(!store.insert(name_of(i), "other"));
+    }
+    std::string password;
+    assert(store.find(name_of(1), &password) && password == password_of(1));
+
+    assert(store.insert(name_of(N), password_of(N)));
+    assert(store.check(name_of(N), password_of(N)) && store.size() == N + 1);
+
+    store.set(name_of(0), "new");
+    assert(store.check(name_of(0), "new") && !store.check(name_of(0), password_of(0)));
+    assert(store.erase(name_of(0)));
+    assert(store.check(name_of(0), password_of(0)));   // 删掉内存表里的覆盖, 又看到快照里的
+    assert(!store.erase(name_of(1)));
+
+    store.clear();
+    assert(store.size() == 0 && !store.find(name_of(1)));
+    printf("store: ok\n");
+}
+
+
+int main(){
+    test_basic();
+    test_invalid();
+    test_store();
+    unlink(PATH);
+    return 0;
+}
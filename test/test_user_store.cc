@@ -0,0 +1,134 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "server/user_store.hh"
+#include "fiberLibrary/thread.hh"
+
+using bryant::UserStore;
+
+
+static std::string name_of(int i){
+    return "user" + std::to_string(i);
+}
+
+static std::string password_of(int i, int version = 0){
+    return "pwd" + std::to_string(i * 7 + version);
+}
+
+
+// 插入、覆盖、删除与扩容
+void test_basic(){
+    UserStore store;
+    assert(!store.find("nobody"));
+    assert(store.insert("alice", "123"));
+    assert(!store.insert("alice", "456"));  // 已存在时不修改
+    assert(store.check("alice", "123") && !store.check("alice", "456"));
+    assert(!store.check("alic", "123") && !store.check("alice", "12"));
+
+    store.set("alice", "789");
+    std::string password;
+    assert(store.find("alice", &password) && password == "789");
+
+    // 空用户名/空密码也是合法的键值
+    assert(store.insert("", ""));
+    assert(store.check("", ""));
+
+    // 足够多的用户, 每个分片都会扩容多次
+    for(int i = 0; i < 100000; ++i){
+        assert(store.insert(name_of(i), password_of(i)));
+    }
+    assert(store.size() == 100002);
+    for(int i = 0; i < 100000; ++i){
+        assert(store.check(name_of(i), password_of(i)));
+    }
+
+    // 删除后可以重新注册, 墓碑不影响其他用户的查找
+    for(int i = 0; i < 100000; i += 2){
+        assert(store.erase(name_of(i)));
+    }
+    assert(!store.erase(name_of(0)));
+    assert(store.size() == 50002);
+    for(int i = 0; i < 100000; ++i){
+        assert(store.find(name_of(i)) == (i % 2 == 1));
+    }
+    for(int i = 0; i < 100000; i += 2){
+        assert(store.insert(name_of(i), password_of(i, 1)));
+    }
+    for(int i = 0; i < 100000; ++i){
+        assert(store.check(name_of(i), password_of(i, i % 2 == 0)));
+    }
+
+    store.clear();
+    assert(store.size() == 0 && !store.find("alice"));
+    assert(store.insert("alice", "123"));
+    printf("basic: ok\n");
+}
+
+
+// 反复插入后删除(注册失败回滚)和覆盖: 退役的条目和清理墓碑换下的旧表随纪元推进释放, 不会一直增长
+void test_reclaim(){
+    UserStore store;
+    for(int i = 0; i < 1000000; ++i){
+        assert(store.insert(name_of(i % 1000), password_of(i)));
+        store.set(name_of(i % 1000), password_of(i, 1));
+        assert(store.erase(name_of(i % 1000)));
+    }
+    assert(store.size() == 0);
+    printf("reclaim: ok, %zu retired\n", store.retired());
+    assert(store.retired() <= UserStore::SHARDS * 4);
+}
+
+
+// 读者不加锁: 写者持续插入(触发扩容)、覆盖和删除时, 读者看到的已有用户始终完整正确
+static UserStore s_store;
+static const int PRELOADED = 20000;
+
+void reader(){
+    for(int round = 0; round < 20; ++round){
+        for(int i = 0; i < PRELOADED; ++i){
+            std::string password;
+            assert(s_store.find(name_of(i), &password));
+            assert(password == password_of(i) || password == password_of(i, 1));
+        }
+    }
+}
+
+void writer(){
+    for(int i = PRELOADED; i < PRELOADED * 5; ++i){
+        assert(s_store.insert(name_of(i), password_of(i)));
+        if(i % 3 == 0){
+            s_store.set(name_of(i % PRELOADED), password_of(i % PRELOADED, 1));
+        }
+        if(i % 5 == 0){
+            assert(s_store.erase(name_of(i)));
+        }
+    }
+}
+
+void test_threads(){
+    for(int i = 0; i < PRELOADED; ++i){
+        s_store.insert(name_of(i), password_of(i));
+    }
+
+    std::vector<bryant::Thread::ptr> threads;
+    for(int i = 0; i < 4; ++i){
+        threads.push_back(std::make_shared<bryant::Thread>(reader, "reader_" + std::to_string(i)));
+    }
+    threads.push_back(std::make_shared<bryant::Thread>(writer, "writer"));
+    for(auto& thread : threads){
+        thread->join();
+    }
+
+    assert(s_store.size() == (size_t)(PRELOADED * 5 - PRELOADED * 4 / 5));
+    printf("threads: ok\n");
+}
+
+
+int main(){
+    test_basic();
+    test_reclaim();
+    test_threads();
+    return 0;
+}
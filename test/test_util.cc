@@ -0,0 +1,59 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "util/util.hh"
+
+
+// 与strftime的结果一致，覆盖闰年、世纪年和月末
+void test_http_date(){
+    char buf[32], expect[32];
+    for(long i = 0; i < 200000; ++i){
+        time_t t = (i < 100000) ? (time_t)i * 43913 : (time_t)(rand() % 4000000000u);
+        size_t n = bryant::FormatHttpDate(t, buf, sizeof(buf));
+        buf[n] = '\0';
+
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        strftime(expect, sizeof(expect), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        assert(n == 29 && strcmp(buf, expect) == 0);
+    }
+    assert(bryant::FormatHttpDate(0, buf, 16) == 0);
+
+    const char* date = bryant::GetCachedHttpDate();
+    assert(strlen(date) == 29 && strcmp(date + 25, " GMT") == 0);
+    printf("http date: ok\n");
+}
+
+
+// 与printf的结果一致
+void test_format_int(){
+    char buf[32], expect[32];
+    for(long i = 0; i < 200000; ++i){
+        uint64_t v = (((uint64_t)rand() << 32) | rand()) >> (i % 64);
+        size_t n = bryant::FormatUint(v, buf);
+        buf[n] = '\0';
+        snprintf(expect, sizeof(expect), "%llu", (unsigned long long)v);
+        assert(strcmp(buf, expect) == 0);
+
+        n = bryant::FormatHex(v, buf);
+        buf[n] = '\0';
+        snprintf(expect, sizeof(expect), "%llx", (unsigned long long)v);
+        assert(strcmp(buf, expect) == 0);
+    }
+
+    size_t n = bryant::FormatUint(UINT64_MAX, buf);
+    assert(n == 20 && memcmp(buf, "18446744073709551615", 20) == 0);
+    n = bryant::FormatUint(0, buf);
+    assert(n == 1 && buf[0] == '0');
+    printf("format int: ok\n");
+}
+
+
+int main(){
+    test_http_date();
+    test_format_int();
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "util/util.hh"
+#include "util/ws_codec.hh"
+#include "server/websocket.hh"
+
+using bryant::ScanImpl;
+
+const ScanImpl impls[] = {ScanImpl::SCALAR, ScanImpl::SSE42, ScanImpl::AVX2};
+
+
+static std::string to_hex(const uint8_t* data, size_t len){
+    std::string out;
+    char buf[3];
+    for(size_t i = 0; i < len; ++i){
+        snprintf(buf, sizeof(buf), "%02x", data[i]);
+        out += buf;
+    }
+    return out;
+}
+
+
+static std::string sha1_hex(const std::string& text){
+    uint8_t digest[20];
+    bryant::Sha1(text.data(), text.size(), digest);
+    return to_hex(digest, sizeof(digest));
+}
+
+
+// FIPS 180 的测试向量
+void test_sha1(){
+    assert(sha1_hex("") == "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+    assert(sha1_hex("abc") == "a9993e364706816aba3e25717850c26c9cd0d89d");
+    assert(sha1_hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")
+            == "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+    assert(sha1_hex(std::string(1000000, 'a')) == "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+    printf("sha1: ok\n");
+}
+
+
+// RFC 4648 的测试向量, 以及RFC 6455 1.3节握手的例子
+void test_base64(){
+    const char* cases[][2] = {
+        {"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"},
+        {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"},
+    };
+    for(auto& c : cases){
+        std::string out;
+        bryant::Base64Encode(c[0], strlen(c[0]), out);
+        assert(out == c[1]);
+        std::string back;
+        assert(bryant::Base64Decode(out, back) && back == c[0]);
+    }
+
+    std::string accept;
+    bryant::WebSocket::AcceptKey("dGhlIHNhbXBsZSBub25jZQ==", accept);
+    assert(accept == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+    printf("base64: ok\n");
+}
+
+
+// 各实现、各起始偏移的掩码结果必须与逐字节异或一致, 且两次异或还原
+void test_mask(){
+    const uint8_t key[4] = {0x37, 0xfa, 0x21, 0x3d};
+    std::string data(1000, 0);
+    for(size_t i = 0; i < data.size(); ++i){
+        data[i] = (char)rand();
+    }
+
+    for(ScanImpl impl : impls){
+        if(!bryant::SetWsCodecImpl(impl)){
+            continue;
+        }
+        for(size_t len : {0, 1, 3, 15, 16, 17, 31, 32, 33, 100, 1000}){
+            for(size_t offset = 0; offset < 4; ++offset){
+                std::string buf = data.substr(0, len);
+                bryant::WsMask(&buf[0], len, key, offset);
+                for(size_t i = 0; i < len; ++i){
+                    assert((uint8_t)buf[i] == ((uint8_t)data[i] ^ key[(offset + i) & 3]));
+                }
+                bryant::WsMask(&buf[0], len, key, offset);
+                assert(buf == data.substr(0, len));
+            }
+        }
+    }
+
+    // 拆成两段处理与整段处理相同
+    std::string whole = data, parts = data;
+    bryant::WsMask(&whole[0], whole.size(), key);
+    bryant::WsMask(&parts[0], 333, key);
+    bryant::WsMask(&parts[333], parts.size() - 333, key, 333);
+    assert(whole == parts);
+    printf("mask: ok\n");
+}
+
+
+// 已知的合法/非法序列, 以及随机数据上各实现与逐字节实现一致
+void test_utf8(){
+    const char* valid[] = {
+        "", "hello", "\xc2\xa9", "\xe4\xbd\xa0\xe5\xa5\xbd", "\xf0\x9f\x98\x80",
+        "\xed\x9f\xbf", "\xee\x80\x80", "\xf4\x8f\xbf\xbf",
+        "Hello-\xc2\xb5@\xc3\x9f\xc3\xb6\xc3\xa4\xc3\xbc\xc3\xa0\xc3\xa1-UTF-8!!",
+    };
+    const char* invalid[] = {
+        "\x80", "\xc0\xaf", "\xc1\xbf", "\xe0\x80\xaf", "\xed\xa0\x80", "\xed\xbf\xbf",
+        "\xf0\x80\x80\xaf", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80", "\xff",
+        "\xc2", "\xe4\xbd", "\xf0\x9f\x98", "abc\xc2", "\xce\xba\xe1\xbd\xb9\xcf\x83\xce\xbc\xce\xb5\xed\xa0\x80" "edited",
+    };
+
+    for(ScanImpl impl : impls){
+        if(!bryant::SetWsCodecImpl(impl)){
+            continue;
+        }
+        for(const char* s : valid){
+            // 放在不同的位置, 覆盖跨16/32字节块的情况
+            for(size_t pad = 0; pad < 40; pad += 13){
+                std::string text = std::string(pad, 'x') + s + std::string(pad, 'y');
+                assert(bryant::ValidateUtf8(text.data(), text.size()));
+            }
+        }
+        for(const char* s : invalid){
+            for(size_t pad = 0; pad < 40; pad += 13){
+                std::string text = std::string(pad, 'x') + s;
+                assert(!bryant::ValidateUtf8(text.data(), text.size()));
+                text += std::string(pad, 'y');
+                assert(!bryant::ValidateUtf8(text.data(), text.size()));
+            }
+        }
+    }
+
+    // 随机数据: 偏向ASCII和常见的多字节前缀, 让合法与非法都有一定比例
+    const char pool[] = {'a', 'z', ' ', '\x7f', '\xc2', '\xa9', '\xe4', '\xbd', '\xa0',
+                         '\xf0', '\x9f', '\x98', '\x80', '\xed', '\xbf', '\xf4', '\x8f'};
+    for(int round = 0; round < 20000; ++round){
+        std::string text(rand() % 80, 0);
+        for(char& c : text){
+            c = (rand() % 3) ? 'a' + rand() % 26 : pool[rand() % sizeof(pool)];
+        }
+        bryant::SetWsCodecImpl(ScanImpl::SCALAR);
+        bool expect = bryant::ValidateUtf8(text.data(), text.size());
+        for(ScanImpl impl : impls){
+            if(bryant::SetWsCodecImpl(impl)){
+                assert(bryant::ValidateUtf8(text.data(), text.size()) == expect);
+            }
+        }
+    }
+    printf("utf8: ok\n");
+}
+
+
+int main(){
+    test_sha1();
+    test_base64();
+    test_mask();
+    test_utf8();
+    return 0;
+}
@@ -18,11 +18,16 @@ Timer::Timer(uint64_t next)
 }
 
 
+// 取消时同时从m_timers里删除，频繁取消的定时器(挂起连接的空闲超时)不会堆积到超时才释放
 bool
 Timer::cancel(){
     m_manager->m_rwMutex.writeLock();
     if(m_cb){
         m_cb = nullptr;
+        auto it = m_manager->m_timers.find(shared_from_this());
+        if(it != m_manager->m_timers.end()){
+            m_manager->m_timers.erase(it);
+        }
         m_manager->m_rwMutex.unlock();
         return true;
     }
@@ -0,0 +1,178 @@
+#include <string.h>
+#include <algorithm>
+
+#include "chain_buffer.hh"
+
+namespace bryant{
+
+
+SlabPool*
+SlabPool::get_instance(){
+    static SlabPool pool;
+    return &pool;
+}
+
+
+SlabPool::~SlabPool(){
+    for(char* slab : m_free){
+        delete[] slab;
+    }
+}
+
+
+char*
+SlabPool::alloc(){
+    m_mutex.lock();
+    if(!m_free.empty()){
+        char* slab = m_free.back();
+        m_free.pop_back();
+        m_mutex.unlock();
+        return slab;
+    }
+    m_mutex.unlock();
+    return new char[SLAB_SIZE];
+}
+
+
+void
+SlabPool::dealloc(char* slab){
+    m_mutex.lock();
+    if(m_free.size() < MAX_FREE_SLABS){
+        m_free.push_back(slab);
+        slab = nullptr;
+    }
+    m_mutex.unlock();
+    delete[] slab;
+}
+
+
+size_t
+SlabPool::idle(){
+    m_mutex.lock();
+    size_t n = m_free.size();
+    m_mutex.unlock();
+    return n;
+}
+
+
+ChainBuffer::ChainBuffer(size_t max_size)
+    :m_max_size(max_size < SlabPool::SLAB_SIZE ? SlabPool::SLAB_SIZE : max_size){
+}
+
+
+ChainBuffer::~ChainBuffer(){
+    release();
+}
+
+
+ChainBuffer::Block
+ChainBuffer::newBlock(size_t cap){
+    Block block;
+    if(cap <= SlabPool::SLAB_SIZE){
+        block.data = SlabPool::get_instance()->alloc();
+        block.cap = SlabPool::SLAB_SIZE;
+    }
+    else{
+        block.data = new char[cap];
+        block.cap = cap;
+    }
+    block.len = 0;
+    m_footprint += block.cap;
+    return block;
+}
+
+
+void
+ChainBuffer::freeBlock(const Block& block){
+    m_footprint -= block.cap;
+    if(block.cap == SlabPool::SLAB_SIZE){
+        SlabPool::get_instance()->dealloc(block.data);
+    }
+    else{
+        delete[] block.data;
+    }
+}
+
+
+long
+ChainBuffer::reserve(size_t keep_from, size_t need){
+    if(m_blocks.empty()){
+        m_blocks.push_back(newBlock(need));
+        return 0;
+    }
+
+    size_t keep = size() - keep_from;
+    if(need < keep + 1){
+        need = keep + 1;
+    }
+    if(keep_from + need <= capacity()){
+        return 0;
+    }
+
+    // step1: 半行数据按两倍增长, 请求体一次申请够, 按slab大小取整
+    size_t cap = std::max(keep * 2, need);
+    cap = (cap + SlabPool::SLAB_SIZE - 1) / SlabPool::SLAB_SIZE * SlabPool::SLAB_SIZE;
+
+    // step2: keep_from之前没有数据时, 没有指针指向tail, 可以直接替换
+    bool replace = (keep_from == 0);
+    size_t footprint = m_footprint + cap - (replace ? capacity() : 0);
+    if(footprint > m_max_size){
+        return -1;
+    }
+
+    // step3: 搬移未解析完的数据
+    Block tail = m_blocks.back();
+    Block block = newBlock(cap);
+    memcpy(block.data, tail.data + keep_from, keep);
+    block.len = keep;
+    if(replace){
+        freeBlock(tail);
+        m_blocks.back() = block;
+    }
+    else{
+        m_blocks.back().len = keep_from;
+        m_blocks.push_back(block);
+    }
+    return keep_from;
+}
+
+
+void
+ChainBuffer::consume(size_t n){
+    if(m_blocks.empty()){
+        return;
+    }
+
+    Block tail = m_blocks.back();
+    m_blocks.pop_back();
+    for(const Block& block : m_blocks){
+        freeBlock(block);
+    }
+    m_blocks.clear();
+
+    // 之前为大请求分配的块，剩余数据放得进slab时换回slab
+    size_t left = tail.len - n;
+    if(tail.cap > SlabPool::SLAB_SIZE && left <= SlabPool::SLAB_SIZE){
+        Block block = newBlock(SlabPool::SLAB_SIZE);
+        memcpy(block.data, tail.data + n, left);
+        block.len = left;
+        freeBlock(tail);
+        tail = block;
+    }
+    else if(n > 0){
+        memmove(tail.data, tail.data + n, left);
+        tail.len = left;
+    }
+    m_blocks.push_back(tail);
+}
+
+
+void
+ChainBuffer::release(){
+    for(const Block& block : m_blocks){
+        freeBlock(block);
+    }
+    m_blocks.clear();
+}
+
+} // namespace bryant
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include "locker.hh"
+
+namespace bryant{
+
+// 固定大小内存块(slab)的全局池，所有IOManager工作线程共享
+// 连接关闭时读缓冲区的slab归还到这里，新连接直接复用，避免反复new/delete
+class SlabPool {
+public:
+    static const size_t SLAB_SIZE = 2048;      // 单个slab的大小, 与原来的读缓冲区一致
+    static const size_t MAX_FREE_SLABS = 4096; // 最多保留的空闲slab数, 超出的直接释放
+
+    /**
+     * @brief Get the instance
+     *
+     * @return SlabPool*
+     */
+    static SlabPool* get_instance();
+
+    /**
+     * @brief 取一个slab
+     */
+    char* alloc();
+
+    /**
+     * @brief 归还一个slab
+     */
+    void dealloc(char* slab);
+
+    /**
+     * @brief 当前空闲的slab数
+     */
+    size_t idle();
+
+private:
+    SlabPool() = default;
+    ~SlabPool();
+
+private:
+    Mutex m_mutex;
+    std::vector<char*> m_free;  // 空闲slab
+};
+
+
+// 由slab串起来的链式读缓冲区
+// 数据总是写在最后一块(tail)里，解析也在tail上进行；
+// tail写满时，把还没解析完的数据(半行请求头或请求体)搬到新的块里继续读，
+// 前面的块原样保留，已经解析出的指针(url、host等)在请求处理完之前一直有效。
+// 普通请求只占用一个slab，只有请求行/请求头/请求体超过slab时才增长，
+// 超过slab大小的块直接分配，请求处理完后换回slab。
+class ChainBuffer {
+public:
+    /**
+     * @brief Construct a new Chain Buffer object
+     *
+     * @param max_size 一个请求最多占用的总字节数
+     */
+    explicit ChainBuffer(size_t max_size = 64 * 1024);
+    ~ChainBuffer();
+
+    ChainBuffer(const ChainBuffer&) = delete;
+    ChainBuffer& operator=(const ChainBuffer&) = delete;
+
+    /**
+     * @brief tail块的起始地址, 还没分配时为nullptr
+     */
+    char* data() const {return m_blocks.empty() ? nullptr : m_blocks.back().data;}
+
+    /**
+     * @brief tail块中已有的数据字节数
+     */
+    size_t size() const {return m_blocks.empty() ? 0 : m_blocks.back().len;}
+
+    /**
+     * @brief tail块的容量
+     */
+    size_t capacity() const {return m_blocks.empty() ? 0 : m_blocks.back().cap;}
+
+    /**
+     * @brief tail块的剩余空间
+     */
+    size_t writable() const {return capacity() - size();}
+
+    /**
+     * @brief 所有块占用的总字节数
+     */
+    size_t footprint() const {return m_footprint;}
+
+    /**
+     * @brief 块数
+     */
+    size_t blocks() const {return m_blocks.size();}
+
+    /**
+     * @brief 保证tail块从keep_from开始能连续放下need字节, 且至少还有1字节可写
+     * @details 放不下时把tail中[keep_from, size)搬到新块的开头, 之前的块保留;
+     *          keep_from为0时tail里没有其他数据被引用, 新块直接替换tail
+     *
+     * @param keep_from 需要保持连续的数据在tail中的起始位置
+     * @param need 需要连续存放的字节数(例如完整的请求体)
+     * @return long 数据搬移的偏移量(搬移后位置 = 原位置 - 返回值), 超过总字节数上限返回-1
+     */
+    long reserve(size_t keep_from, size_t need = 0);
+
+    /**
+     * @brief 向tail块写入n字节后调用
+     */
+    void commit(size_t n) {m_blocks.back().len += n;}
+
+    /**
+     * @brief 丢弃tail前n字节以及之前所有的块, 剩余数据移到开头
+     * @details 只能在请求边界调用，此时不再有指针指向这些数据
+     *
+     * @param n
+     */
+    void consume(size_t n);
+
+    /**
+     * @brief 释放所有块, slab归还到池中
+     */
+    void release();
+
+private:
+    struct Block {
+        char* data;     // 块地址
+        size_t cap;     // 容量
+        size_t len;     // 已写入字节数
+    };
+
+    /**
+     * @brief 分配一个至少cap字节的块
+     */
+    Block newBlock(size_t cap);
+
+    /**
+     * @brief 释放块
+     */
+    void freeBlock(const Block& block);
+
+private:
+    std::vector<Block> m_blocks;    // 最后一块为tail
+    size_t m_max_size;              // 总字节数上限
+    size_t m_footprint = 0;         // 当前总字节数
+};
+
+} // namespace bryant
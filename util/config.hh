@@ -35,6 +35,36 @@ public:
 
     bool get_linger() const {return m_linger;}
 
+    bool get_sendfile() const {return m_sendfile;}
+
+    bool get_idle_park() const {return m_idle_park;}
+
+    int get_file_cache_num() const {return m_file_cache_num;}
+
+    int get_file_cache_size() const {return m_file_cache_size;}
+
+    int get_file_cache_ttl() const {return m_file_cache_ttl;}
+
+    int get_response_cache_size() const {return m_response_cache_size;}
+
+    int get_response_cache_body() const {return m_response_cache_body;}
+
+    bool get_response_cache_stats() const {return m_response_cache_stats;}
+
+    const std::string& get_cache_control() const {return m_cache_control;}
+
+    int get_compress_cache_size() const {return m_compress_cache_size;}
+
+    int get_compress_min_size() const {return m_compress_min_size;}
+
+    int get_compress_level() const {return m_compress_level;}
+
+    int get_write_behind() const {return m_write_behind;}
+
+    int get_user_mode() const {return m_user_mode;}
+
+    const std::string& get_user_snapshot() const {return m_user_snapshot;}
+
 private:
     Config();
 
@@ -47,6 +77,21 @@ private:
     int m_epoll_trig_mode;
     int m_port;
     bool m_linger;
+    bool m_sendfile;
+    bool m_idle_park;
+    int m_file_cache_num;
+    int m_file_cache_size;
+    int m_file_cache_ttl;
+    int m_response_cache_size;
+    int m_response_cache_body;
+    bool m_response_cache_stats;
+    std::string m_cache_control;
+    int m_compress_cache_size;
+    int m_compress_min_size;
+    int m_compress_level;
+    int m_write_behind;
+    int m_user_mode;
+    std::string m_user_snapshot;
 };
 
 
@@ -67,13 +112,56 @@ Config::Config(){
 
     // 是否长连接
     m_linger = true;
+
+    // 静态文件发送方式
+    // 0-mmap+writev 1-sendfile零拷贝
+    m_sendfile = false;
+
+    // 长连接空闲时是否挂起
+    // 1-缓冲区和协程归还，下一次可读时重新创建 0-协程阻塞在读上等待
+    m_idle_park = true;
+
+    // 打开文件缓存
+    // 缓存文件数(0为关闭)、总大小(MB)、有效期(ms)
+    m_file_cache_num = 256;
+    m_file_cache_size = 256;
+    m_file_cache_ttl = 2000;
+
+    // 响应缓存
+    // 总大小(KB, 0为关闭)、可缓存文件大小上限(B)、是否统计命中率
+    m_response_cache_size = 4096;
+    m_response_cache_body = 8192;
+    m_response_cache_stats = true;
+
+    // 静态资源的Cache-Control: max-age(秒)
+    // 扩展名=秒数，逗号分隔，*为默认值
+    m_cache_control = "html=0,gif=86400,jpg=86400,jpeg=86400,png=86400,mp4=86400,ico=86400";
+
+    // 文本类型的后台gzip压缩缓存
+    // 总大小(KB, 0为关闭)、最小压缩大小(B)、压缩级别
+    m_compress_cache_size = 4096;
+    m_compress_min_size = 256;
+    m_compress_level = 6;
+
+    // 注册用户写入数据库的方式
+    // 0-逐条同步写入 1-批量写入并等待落库 2-批量写入不等待
+    m_write_behind = 1;
+
+    // 用户表的加载方式
+    // 0-整张表加载进内存 1-只加载用户名到Bloom filter, 密码登录时按需查库
+    // 按自增主键id分页读; 没有id列时按用户名分页, 这时username上要有索引, 否则每页都要全表扫描
+    m_user_mode = 0;
+
+    // 用户表快照文件(只在整张表加载进内存时使用), 为空时不用快照
+    // 需要user表有自增主键id: ALTER TABLE user ADD id BIGINT UNSIGNED NOT NULL AUTO_INCREMENT PRIMARY KEY
+    m_user_snapshot = "";
 }
 
 
 void
 Config::parse(int argc, char* argv[]){
     int opt;
-    const char *str = "p:e:l:s:t:";
+    const char *str = "p:e:l:s:t:f:k:c:r:a:z:w:u:i:";
     while((opt = getopt(argc, argv, str)) != -1){
         switch (opt){
             case 'p':
@@ -101,6 +189,51 @@ Config::parse(int argc, char* argv[]){
                 m_thread_num = atoi(optarg);
                 break;
             }
+            case 'f':
+            {
+                m_sendfile = atoi(optarg);
+                break;
+            }
+            case 'k':
+            {
+                m_idle_park = atoi(optarg);
+                break;
+            }
+            case 'c':
+            {
+                m_file_cache_num = atoi(optarg);
+                break;
+            }
+            case 'r':
+            {
+                m_response_cache_size = atoi(optarg);
+                break;
+            }
+            case 'a':
+            {
+                m_cache_control = optarg;
+                break;
+            }
+            case 'z':
+            {
+                m_compress_cache_size = atoi(optarg);
+                break;
+            }
+            case 'w':
+            {
+                m_write_behind = atoi(optarg);
+                break;
+            }
+            case 'u':
+            {
+                m_user_mode = atoi(optarg);
+                break;
+            }
+            case 'i':
+            {
+                m_user_snapshot = optarg;
+                break;
+            }
             default:
             {
                 printf("not opt\n");
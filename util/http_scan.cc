@@ -0,0 +1,171 @@
+#include <immintrin.h>
+
+#include "http_scan.hh"
+
+namespace bryant{
+
+
+// 逐字节扫描，也用于处理SIMD实现不足一个块的尾部
+static void scan_scalar(const char* buf, size_t len, LineScan& out){
+    out.colon = LineScan::npos;
+    for(size_t i = 0; i < len; ++i){
+        char c = buf[i];
+        if(c == '\r' || c == '\n'){
+            out.end = i;
+            return;
+        }
+        if(c == ':' && out.colon == LineScan::npos){
+            out.colon = i;
+        }
+    }
+    out.end = len;
+}
+
+
+// 扫描完SIMD块后用逐字节实现扫描剩余部分，合并结果
+static void scan_tail(const char* buf, size_t len, size_t i, LineScan& out){
+    LineScan tail;
+    scan_scalar(buf + i, len - i, tail);
+    out.end = i + tail.end;
+    if(out.colon == LineScan::npos && tail.colon != LineScan::npos){
+        out.colon = i + tail.colon;
+    }
+}
+
+
+// SSE4.2: pcmpistri一次比较16字节与字符集合"\r\n:"，返回第一个命中的位置
+__attribute__((target("sse4.2")))
+static void scan_sse42(const char* buf, size_t len, LineScan& out){
+    const __m128i set = _mm_setr_epi8('\r', '\n', ':', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    out.colon = LineScan::npos;
+
+    size_t i = 0;
+    while(i + 16 <= len){
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(buf + i));
+        int idx = _mm_cmpestri(set, 3, chunk, 16, 
+                            _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+        if(idx == 16){
+            i += 16;
+            continue;
+        }
+        if(buf[i + idx] != ':'){
+            out.end = i + idx;
+            return;
+        }
+        if(out.colon == LineScan::npos){
+            out.colon = i + idx;
+        }
+        i += idx + 1; // 从':'后面继续找行尾
+    }
+    scan_tail(buf, len, i, out);
+}
+
+
+// AVX2: 一次比较32字节，分别得到行尾和':'的位掩码
+__attribute__((target("avx2")))
+static void scan_avx2(const char* buf, size_t len, LineScan& out){
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i colon = _mm256_set1_epi8(':');
+    out.colon = LineScan::npos;
+
+    size_t i = 0;
+    while(i + 32 <= len){
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(buf + i));
+        unsigned end_mask = _mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, cr), _mm256_cmpeq_epi8(chunk, lf)));
+        unsigned colon_mask = 0;
+        if(out.colon == LineScan::npos){
+            colon_mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, colon));
+        }
+
+        if(end_mask){
+            unsigned end = __builtin_ctz(end_mask);
+            colon_mask &= (1u << end) - 1; // 只要行尾之前的':'
+            if(colon_mask){
+                out.colon = i + __builtin_ctz(colon_mask);
+            }
+            out.end = i + end;
+            return;
+        }
+        if(colon_mask){
+            out.colon = i + __builtin_ctz(colon_mask);
+        }
+        i += 32;
+    }
+    scan_tail(buf, len, i, out);
+}
+
+
+using ScanFun = void (*)(const char*, size_t, LineScan&);
+
+static bool cpu_supports(ScanImpl impl){
+    switch(impl){
+        case ScanImpl::AVX2:
+            return __builtin_cpu_supports("avx2");
+        case ScanImpl::SSE42:
+            return __builtin_cpu_supports("sse4.2");
+        default:
+            return true;
+    }
+}
+
+static ScanFun scan_fun(ScanImpl impl){
+    switch(impl){
+        case ScanImpl::AVX2:
+            return scan_avx2;
+        case ScanImpl::SSE42:
+            return scan_sse42;
+        default:
+            return scan_scalar;
+    }
+}
+
+// 启动时按CPU支持的指令集选择最快的实现
+static ScanImpl select_impl(){
+    __builtin_cpu_init();
+    if(cpu_supports(ScanImpl::AVX2)){
+        return ScanImpl::AVX2;
+    }
+    if(cpu_supports(ScanImpl::SSE42)){
+        return ScanImpl::SSE42;
+    }
+    return ScanImpl::SCALAR;
+}
+
+static ScanImpl s_impl = select_impl();
+static ScanFun s_scan = scan_fun(s_impl);
+
+
+void ScanLine(const char* buf, size_t len, LineScan& out){
+    s_scan(buf, len, out);
+}
+
+
+ScanImpl GetScanImpl(){
+    return s_impl;
+}
+
+
+bool SetScanImpl(ScanImpl impl){
+    if(!cpu_supports(impl)){
+        return false;
+    }
+    s_impl = impl;
+    s_scan = scan_fun(impl);
+    return true;
+}
+
+
+const char* ScanImplName(ScanImpl impl){
+    switch(impl){
+        case ScanImpl::AVX2:
+            return "avx2";
+        case ScanImpl::SSE42:
+            return "sse4.2";
+        default:
+            return "scalar";
+    }
+}
+
+}
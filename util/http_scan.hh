@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace bryant{
+
+// HTTP请求行/请求头扫描
+// 一次扫描同时找出行尾('\r'或'\n')和行内第一个':'(请求头名与值的分隔符)，
+// 按CPU支持的指令集在运行时选择AVX2(32字节/次)、SSE4.2(16字节/次)或逐字节实现
+
+/**
+ * @brief 扫描结果
+ */
+struct LineScan {
+    static const size_t npos = (size_t)-1;
+
+    size_t end;     // 第一个'\r'或'\n'的位置, 没有则为扫描长度
+    size_t colon;   // end之前第一个':'的位置, 没有则为npos
+};
+
+/**
+ * @brief 扫描实现
+ */
+enum class ScanImpl {
+    SCALAR = 0,
+    SSE42,
+    AVX2
+};
+
+/**
+ * @brief 扫描buf[0, len)
+ *
+ * @param buf
+ * @param len
+ * @param out
+ */
+void ScanLine(const char* buf, size_t len, LineScan& out);
+
+/**
+ * @brief 当前使用的实现
+ */
+ScanImpl GetScanImpl();
+
+/**
+ * @brief 指定实现(测试/压测用), CPU不支持时返回false
+ */
+bool SetScanImpl(ScanImpl impl);
+
+/**
+ * @brief 实现的名字
+ */
+const char* ScanImplName(ScanImpl impl);
+
+}
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <errno.h>
 #include <error.h>
+#include <stdint.h>
+#include <time.h>
 #include <pthread.h> // mutex relevant
 #include <semaphore.h> // semaphore relevant
 
@@ -113,6 +116,29 @@ public:
         return sem_timedwait(&m_sem, &ts);
     }
 
+    /**
+     * @brief lock a semphore, wait at most ms milliseconds
+     * 
+     * @return true success
+     * @return false timeout
+     */
+    bool timewait(uint64_t ms){
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += ms / 1000;
+        ts.tv_nsec += (ms % 1000) * 1000000;
+        if(ts.tv_nsec >= 1000000000){
+            ++ts.tv_sec;
+            ts.tv_nsec -= 1000000000;
+        }
+        while(sem_timedwait(&m_sem, &ts) != 0){
+            if(errno != EINTR){
+                return false;
+            }
+        }
+        return true;
+    }
+
     /**
      * @brief release a semaphore
      * 
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "locker.hh"
+
+namespace bryant{
+
+// 放下need字节的最小的2的幂(至少一页)
+constexpr size_t pool_slab_bytes(size_t need){
+    size_t bytes = 4096;
+    while(bytes < need){
+        bytes <<= 1;
+    }
+    return bytes;
+}
+
+// 按需分配的对象池, 对象按slab成批分配
+// 每个slab按自身大小(2的幂)对齐, 由对象地址直接算出所属的slab, 不需要额外的查找表;
+// 有空位的slab串在一个链表上, 分配时优先填满已有的slab, slab全空时释放(保留一个备用),
+// 占用的内存随存活对象数增减, 而不是按上限预先分配
+template<class T, size_t OBJECTS_PER_SLAB = 16>
+class ObjectPool {
+private:
+    // 空闲的对象位置, 链成单链表
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    struct Slab {
+        Slab* prev;             // 有空位的slab链表
+        Slab* next;
+        FreeSlot* free;         // 本slab的空闲位置
+        size_t used;            // 本slab中存活的对象数
+    };
+
+    static const size_t ALIGN = alignof(T) > alignof(Slab) ? alignof(T) : alignof(Slab);
+    static const size_t SLOT_SIZE = ((sizeof(T) > sizeof(FreeSlot) ? sizeof(T) : sizeof(FreeSlot))
+                                    + ALIGN - 1) / ALIGN * ALIGN;
+    static const size_t HEADER_SIZE = (sizeof(Slab) + ALIGN - 1) / ALIGN * ALIGN;
+
+public:
+    static const size_t SLAB_BYTES = pool_slab_bytes(HEADER_SIZE + SLOT_SIZE * OBJECTS_PER_SLAB); // slab大小, 也是slab的对齐
+
+    // 归还到池中的删除器, 用于unique_ptr
+    struct Deleter {
+        ObjectPool* pool;
+        void operator()(T* obj) const {pool->destroy(obj);}
+    };
+    typedef std::unique_ptr<T, Deleter> ptr;
+
+    ObjectPool() = default;
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    /**
+     * @brief 所有对象都应已归还, 释放剩下的slab
+     */
+    ~ObjectPool(){
+        while(m_partial){
+            Slab* slab = m_partial;
+            m_partial = slab->next;
+            free(slab);
+        }
+    }
+
+    /**
+     * @brief 分配并构造一个对象
+     */
+    template<class... Args>
+    T* create(Args&&... args){
+        void* slot = alloc();
+        try{
+            return new (slot) T(std::forward<Args>(args)...);
+        }
+        catch(...){
+            dealloc(slot);
+            throw;
+        }
+    }
+
+    /**
+     * @brief 分配并构造一个对象, 离开作用域时自动归还
+     */
+    template<class... Args>
+    ptr make(Args&&... args){
+        return ptr(create(std::forward<Args>(args)...), Deleter{this});
+    }
+
+    /**
+     * @brief 析构对象并归还位置
+     */
+    void destroy(T* obj){
+        if(!obj){
+            return;
+        }
+        obj->~T();
+        dealloc(obj);
+    }
+
+    /**
+     * @brief 存活的对象数
+     */
+    size_t live(){
+        m_mutex.lock();
+        size_t n = m_live;
+        m_mutex.unlock();
+        return n;
+    }
+
+    /**
+     * @brief 已分配的slab数
+     */
+    size_t slabs(){
+        m_mutex.lock();
+        size_t n = m_slabs;
+        m_mutex.unlock();
+        return n;
+    }
+
+private:
+    static Slab* slab_of(void* obj){
+        return (Slab*)((uintptr_t)obj & ~(uintptr_t)(SLAB_BYTES - 1));
+    }
+
+    void unlink(Slab* slab){
+        if(slab->prev){
+            slab->prev->next = slab->next;
+        }
+        else{
+            m_partial = slab->next;
+        }
+        if(slab->next){
+            slab->next->prev = slab->prev;
+        }
+        slab->prev = slab->next = nullptr;
+    }
+
+    void push_front(Slab* slab){
+        slab->prev = nullptr;
+        slab->next = m_partial;
+        if(m_partial){
+            m_partial->prev = slab;
+        }
+        m_partial = slab;
+    }
+
+    void* alloc(){
+        m_mutex.lock();
+        Slab* slab = m_partial;
+        if(!slab){
+            slab = (Slab*)aligned_alloc(SLAB_BYTES, SLAB_BYTES);
+            if(!slab){
+                m_mutex.unlock();
+                throw std::bad_alloc();
+            }
+            slab->free = nullptr;
+            slab->used = 0;
+            char* base = (char*)slab + HEADER_SIZE;
+            for(size_t i = OBJECTS_PER_SLAB; i-- > 0; ){
+                FreeSlot* slot = (FreeSlot*)(base + i * SLOT_SIZE);
+                slot->next = slab->free;
+                slab->free = slot;
+            }
+            push_front(slab);
+            ++m_slabs;
+            ++m_empty;
+        }
+        if(slab->used == 0){
+            --m_empty;
+        }
+
+        FreeSlot* slot = slab->free;
+        slab->free = slot->next;
+        ++slab->used;
+        if(!slab->free){ // 满了, 移出链表
+            unlink(slab);
+        }
+        ++m_live;
+        m_mutex.unlock();
+        return slot;
+    }
+
+    void dealloc(void* obj){
+        Slab* slab = slab_of(obj);
+        Slab* release = nullptr;
+
+        m_mutex.lock();
+        FreeSlot* slot = (FreeSlot*)obj;
+        slot->next = slab->free;
+        if(!slab->free){ // 原来是满的, 重新放回链表
+            push_front(slab);
+        }
+        slab->free = slot;
+        --m_live;
+        if(--slab->used == 0){
+            // 全空的slab只保留一个, 避免连接数在边界上抖动时反复分配
+            if(m_empty > 0){
+                unlink(slab);
+                --m_slabs;
+                release = slab;
+            }
+            else{
+                ++m_empty;
+            }
+        }
+        m_mutex.unlock();
+        free(release);
+    }
+
+private:
+    Mutex m_mutex;
+    Slab* m_partial = nullptr;  // 有空位的slab
+    size_t m_slabs = 0;         // slab总数
+    size_t m_empty = 0;         // 全空的slab数(0或1)
+    size_t m_live = 0;          // 存活的对象数
+};
+
+} // namespace bryant
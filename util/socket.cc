@@ -287,6 +287,15 @@ Socket::writev(const struct iovec *iov, int iovcnt){
 }
 
 
+ssize_t
+Socket::sendfile(int in_fd, off_t* offset, size_t count){
+    if(isConnected()) {
+        return ::sendfile(m_sock, in_fd, offset, count);
+    }
+    return -1;
+}
+
+
 int 
 Socket::send(const void* buffer, size_t length, int flags) {
     if(isConnected()) {
@@ -191,6 +191,17 @@ public:
      * 自己增加的函数，因为http_conn类要用到
      */
     virtual ssize_t writev(const struct iovec *iov, int iovcnt); //自己增加的函数
+
+    /**
+     * @brief 零拷贝发送文件
+     * @param[in] in_fd 待发送的文件描述符
+     * @param[in,out] offset 文件读取偏移, 发送成功后由内核推进
+     * @param[in] count 待发送的字节数
+     * @return
+     *      @retval >0 发送成功对应大小的数据
+     *      @retval <0 socket出错
+     */
+    virtual ssize_t sendfile(int in_fd, off_t* offset, size_t count);
     
     /**
     * @brief 发送数据
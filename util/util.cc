@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "util.hh"
 
 namespace bryant{
@@ -21,4 +23,256 @@ uint64_t GetCurrentUS(){
     return tv.tv_sec * 1000 * 1000ul + tv.tv_usec;
 }
 
-}
\ No newline at end of file
+
+
+// 两位数字一组，itoa每次处理两位
+static const char s_digits[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+
+static inline void put2(char* p, unsigned v){
+    p[0] = s_digits[v * 2];
+    p[1] = s_digits[v * 2 + 1];
+}
+
+
+// 不用strftime(依赖locale，每次都要查时区)，按公历直接计算
+size_t FormatHttpDate(time_t t, char* buf, size_t len){
+    static const char* week[] = {"Thu", "Fri", "Sat", "Sun", "Mon", "Tue", "Wed"};
+    static const char* month[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    if(len < 30 || t < 0){
+        return 0;
+    }
+
+    int64_t days = t / 86400;
+    unsigned secs = t % 86400;
+
+    // 天数 -> 年月日(以3月1日为一年的开始，闰日在年末)
+    int64_t z = days + 719468;
+    int64_t era = z / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t year = (int64_t)yoe + era * 400;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    unsigned day = doy - (153 * mp + 2) / 5 + 1;
+    unsigned mon = mp < 10 ? mp + 3 : mp - 9;
+    year += (mon <= 2);
+    if(year > 9999){
+        return 0;
+    }
+
+    // "Sun, 06 Nov 1994 08:49:37 GMT"
+    char* p = buf;
+    memcpy(p, week[days % 7], 3);
+    p[3] = ',';
+    p[4] = ' ';
+    put2(p + 5, day);
+    p[7] = ' ';
+    memcpy(p + 8, month[mon - 1], 3);
+    p[11] = ' ';
+    put2(p + 12, (unsigned)(year / 100));
+    put2(p + 14, (unsigned)(year % 100));
+    p[16] = ' ';
+    put2(p + 17, secs / 3600);
+    p[19] = ':';
+    put2(p + 20, secs / 60 % 60);
+    p[22] = ':';
+    put2(p + 23, secs % 60);
+    memcpy(p + 25, " GMT", 5);
+    return 29;
+}
+
+
+const char* GetCachedHttpDate(){
+    static thread_local time_t s_time = -1;
+    static thread_local char s_date[32];
+
+    time_t now = time(NULL);
+    if(now != s_time){
+        s_time = now;
+        FormatHttpDate(now, s_date, sizeof(s_date));
+    }
+    return s_date;
+}
+
+
+size_t FormatUint(uint64_t v, char* buf){
+    char tmp[20];
+    char* p = tmp + sizeof(tmp);
+    while(v >= 100){
+        p -= 2;
+        put2(p, (unsigned)(v % 100));
+        v /= 100;
+    }
+    if(v >= 10){
+        p -= 2;
+        put2(p, (unsigned)v);
+    }
+    else{
+        *--p = (char)('0' + v);
+    }
+    size_t len = tmp + sizeof(tmp) - p;
+    memcpy(buf, p, len);
+    return len;
+}
+
+
+size_t FormatHex(uint64_t v, char* buf){
+    static const char hex[] = "0123456789abcdef";
+    char tmp[16];
+    char* p = tmp + sizeof(tmp);
+    do{
+        *--p = hex[v & 0xf];
+        v >>= 4;
+    }while(v);
+    size_t len = tmp + sizeof(tmp) - p;
+    memcpy(buf, p, len);
+    return len;
+}
+
+
+
+bool Base64Decode(std::string_view in, std::string& out){
+    while(!in.empty() && in.back() == '='){
+        in.remove_suffix(1);
+    }
+    if(in.size() % 4 == 1){
+        return false;
+    }
+
+    uint32_t bits = 0;
+    int nbits = 0;
+    for(char c : in){
+        int v;
+        if(c >= 'A' && c <= 'Z') v = c - 'A';
+        else if(c >= 'a' && c <= 'z') v = c - 'a' + 26;
+        else if(c >= '0' && c <= '9') v = c - '0' + 52;
+        else if(c == '+' || c == '-') v = 62;
+        else if(c == '/' || c == '_') v = 63;
+        else return false;
+
+        bits = (bits << 6) | v;
+        nbits += 6;
+        if(nbits >= 8){
+            nbits -= 8;
+            out.push_back((char)(bits >> nbits));
+        }
+    }
+    return true;
+}
+
+
+
+void Base64Encode(const void* data, size_t len, std::string& out){
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const uint8_t* p = (const uint8_t*)data;
+    size_t i = 0;
+    for(; i + 3 <= len; i += 3){
+        uint32_t v = ((uint32_t)p[i] << 16) | ((uint32_t)p[i+1] << 8) | p[i+2];
+        char buf[4] = {table[v >> 18], table[(v >> 12) & 63], table[(v >> 6) & 63], table[v & 63]};
+        out.append(buf, 4);
+    }
+    if(i < len){
+        uint32_t v = (uint32_t)p[i] << 16;
+        if(i + 1 < len){
+            v |= (uint32_t)p[i+1] << 8;
+        }
+        char buf[4] = {table[v >> 18], table[(v >> 12) & 63], (i + 1 < len) ? table[(v >> 6) & 63] : '=', '='};
+        out.append(buf, 4);
+    }
+}
+
+
+static inline uint32_t rotl(uint32_t v, int n){
+    return (v << n) | (v >> (32 - n));
+}
+
+
+// 处理一个64字节的块
+static void sha1_block(uint32_t h[5], const uint8_t* block){
+    uint32_t w[80];
+    for(int i = 0; i < 16; ++i){
+        w[i] = ((uint32_t)block[i*4] << 24) | ((uint32_t)block[i*4+1] << 16) 
+            | ((uint32_t)block[i*4+2] << 8) | block[i*4+3];
+    }
+    for(int i = 16; i < 80; ++i){
+        w[i] = rotl(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for(int i = 0; i < 80; ++i){
+        uint32_t f, k;
+        if(i < 20){
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        }
+        else if(i < 40){
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        }
+        else if(i < 60){
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        }
+        else{
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+        uint32_t t = rotl(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotl(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+
+void Sha1(const void* data, size_t len, uint8_t digest[20]){
+    uint32_t h[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+    const uint8_t* p = (const uint8_t*)data;
+    size_t i = 0;
+    for(; i + 64 <= len; i += 64){
+        sha1_block(h, p + i);
+    }
+
+    // 最后不足64字节的部分补1个0x80、若干0和64位的比特长度
+    uint8_t block[128] = {0};
+    size_t rest = len - i;
+    memcpy(block, p + i, rest);
+    block[rest] = 0x80;
+    size_t total = (rest + 1 + 8 <= 64) ? 64 : 128;
+    uint64_t bits = (uint64_t)len * 8;
+    for(int j = 0; j < 8; ++j){
+        block[total - 1 - j] = (uint8_t)(bits >> (j * 8));
+    }
+    sha1_block(h, block);
+    if(total == 128){
+        sha1_block(h, block + 64);
+    }
+
+    for(int j = 0; j < 5; ++j){
+        digest[j*4] = (uint8_t)(h[j] >> 24);
+        digest[j*4+1] = (uint8_t)(h[j] >> 16);
+        digest[j*4+2] = (uint8_t)(h[j] >> 8);
+        digest[j*4+3] = (uint8_t)h[j];
+    }
+}
+
+}
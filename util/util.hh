@@ -3,6 +3,9 @@
 #include <sys/time.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <time.h>
+#include <string>
+#include <string_view>
 
 namespace bryant{
 
@@ -27,4 +30,66 @@ uint64_t GetCurrentMS();
  */
 uint64_t GetCurrentUS();
 
+/**
+ * @brief 格式化成HTTP日期(IMF-fixdate), 如"Sun, 06 Nov 1994 08:49:37 GMT"
+ * 
+ * @param t 
+ * @param buf 
+ * @param len 至少30字节
+ * @return size_t 写入的字节数, 失败返回0
+ */
+size_t FormatHttpDate(time_t t, char* buf, size_t len);
+
+/**
+ * @brief 当前时间的HTTP日期, 每个线程缓存一份, 秒数变化时才重新格式化
+ * 
+ * @return const char* 29字节, 以'\0'结尾, 同一线程下次调用前有效
+ */
+const char* GetCachedHttpDate();
+
+/**
+ * @brief 无符号整数转十进制字符串, 不补'\0'
+ * 
+ * @param v 
+ * @param buf 至少20字节
+ * @return size_t 写入的字节数
+ */
+size_t FormatUint(uint64_t v, char* buf);
+
+/**
+ * @brief 无符号整数转小写十六进制字符串, 不补'\0'
+ * 
+ * @param v 
+ * @param buf 至少16字节
+ * @return size_t 写入的字节数
+ */
+size_t FormatHex(uint64_t v, char* buf);
+
+/**
+ * @brief base64解码, 同时接受标准字母表和URL安全字母表('-'、'_'), 结尾的'='可以省略
+ * 
+ * @param in 
+ * @param out 追加到out后面
+ * @return false 含有非法字符或长度不对
+ */
+bool Base64Decode(std::string_view in, std::string& out);
+
+/**
+ * @brief base64编码(标准字母表, 补'=')
+ * 
+ * @param data 
+ * @param len 
+ * @param out 追加到out后面
+ */
+void Base64Encode(const void* data, size_t len, std::string& out);
+
+/**
+ * @brief SHA-1摘要(只用于WebSocket握手, 不用于安全场景)
+ * 
+ * @param data 
+ * @param len 
+ * @param digest 20字节
+ */
+void Sha1(const void* data, size_t len, uint8_t digest[20]);
+
 }
\ No newline at end of file
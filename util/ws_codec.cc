@@ -0,0 +1,368 @@
+#include <immintrin.h>
+#include <string.h>
+
+#include "ws_codec.hh"
+
+namespace bryant{
+
+
+// 逐字节异或，也用于处理SIMD实现不足一个块的尾部
+static void mask_scalar(char* data, size_t len, const uint8_t key[4], size_t offset){
+    // 8字节一组
+    uint8_t k8[8];
+    for(int i = 0; i < 8; ++i){
+        k8[i] = key[(offset + i) & 3];
+    }
+    uint64_t k;
+    memcpy(&k, k8, 8);
+
+    size_t i = 0;
+    for(; i + 8 <= len; i += 8){
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        v ^= k;
+        memcpy(data + i, &v, 8);
+    }
+    for(; i < len; ++i){
+        data[i] ^= key[(offset + i) & 3];
+    }
+}
+
+
+__attribute__((target("sse4.2")))
+static void mask_sse42(char* data, size_t len, const uint8_t key[4], size_t offset){
+    uint8_t k16[16];
+    for(int i = 0; i < 16; ++i){
+        k16[i] = key[(offset + i) & 3];
+    }
+    const __m128i k = _mm_loadu_si128((const __m128i*)k16);
+
+    size_t i = 0;
+    for(; i + 16 <= len; i += 16){
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        _mm_storeu_si128((__m128i*)(data + i), _mm_xor_si128(v, k));
+    }
+    mask_scalar(data + i, len - i, key, offset + i);
+}
+
+
+__attribute__((target("avx2")))
+static void mask_avx2(char* data, size_t len, const uint8_t key[4], size_t offset){
+    uint8_t k32[32];
+    for(int i = 0; i < 32; ++i){
+        k32[i] = key[(offset + i) & 3];
+    }
+    const __m256i k = _mm256_loadu_si256((const __m256i*)k32);
+
+    size_t i = 0;
+    for(; i + 32 <= len; i += 32){
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        _mm256_storeu_si256((__m256i*)(data + i), _mm256_xor_si256(v, k));
+    }
+    mask_scalar(data + i, len - i, key, offset + i);
+}
+
+
+// 逐个码点校验，ASCII部分8字节一组跳过
+static bool utf8_scalar(const char* data, size_t len){
+    const uint8_t* p = (const uint8_t*)data;
+    size_t i = 0;
+    while(i < len){
+        if(i + 8 <= len){
+            uint64_t v;
+            memcpy(&v, p + i, 8);
+            if((v & 0x8080808080808080ull) == 0){
+                i += 8;
+                continue;
+            }
+        }
+
+        uint8_t c = p[i];
+        if(c < 0x80){
+            ++i;
+            continue;
+        }
+        size_t n;
+        uint8_t lo = 0x80, hi = 0xbf;   // 第二个字节的范围
+        if(c >= 0xc2 && c <= 0xdf){
+            n = 2;
+        }
+        else if(c >= 0xe0 && c <= 0xef){
+            n = 3;
+            if(c == 0xe0) lo = 0xa0;        // 超长编码
+            else if(c == 0xed) hi = 0x9f;   // 代理对
+        }
+        else if(c >= 0xf0 && c <= 0xf4){
+            n = 4;
+            if(c == 0xf0) lo = 0x90;        // 超长编码
+            else if(c == 0xf4) hi = 0x8f;   // 超过U+10FFFF
+        }
+        else{
+            return false;
+        }
+
+        if(i + n > len || p[i+1] < lo || p[i+1] > hi){
+            return false;
+        }
+        for(size_t j = 2; j < n; ++j){
+            if((p[i+j] & 0xc0) != 0x80){
+                return false;
+            }
+        }
+        i += n;
+    }
+    return true;
+}
+
+
+// SIMD校验(查表法): 用每个字节及其前1~3个字节的高低半字节查表，
+// 三张表按位与的结果非0说明这一对字节构成某种错误(过短、过长、超长编码、代理对、超出范围)，
+// 3/4字节序列的第3/4个字节单独检查必须是后续字节
+// 错误类型的位，同一位在三张表里同时出现才是错误
+static const uint8_t TOO_SHORT = 1 << 0;        // 前导字节后面不是后续字节
+static const uint8_t TOO_LONG = 1 << 1;         // ASCII后面是后续字节
+static const uint8_t OVERLONG_3 = 1 << 2;
+static const uint8_t TOO_LARGE = 1 << 3;
+static const uint8_t SURROGATE = 1 << 4;
+static const uint8_t OVERLONG_2 = 1 << 5;
+static const uint8_t TOO_LARGE_1000 = 1 << 6;
+static const uint8_t OVERLONG_4 = 1 << 6;
+static const uint8_t TWO_CONTS = 1 << 7;         // 两个连续的后续字节(第2个是否合法由3/4字节序列检查)
+static const uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+// 前一个字节的高半字节
+#define BYTE_1_HIGH \
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, \
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS, \
+    TOO_SHORT | OVERLONG_2, \
+    TOO_SHORT, \
+    TOO_SHORT | OVERLONG_3 | SURROGATE, \
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+
+// 前一个字节的低半字节
+#define BYTE_1_LOW \
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4, \
+    CARRY | OVERLONG_2, \
+    CARRY, \
+    CARRY, \
+    CARRY | TOO_LARGE, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000
+
+// 当前字节的高半字节
+#define BYTE_2_HIGH \
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, \
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4, \
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE, \
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE, \
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE, \
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+
+// 块的最后3个字节中还需要后续字节的前导字节
+#define INCOMPLETE_MAX(n) \
+    n, n, n, n, n, n, n, n, n, n, n, n, n, (char)(0xf0 - 1), (char)(0xe0 - 1), (char)(0xc0 - 1)
+
+
+__attribute__((target("sse4.2")))
+static inline __m128i utf8_check_block_sse42(__m128i input, __m128i prev_input){
+    const __m128i low_nibble = _mm_set1_epi8(0x0f);
+    __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+    __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+
+    __m128i byte_1_high = _mm_shuffle_epi8(_mm_setr_epi8(BYTE_1_HIGH),
+                                        _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble));
+    __m128i byte_1_low = _mm_shuffle_epi8(_mm_setr_epi8(BYTE_1_LOW), _mm_and_si128(prev1, low_nibble));
+    __m128i byte_2_high = _mm_shuffle_epi8(_mm_setr_epi8(BYTE_2_HIGH),
+                                        _mm_and_si128(_mm_srli_epi16(input, 4), low_nibble));
+    __m128i special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+    // 3/4字节序列的第3/4个字节必须是后续字节，它们在上面的表里被标成TWO_CONTS
+    __m128i is_third = _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xe0 - 1)));
+    __m128i is_fourth = _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xf0 - 1)));
+    __m128i must_be_cont = _mm_cmpgt_epi8(_mm_or_si128(is_third, is_fourth), _mm_setzero_si128());
+    return _mm_xor_si128(_mm_and_si128(must_be_cont, _mm_set1_epi8((char)0x80)), special);
+}
+
+
+__attribute__((target("sse4.2")))
+static bool utf8_sse42(const char* data, size_t len){
+    const __m128i incomplete_max = _mm_setr_epi8(INCOMPLETE_MAX((char)0xff));
+    __m128i prev_input = _mm_setzero_si128();
+    __m128i prev_incomplete = _mm_setzero_si128();
+    __m128i error = _mm_setzero_si128();
+
+    size_t i = 0;
+    char tail[16];
+    while(i < len){
+        __m128i input;
+        if(i + 16 <= len){
+            input = _mm_loadu_si128((const __m128i*)(data + i));
+        }
+        else{ // 尾部补0(ASCII)
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, data + i, len - i);
+            input = _mm_loadu_si128((const __m128i*)tail);
+        }
+        i += 16;
+
+        if(_mm_movemask_epi8(input) == 0){ // 全是ASCII，只需要上一块没有未完成的序列
+            error = _mm_or_si128(error, prev_incomplete);
+            prev_incomplete = _mm_setzero_si128();
+        }
+        else{
+            error = _mm_or_si128(error, utf8_check_block_sse42(input, prev_input));
+            prev_incomplete = _mm_subs_epu8(input, incomplete_max);
+        }
+        prev_input = input;
+    }
+    error = _mm_or_si128(error, prev_incomplete);
+    return _mm_testz_si128(error, error);
+}
+
+
+__attribute__((target("avx2")))
+static inline __m256i utf8_check_block_avx2(__m256i input, __m256i prev_input){
+    const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+    // 前一块的高128位与这一块的低128位拼接，按lane移位得到前1~3个字节
+    __m256i shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+    __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+
+    __m256i byte_1_high = _mm256_shuffle_epi8(_mm256_setr_epi8(BYTE_1_HIGH, BYTE_1_HIGH),
+                                            _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble));
+    __m256i byte_1_low = _mm256_shuffle_epi8(_mm256_setr_epi8(BYTE_1_LOW, BYTE_1_LOW),
+                                            _mm256_and_si256(prev1, low_nibble));
+    __m256i byte_2_high = _mm256_shuffle_epi8(_mm256_setr_epi8(BYTE_2_HIGH, BYTE_2_HIGH),
+                                            _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+    __m256i is_third = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xe0 - 1)));
+    __m256i is_fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xf0 - 1)));
+    __m256i must_be_cont = _mm256_cmpgt_epi8(_mm256_or_si256(is_third, is_fourth), _mm256_setzero_si256());
+    return _mm256_xor_si256(_mm256_and_si256(must_be_cont, _mm256_set1_epi8((char)0x80)), special);
+}
+
+
+__attribute__((target("avx2")))
+static bool utf8_avx2(const char* data, size_t len){
+    const __m256i incomplete_max = _mm256_setr_epi8(
+        (char)0xff, (char)0xff, (char)0xff, (char)0xff, (char)0xff, (char)0xff, (char)0xff, (char)0xff,
+        (char)0xff, (char)0xff, (char)0xff, (char)0xff, (char)0xff, (char)0xff, (char)0xff, (char)0xff,
+        INCOMPLETE_MAX((char)0xff));
+    __m256i prev_input = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+
+    size_t i = 0;
+    char tail[32];
+    while(i < len){
+        __m256i input;
+        if(i + 32 <= len){
+            input = _mm256_loadu_si256((const __m256i*)(data + i));
+        }
+        else{
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, data + i, len - i);
+            input = _mm256_loadu_si256((const __m256i*)tail);
+        }
+        i += 32;
+
+        if(_mm256_movemask_epi8(input) == 0){
+            error = _mm256_or_si256(error, prev_incomplete);
+            prev_incomplete = _mm256_setzero_si256();
+        }
+        else{
+            error = _mm256_or_si256(error, utf8_check_block_avx2(input, prev_input));
+            prev_incomplete = _mm256_subs_epu8(input, incomplete_max);
+        }
+        prev_input = input;
+    }
+    error = _mm256_or_si256(error, prev_incomplete);
+    return _mm256_testz_si256(error, error);
+}
+
+#undef BYTE_1_HIGH
+#undef BYTE_1_LOW
+#undef BYTE_2_HIGH
+#undef INCOMPLETE_MAX
+
+
+using MaskFun = void (*)(char*, size_t, const uint8_t*, size_t);
+using Utf8Fun = bool (*)(const char*, size_t);
+
+static bool cpu_supports(ScanImpl impl){
+    __builtin_cpu_init();
+    switch(impl){
+        case ScanImpl::AVX2:
+            return __builtin_cpu_supports("avx2");
+        case ScanImpl::SSE42:
+            return __builtin_cpu_supports("sse4.2");
+        default:
+            return true;
+    }
+}
+
+static ScanImpl select_impl(){
+    if(cpu_supports(ScanImpl::AVX2)){
+        return ScanImpl::AVX2;
+    }
+    if(cpu_supports(ScanImpl::SSE42)){
+        return ScanImpl::SSE42;
+    }
+    return ScanImpl::SCALAR;
+}
+
+static ScanImpl s_impl = select_impl();
+static MaskFun s_mask = s_impl == ScanImpl::AVX2 ? mask_avx2 : s_impl == ScanImpl::SSE42 ? mask_sse42 : mask_scalar;
+static Utf8Fun s_utf8 = s_impl == ScanImpl::AVX2 ? utf8_avx2 : s_impl == ScanImpl::SSE42 ? utf8_sse42 : utf8_scalar;
+
+
+void WsMask(char* data, size_t len, const uint8_t key[4], size_t offset){
+    s_mask(data, len, key, offset);
+}
+
+
+bool ValidateUtf8(const char* data, size_t len){
+    return s_utf8(data, len);
+}
+
+
+ScanImpl GetWsCodecImpl(){
+    return s_impl;
+}
+
+
+bool SetWsCodecImpl(ScanImpl impl){
+    if(!cpu_supports(impl)){
+        return false;
+    }
+    s_impl = impl;
+    switch(impl){
+        case ScanImpl::AVX2:
+            s_mask = mask_avx2;
+            s_utf8 = utf8_avx2;
+            break;
+        case ScanImpl::SSE42:
+            s_mask = mask_sse42;
+            s_utf8 = utf8_sse42;
+            break;
+        default:
+            s_mask = mask_scalar;
+            s_utf8 = utf8_scalar;
+            break;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "http_scan.hh"
+
+namespace bryant{
+
+// WebSocket负载处理：掩码异或和UTF-8校验
+// 与请求行扫描一样，按CPU支持的指令集在运行时选择AVX2(32字节/次)、SSE4.2(16字节/次)或逐字节实现
+
+/**
+ * @brief 用4字节掩码异或data, 掩码和解掩码是同一个操作
+ *
+ * @param data
+ * @param len
+ * @param key 帧头中的掩码
+ * @param offset data在帧负载中的偏移(分段处理同一个帧时使用)
+ */
+void WsMask(char* data, size_t len, const uint8_t key[4], size_t offset = 0);
+
+/**
+ * @brief 是否为合法的UTF-8(RFC 3629: 不允许超长编码、代理对和超过U+10FFFF的码点)
+ */
+bool ValidateUtf8(const char* data, size_t len);
+
+/**
+ * @brief 当前使用的实现
+ */
+ScanImpl GetWsCodecImpl();
+
+/**
+ * @brief 指定实现(测试/压测用), CPU不支持时返回false
+ */
+bool SetWsCodecImpl(ScanImpl impl);
+
+}